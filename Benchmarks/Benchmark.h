@@ -0,0 +1,228 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Literals.h"
+
+namespace MSGPack
+{
+	/// Any value that depends on the work, so it can't be optimised away
+	static volatile u64 sink = 0;
+
+	/*
+	*	Spread of the samples of one measurement, in ns per op
+	*/
+	struct Stats
+	{
+		f64 min;
+		f64 median;
+		f64 mean;
+		f64 stddev;
+		f64 max;
+	};
+
+	/*
+	*	One measurement: an operation (e.g. encoding) on a payload with a
+	*	Packer/Unpacker configuration
+	*/
+	struct Result
+	{
+		std::string payload;
+		std::string config;
+		std::string operation;
+		u32			threads;
+		u64			bytes;		// Of the message, per op
+		u64			iterations; // Ops per sample
+		Stats		ns;
+
+		/// Throughput at the median, in 10^6 bytes per second
+		f64 MBPerSec() const;
+	};
+
+	/*
+	*	Times operations with steady_clock. Each is run warmups_ times first, so
+	*	that caches, the branch predictor and the allocator settle, and then for
+	*	samples_ samples. A sample repeats the op enough times to take at least
+	*	minSampleNs_, so that the clock's resolution doesn't matter for short ops.
+	*/
+	class Benchmark
+	{
+	public:
+		Benchmark(const u32 warmups_, const u32 samples_, const f64 minSampleNs_);
+
+		/// Times op_, one operation on a message of bytes_ bytes, and records the result
+		template <typename F>
+		const Result& Run(const char* payload_, const char* config_, const char* operation_, const u64 bytes_, F&& op_, const u32 threads_ = 1);
+
+		/// Returns every result recorded so far
+		const std::vector<Result>& Results() const;
+
+		/// Prints the header of the table of results
+		static void PrintHeader();
+
+		/// Prints a result as a row of the table
+		static void Print(const Result& result_);
+
+		/// Writes every result to path_ as JSON. Returns false if the file couldn't be written
+		bool WriteJson(const char* path_) const;
+
+	private:
+		u32					warmups;
+		u32					samples;
+		f64					minSampleNs;
+		std::vector<Result> results;
+
+		/// Returns the statistics of samples_, which is sorted
+		static Stats Summarise(std::vector<f64>& samples_);
+	};
+
+	/*
+	*	Public
+	*/
+
+	inline f64 Result::MBPerSec() const
+	{
+		// Bytes per ns is 10^3 MB/s
+		return ((f64)bytes / ns.median) * 1e3;
+	}
+
+	inline Benchmark::Benchmark(const u32 warmups_, const u32 samples_, const f64 minSampleNs_) :
+								warmups(warmups_),
+								samples(std::max(samples_, 1u)),
+								minSampleNs(minSampleNs_)
+	{
+	}
+
+	template <typename F>
+	const Result& Benchmark::Run(const char* payload_, const char* config_, const char* operation_, const u64 bytes_, F&& op_, const u32 threads_)
+	{
+		using namespace std::chrono;
+
+		for (u32 i = 0; i < warmups; ++i)
+		{
+			op_();
+		}
+
+		// Enough ops per sample to take minSampleNs, from the time of one
+		const time_point<steady_clock> calibrateStartPt = steady_clock::now();
+		op_();
+		const time_point<steady_clock> calibrateEndPt = steady_clock::now();
+
+		const f64 opNs		 = std::max((f64)duration_cast<nanoseconds>(calibrateEndPt - calibrateStartPt).count(), 1.0);
+		const u64 iterations = std::max((u64)std::ceil(minSampleNs / opNs), (u64)1);
+
+		std::vector<f64> times;
+		times.reserve(samples);
+
+		for (u32 i = 0; i < samples; ++i)
+		{
+			const time_point<steady_clock> startPt = steady_clock::now();
+			for (u64 j = 0; j < iterations; ++j)
+			{
+				op_();
+			}
+			const time_point<steady_clock> endPt = steady_clock::now();
+
+			times.push_back((f64)duration_cast<nanoseconds>(endPt - startPt).count() / iterations);
+		}
+
+		Result result;
+		result.payload	  = payload_;
+		result.config	  = config_;
+		result.operation  = operation_;
+		result.threads	  = threads_;
+		result.bytes	  = bytes_;
+		result.iterations = iterations;
+		result.ns		  = Summarise(times);
+
+		results.push_back(result);
+		Print(results.back());
+
+		return results.back();
+	}
+
+	inline const std::vector<Result>& Benchmark::Results() const
+	{
+		return results;
+	}
+
+	inline void Benchmark::PrintHeader()
+	{
+		printf("%-14s %-8s %-12s %7s %12s %10s %12s %10s\n", "Payload", "Config", "Operation", "Threads", "Bytes", "ns/op", "+/-", "MB/s");
+	}
+
+	inline void Benchmark::Print(const Result& result_)
+	{
+		printf("%-14s %-8s %-12s %7u %12llu %10.0f %11.1f%% %10.1f\n", result_.payload.c_str(), result_.config.c_str(), result_.operation.c_str(),
+			   result_.threads, (unsigned long long)result_.bytes, result_.ns.median, (result_.ns.stddev / result_.ns.mean) * 100.0, result_.MBPerSec());
+	}
+
+	inline bool Benchmark::WriteJson(const char* path_) const
+	{
+		FILE* file = fopen(path_, "w");
+		if (!file)
+		{
+			return false;
+		}
+
+		fprintf(file, "{\n");
+		fprintf(file, "\t\"warmups\": %u,\n", warmups);
+		fprintf(file, "\t\"samples\": %u,\n", samples);
+		fprintf(file, "\t\"minSampleNs\": %.0f,\n", minSampleNs);
+		fprintf(file, "\t\"results\": [\n");
+
+		for (u64 i = 0; i < results.size(); ++i)
+		{
+			// Names are all plain identifiers, so need no escaping
+			const Result& result = results[i];
+			fprintf(file, "\t\t{\"payload\": \"%s\", \"config\": \"%s\", \"operation\": \"%s\", \"threads\": %u, \"bytes\": %llu, \"iterations\": %llu, ",
+					result.payload.c_str(), result.config.c_str(), result.operation.c_str(), result.threads, (unsigned long long)result.bytes,
+					(unsigned long long)result.iterations);
+			fprintf(file, "\"nsPerOp\": {\"min\": %.2f, \"median\": %.2f, \"mean\": %.2f, \"stddev\": %.2f, \"max\": %.2f}, \"mbPerSec\": %.2f}%s\n",
+					result.ns.min, result.ns.median, result.ns.mean, result.ns.stddev, result.ns.max, result.MBPerSec(),
+					(i + 1 < results.size()) ? "," : "");
+		}
+
+		fprintf(file, "\t]\n");
+		fprintf(file, "}\n");
+
+		return (fclose(file) == 0);
+	}
+
+	/*
+	*	Private
+	*/
+
+	inline Stats Benchmark::Summarise(std::vector<f64>& samples_)
+	{
+		std::sort(samples_.begin(), samples_.end());
+
+		Stats stats;
+		stats.min = samples_.front();
+		stats.max = samples_.back();
+
+		const u64 mid = samples_.size() / 2;
+		stats.median  = (samples_.size() % 2) ? samples_[mid] : (samples_[mid - 1] + samples_[mid]) * 0.5;
+
+		f64 sum = 0.0;
+		for (const f64 sample : samples_)
+		{
+			sum += sample;
+		}
+		stats.mean = sum / samples_.size();
+
+		f64 squares = 0.0;
+		for (const f64 sample : samples_)
+		{
+			squares += (sample - stats.mean) * (sample - stats.mean);
+		}
+		stats.stddev = std::sqrt(squares / samples_.size());
+
+		return stats;
+	}
+}
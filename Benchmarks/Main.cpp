@@ -0,0 +1,218 @@
+#if defined(_WINDOWS)
+	#define _CRT_SECURE_NO_WARNINGS 1
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <algorithm>
+
+#include "Packer.h"
+#include "Unpacker.h"
+#include "BatchUnpacker.h"
+
+#include "Benchmark.h"
+#include "Payloads.h"
+
+namespace MSGPack
+{
+	/*
+	*	Encode and decode throughput of each payload shape across the Packer and
+	*	Unpacker configurations, then the other ways of decoding and batches of
+	*	small messages on 1..N threads. Results are printed as a table and, with
+	*	--json <path>, written out to compare builds with.
+	*/
+	static constexpr const u32 NumMessages = 1 << 16;
+
+	/// Fixed store big enough for the largest payload
+	static constexpr const u32 FixedSize = 1 << 23;
+
+	/// Adds up what UnpackElement() does, through Unpacker::Visit()
+	struct SumVisitor : Visitor
+	{
+		u64 total = 0;
+
+		void OnBool(const bool val_) { total += val_; }
+		void OnUInt(const u64 val_) { total += val_; }
+		void OnInt(const i64 val_) { total += (u64)val_; }
+		void OnFloat(const f64 val_) { total += (u64)val_; }
+		void OnString(const std::string_view val_) { total += Checksum(val_.data(), val_.size()); }
+		void OnBinary(const std::pair<void*, u32>& val_) { total += Checksum(val_.first, val_.second); }
+	};
+
+	/// Encodes every payload with packer_ and decodes it again with an Unpacker<Secure, Local>
+	template <bool Secure, bool Local, typename T>
+	void RunConfig(Benchmark& benchmark_, const char* config_, PackerBase<T>& packer_)
+	{
+		Unpacker<Secure, Local> unpacker;
+
+		for (u32 i = 0; i < Payload::NumPayloads; ++i)
+		{
+			const Payload payload = (Payload)i;
+
+			packer_.Clear();
+			PackPayload(payload, packer_);
+
+			benchmark_.Run(PayloadNames[i], config_, "Encode", packer_.CurrentSize(), [&]()
+			{
+				packer_.Clear();
+				PackPayload(payload, packer_);
+			});
+
+			const std::pair<void*, u64> msg = packer_.Message();
+			benchmark_.Run(PayloadNames[i], config_, "Decode", msg.second, [&]()
+			{
+				unpacker.Set(msg);
+				sink = sink + UnpackElement(unpacker);
+			});
+		}
+
+		packer_.Clear();
+	}
+
+	/// Decodes every payload with Failure::Flag, Visit() and Skip()
+	void RunDecodeModes(Benchmark& benchmark_)
+	{
+		Packer<std::numeric_limits<u32>::max(), false> packer;
+		Unpacker<false>								   unpacker;
+		Unpacker<true, false, Failure::Flag>		   flagUnpacker;
+
+		for (u32 i = 0; i < Payload::NumPayloads; ++i)
+		{
+			packer.Clear();
+			PackPayload((Payload)i, packer);
+
+			const std::pair<void*, u64> msg = packer.Message();
+
+			benchmark_.Run(PayloadNames[i], "Flag", "Decode", msg.second, [&]()
+			{
+				flagUnpacker.Set(msg);
+				sink = sink + UnpackElement(flagUnpacker) + (u64)flagUnpacker.Error();
+			});
+
+			benchmark_.Run(PayloadNames[i], "Default", "Visit", msg.second, [&]()
+			{
+				unpacker.Set(msg);
+
+				SumVisitor visitor;
+				unpacker.Visit(visitor);
+				sink = sink + visitor.total;
+			});
+
+			benchmark_.Run(PayloadNames[i], "Default", "Skip", msg.second, [&]()
+			{
+				unpacker.Set(msg);
+				unpacker.Skip();
+				sink = sink + unpacker.Tell();
+			});
+		}
+	}
+
+	/// Decodes NumMessages small messages with a BatchUnpacker on 1, 2, 4... threads up to every core
+	void RunBatches(Benchmark& benchmark_)
+	{
+		Packer<std::numeric_limits<u32>::max(), false> packer;
+		PackMessages(packer, NumMessages);
+
+		const std::pair<void*, u64> msgs = packer.Message();
+
+		// Every core is measured even if that isn't a power of 2
+		const u32		 numCores = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<u32> threadCounts;
+		for (u32 numThreads = 1; numThreads < numCores; numThreads *= 2)
+		{
+			threadCounts.push_back(numThreads);
+		}
+		threadCounts.push_back(numCores);
+
+		for (const u32 numThreads : threadCounts)
+		{
+			WorkStealingPool	 pool(numThreads);
+			BatchUnpacker<false> batch(pool);
+			std::vector<u64>	 results;
+
+			const Result& result = benchmark_.Run("SmallMessages", "Default", "BatchDecode", msgs.second, [&]()
+			{
+				batch.Unpack(msgs, [](Unpacker<false>& unpacker_) { return UnpackMessage(unpacker_); }, results);
+				sink = sink + results.back();
+			}, numThreads);
+
+			printf("%-14s %.2f[M messages/s]\n", "", (NumMessages / result.ns.median) * 1e3);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace MSGPack;
+
+	const char* jsonPath = nullptr;
+	u32			warmups	 = 3;
+	u32			samples	 = 15;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--json") && (i + 1) < argc)
+		{
+			jsonPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--warmups") && (i + 1) < argc)
+		{
+			warmups = (u32)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--samples") && (i + 1) < argc)
+		{
+			samples = (u32)strtoul(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			printf("Usage: %s [--json <path>] [--warmups <n>] [--samples <n>]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	printf("Running MSGPack benchmarks with %u warm-ups and %u samples...\n\n", warmups, samples);
+
+	// Samples of at least 2ms, so that steady_clock's resolution doesn't matter
+	Benchmark benchmark(warmups, samples, 2e6);
+	Benchmark::PrintHeader();
+
+	{
+		Packer<std::numeric_limits<u32>::max(), false> packer;
+		RunConfig<false, false>(benchmark, "Default", packer);
+	}
+
+	{
+		Packer<std::numeric_limits<u32>::max(), true> packer;
+		RunConfig<true, false>(benchmark, "Secure", packer);
+	}
+
+	{
+		Packer<std::numeric_limits<u32>::max(), false, true> packer;
+		RunConfig<false, true>(benchmark, "Local", packer);
+	}
+
+	{
+		// Too big for the stack
+		std::unique_ptr<Packer<FixedSize, false>> packer(new Packer<FixedSize, false>());
+		RunConfig<false, false>(benchmark, "Fixed", *packer);
+	}
+
+	RunDecodeModes(benchmark);
+	RunBatches(benchmark);
+
+	if (jsonPath)
+	{
+		if (!benchmark.WriteJson(jsonPath))
+		{
+			printf("\nCouldn't write results to %s\n", jsonPath);
+			return -1;
+		}
+
+		printf("\nResults written to %s\n", jsonPath);
+	}
+
+	return 0;
+}
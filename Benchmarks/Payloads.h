@@ -0,0 +1,433 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "PackerBase.h"
+#include "UnpackerBase.h"
+
+namespace MSGPack
+{
+	/*
+	*	Shapes of message that stress different parts of packing and unpacking.
+	*	Each is roughly 0.5-2MB, so that one op is long enough to time but the
+	*	message still mostly fits in cache.
+	*/
+	enum Payload : u8
+	{
+		SmallInts	  = 0, // Fixints and 1-2 byte ints, where per-element overhead dominates
+		LongStrings	  = 1, // Where copying dominates
+		DeepNesting	  = 2, // Chains of arrays/maps 32 deep
+		WideMaps	  = 3, // One map of many string keys
+		LargeBinaries = 4, // Few, large blobs
+		NumericArrays = 5, // Arrays of floats and ints, packed with PackArray()
+		Mixed		  = 6, // Cycles through most types and every number width
+		NumPayloads
+	};
+
+	static const char* const PayloadNames[Payload::NumPayloads] =
+	{
+		"SmallInts",
+		"LongStrings",
+		"DeepNesting",
+		"WideMaps",
+		"LargeBinaries",
+		"NumericArrays",
+		"Mixed"
+	};
+
+	/// Packs a message of the shape payload_
+	template <typename T>
+	void PackPayload(const Payload payload_, PackerBase<T>& packer_);
+
+	/// Returns a sum of the size_ bytes at data_, so that decoding a string/binary reads it as a copy would,
+	/// rather than only taking a pointer to it
+	u64 Checksum(const void* data_, const u64 size_);
+
+	/// Unpacks any single element, dispatching on PeekType() as a schema-less reader would. Returns a sum of
+	/// what was unpacked
+	template <typename S>
+	u64 UnpackElement(UnpackerBase<S>& unpacker_);
+
+	/// Packs numMessages_ small messages one after another, as a queue of orders would hold
+	template <typename T>
+	void PackMessages(PackerBase<T>& packer_, const u32 numMessages_);
+
+	/// Unpacks a message packed by PackMessages()
+	template <typename S>
+	u64 UnpackMessage(UnpackerBase<S>& unpacker_);
+
+	inline u64 Checksum(const void* data_, const u64 size_)
+	{
+		const u8* const bytes = (const u8*)data_;
+		u64				total = 0;
+		u64				i	  = 0;
+
+		// A word at a time, memcpy'd as the bytes needn't be aligned
+		for (; (i + sizeof(u64)) <= size_; i += sizeof(u64))
+		{
+			u64 word;
+			memcpy(&word, bytes + i, sizeof(u64));
+			total += word;
+		}
+
+		for (; i < size_; ++i)
+		{
+			total += bytes[i];
+		}
+
+		return total;
+	}
+
+	template <typename T>
+	void PackPayload(const Payload payload_, PackerBase<T>& packer_)
+	{
+		switch (payload_)
+		{
+			case Payload::SmallInts:
+			{
+				packer_.StartArray(1 << 18);
+				for (u32 i = 0; i < (1 << 18); ++i)
+				{
+					packer_.PackNumber((u32)((i % 3) ? (i & 0x7f) : (i & 0xfff)));
+				}
+				packer_.EndArray();
+				break;
+			}
+
+			case Payload::LongStrings:
+			{
+				std::string str(1024, 'x');
+
+				packer_.StartArray(1024);
+				for (u32 i = 0; i < 1024; ++i)
+				{
+					str[i] = 'a' + (i % 26);
+					packer_.PackString(str.data(), (u32)str.size());
+				}
+				packer_.EndArray();
+				break;
+			}
+
+			case Payload::DeepNesting:
+			{
+				packer_.StartArray(4096);
+				for (u32 i = 0; i < 4096; ++i)
+				{
+					for (u32 depth = 0; depth < 32; ++depth)
+					{
+						if (depth % 2)
+						{
+							packer_.StartMap(1);
+							packer_.PackString("child");
+						}
+						else
+						{
+							packer_.StartArray(1);
+						}
+					}
+
+					packer_.PackNumber(i);
+
+					for (u32 depth = 32; depth-- > 0;)
+					{
+						if (depth % 2)
+						{
+							packer_.EndMap();
+						}
+						else
+						{
+							packer_.EndArray();
+						}
+					}
+				}
+				packer_.EndArray();
+				break;
+			}
+
+			case Payload::WideMaps:
+			{
+				char key[16];
+
+				packer_.StartMap(1 << 15);
+				for (u32 i = 0; i < (1 << 15); ++i)
+				{
+					snprintf(key, sizeof(key), "key%05u", i);
+					packer_.PackString(key);
+
+					if (i % 2)
+					{
+						packer_.PackString("value");
+					}
+					else
+					{
+						packer_.PackNumber(i);
+					}
+				}
+				packer_.EndMap();
+				break;
+			}
+
+			case Payload::LargeBinaries:
+			{
+				std::vector<u8> blob(1 << 16);
+				for (u32 i = 0; i < blob.size(); ++i)
+				{
+					blob[i] = (u8)i;
+				}
+
+				packer_.StartArray(16);
+				for (u32 i = 0; i < 16; ++i)
+				{
+					packer_.PackBinary(blob.data(), (u32)blob.size());
+				}
+				packer_.EndArray();
+				break;
+			}
+
+			case Payload::NumericArrays:
+			{
+				std::vector<f64> floats(1 << 16);
+				std::vector<u32> ints(1 << 16);
+				for (u32 i = 0; i < floats.size(); ++i)
+				{
+					floats[i] = (f64)i * 0.25;
+					ints[i]	  = i * 7;
+				}
+
+				packer_.StartArray(2);
+				packer_.PackArray(floats.data(), (u32)floats.size());
+				packer_.PackArray(ints.data(), (u32)ints.size());
+				packer_.EndArray();
+				break;
+			}
+
+			case Payload::Mixed:
+			{
+				packer_.StartArray(1 << 18);
+				for (u32 i = 0; i < (1 << 18); ++i)
+				{
+					switch (i % 12)
+					{
+						case 0:
+						{
+							packer_.PackNumber((u32)(i & 0x7f));
+							break;
+						}
+
+						case 1:
+						{
+							packer_.PackNumber((u32)(0x80 | (i & 0x7f)));
+							break;
+						}
+
+						case 2:
+						{
+							packer_.PackNumber((u32)(0x100 + i));
+							break;
+						}
+
+						case 3:
+						{
+							packer_.PackNumber((u64)0x100000000 + i);
+							break;
+						}
+
+						case 4:
+						{
+							packer_.PackNumber((i32)-(i32)(i & 0x1f) - 1);
+							break;
+						}
+
+						case 5:
+						{
+							packer_.PackNumber((i32)-1000 - (i32)(i & 0xff));
+							break;
+						}
+
+						case 6:
+						{
+							packer_.PackNumber((i64)-5000000000 - i);
+							break;
+						}
+
+						case 7:
+						{
+							packer_.PackNumber((f32)i * 0.5f);
+							break;
+						}
+
+						case 8:
+						{
+							packer_.PackNumber((f64)i * 0.25);
+							break;
+						}
+
+						case 9:
+						{
+							packer_.PackString("short");
+							break;
+						}
+
+						case 10:
+						{
+							packer_.PackString("a string that is too long to be packed as a FixString");
+							break;
+						}
+
+						default:
+						{
+							packer_.PackBool(i & 1);
+							break;
+						}
+					}
+				}
+				packer_.EndArray();
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+	}
+
+	template <typename S>
+	u64 UnpackElement(UnpackerBase<S>& unpacker_)
+	{
+		u64 total = 0;
+
+		switch (unpacker_.PeekType())
+		{
+			case Nil:
+			{
+				unpacker_.UnpackNil();
+				break;
+			}
+
+			case BoolFalse:
+			case BoolTrue:
+			{
+				total += unpacker_.UnpackBool();
+				break;
+			}
+
+			case FixString:
+			case String8:
+			case String16:
+			case String32:
+			{
+				const std::string_view str = unpacker_.UnpackString();
+				total += Checksum(str.data(), str.size());
+				break;
+			}
+
+			case Bin8:
+			case Bin16:
+			case Bin32:
+			{
+				const std::pair<void*, u32> bin = unpacker_.UnpackBinary();
+				total += Checksum(bin.first, bin.second);
+				break;
+			}
+
+			case FixExt1:
+			case FixExt2:
+			case FixExt4:
+			case FixExt8:
+			case FixExt16:
+			case Ext8:
+			case Ext16:
+			case Ext32:
+			{
+				const std::tuple<i32, void*, u32> ext = unpacker_.UnpackExt();
+				total += Checksum(std::get<1>(ext), std::get<2>(ext));
+				break;
+			}
+
+			case FixArr:
+			case Arr16:
+			case Arr32:
+			{
+				const u32 numItems = unpacker_.UnpackArray();
+				for (u32 i = 0; i < numItems; ++i)
+				{
+					total += UnpackElement(unpacker_);
+				}
+				break;
+			}
+
+			case FixMap:
+			case Map16:
+			case Map32:
+			{
+				const u32 numPairs = unpacker_.UnpackMap();
+				for (u32 i = 0; i < numPairs; ++i)
+				{
+					total += UnpackElement(unpacker_);
+					total += UnpackElement(unpacker_);
+				}
+				break;
+			}
+
+			case Float32:
+			case Float64:
+			{
+				total += (u64)unpacker_.template UnpackNumber<f64>();
+				break;
+			}
+
+			default:
+			{
+				total += (u64)unpacker_.template UnpackNumber<i64>();
+				break;
+			}
+		}
+
+		return total;
+	}
+
+	template <typename T>
+	void PackMessages(PackerBase<T>& packer_, const u32 numMessages_)
+	{
+		for (u32 i = 0; i < numMessages_; ++i)
+		{
+			packer_.StartMap(4);
+			packer_.PackString("id");
+			packer_.PackNumber(i);
+			packer_.PackString("symbol");
+			packer_.PackString("MSGP");
+			packer_.PackString("price");
+			packer_.PackNumber((f64)i * 0.01);
+			packer_.PackString("quantity");
+			packer_.PackNumber((u32)(i & 0xfff));
+			packer_.EndMap();
+		}
+	}
+
+	template <typename S>
+	u64 UnpackMessage(UnpackerBase<S>& unpacker_)
+	{
+		u64 total = 0;
+
+		const u32 numPairs = unpacker_.UnpackMap();
+		for (u32 i = 0; i < numPairs; ++i)
+		{
+			total += unpacker_.UnpackString().size();
+			if (unpacker_.PeekType() == FixString)
+			{
+				total += unpacker_.UnpackString().size();
+			}
+			else
+			{
+				total += (u64)unpacker_.template UnpackNumber<f64>();
+			}
+		}
+
+		return total;
+	}
+}
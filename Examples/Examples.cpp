@@ -58,35 +58,36 @@ namespace MSGPack
 		packer.PackBinary(binaryBlob.data(), binaryBlob.size());
 
 		Unpacker<> unpacker(packer.Message());
-		const std::pair<char*, u32> myMapStr = unpacker.UnpackString();
-		const u32 mapSz						 = unpacker.UnpackMap();
+		const std::string_view myMapStr = unpacker.UnpackString();
+		const u32 mapSz					= unpacker.UnpackMap();
 		for (u32 i = 0; i < mapSz; ++i)
 		{
-			const std::pair<char*, u32> buff = unpacker.UnpackString();
+			const std::string_view buff = unpacker.UnpackString();
 
-			if (!strcmp(buff.first, "hello"))
+			if (buff == "hello")
 			{
-				const std::pair<char*, u32> world = unpacker.UnpackString();
+				const std::string_view world = unpacker.UnpackString();
 			}
-			else if (!strcmp(buff.first, "mynum"))
+			else if (buff == "mynum")
 			{
 				const u32 mynum = unpacker.UnpackNumber<u32>();
 			}
 			else
 			{
-				// Error
+				// Unknown key. Move over its value, whatever it is
+				unpacker.Skip();
 			}
 		}
 
-		const std::pair<char*, u32> myArrayStr = unpacker.UnpackString();
-		const u32 arrSz						   = unpacker.UnpackArray();
+		const std::string_view myArrayStr = unpacker.UnpackString();
+		const u32 arrSz					  = unpacker.UnpackArray();
 		for (u32 i = 0; i < arrSz; ++i)
 		{
 			const u32 num = unpacker.UnpackNumber<u32>();
 		}
 
-		const std::pair<char*, u32> simple	= unpacker.UnpackString();
-		const std::pair<char*, u32> types	= unpacker.UnpackString();
+		const std::string_view simple		= unpacker.UnpackString();
+		const std::string_view types		= unpacker.UnpackString();
 		const u32 n0						= unpacker.UnpackNumber<u32>();
 		const u32 n1						= unpacker.UnpackNumber<u32>();
 		const u32 n2						= unpacker.UnpackNumber<u32>();
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Literals.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+namespace MSGPack
+{
+	/*
+	*	Bump allocator. Allocations are carved one after another out of large
+	*	blocks and are never freed on their own; Clear() frees everything at
+	*	once. Sized up front with Reserve(), e.g. from the length of a message,
+	*	a whole document takes a single block.
+	*/
+	class Arena
+	{
+	public:
+		/// blockSize_ is the size of the first block allocated. Each block after is at least twice the last
+		Arena(const u64 blockSize_ = 4096);
+
+		/// Returns size_ bytes aligned to align_ (a power of 2), valid until Clear()
+		void* Allocate(const u64 size_, const u64 align_ = alignof(std::max_align_t));
+
+		/// Returns num_ default-constructed T, valid until Clear(). T must not need destroying
+		template <typename T>
+		T* Allocate(const u64 num_);
+
+		/// Makes sure the next size_ bytes come from the current block
+		void Reserve(const u64 size_);
+
+		/// Frees everything allocated. The current block is kept for reuse
+		void Clear();
+
+		/// Returns the number of bytes allocated from blocks since Clear(), including alignment
+		u64 Used() const;
+
+	private:
+		std::vector<std::unique_ptr<u8[]>> blocks;
+		u64								   blockSize;
+
+		u64 capacity; // Of the current block, i.e. blocks.back()
+		u64 offset;	  // Into the current block
+		u64 used;	  // By earlier blocks, since Clear()
+
+		/// Starts a new block of at least size_ bytes
+		void NewBlock(const u64 size_);
+	};
+
+	/*
+	*	Public
+	*/
+
+	inline Arena::Arena(const u64 blockSize_) :
+						blockSize(blockSize_),
+						capacity(0),
+						offset(0),
+						used(0)
+	{
+	}
+
+	inline void* Arena::Allocate(const u64 size_, const u64 align_)
+	{
+		u64 start = (offset + (align_ - 1)) & ~(align_ - 1);
+		if (blocks.empty() || (start + size_) > capacity)
+		{
+			// Blocks come from new[], so are aligned for anything
+			NewBlock(size_);
+			start = 0;
+		}
+
+		offset = start + size_;
+		return blocks.back().get() + start;
+	}
+
+	template <typename T>
+	T* Arena::Allocate(const u64 num_)
+	{
+		T* const ptr = (T*)Allocate(sizeof(T) * num_, alignof(T));
+		for (u64 i = 0; i < num_; ++i)
+		{
+			new (ptr + i) T();
+		}
+
+		return ptr;
+	}
+
+	inline void Arena::Reserve(const u64 size_)
+	{
+		if (blocks.empty() || (capacity - offset) < size_)
+		{
+			NewBlock(size_);
+		}
+	}
+
+	inline void Arena::Clear()
+	{
+		// O(1) for the usual single block
+		if (blocks.size() > 1)
+		{
+			std::swap(blocks.front(), blocks.back());
+			blocks.resize(1);
+		}
+
+		offset = 0;
+		used   = 0;
+	}
+
+	inline u64 Arena::Used() const
+	{
+		return (used + offset);
+	}
+
+	/*
+	*	Private
+	*/
+
+	inline void Arena::NewBlock(const u64 size_)
+	{
+		used += offset;
+
+		// Doubling, so that an Arena sized too small still takes few blocks. Uninitialised, so that pages
+		// never allocated from are never touched
+		capacity = std::max(size_, std::max(blockSize, capacity * 2));
+		offset	 = 0;
+		blocks.emplace_back(new u8[capacity]);
+	}
+}
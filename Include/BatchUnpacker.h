@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Literals.h"
+#include "Defines.h"
+#include "Unpacker.h"
+#include "Framer.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+
+namespace MSGPack
+{
+	/*
+	*	Decodes many small messages at once across the threads of a pool. The
+	*	messages are either concatenated in one buffer, which is split up by a
+	*	Framer reading headers only, or given as a list of spans. They are then
+	*	handed out to the pool in runs of grain_, where each is given to the
+	*	handler in an Unpacker of its own:
+	*
+	*		WorkStealingPool			   pool;
+	*		BatchUnpacker<>				   batch(pool);
+	*		std::vector<Order>			   orders;
+	*		batch.Unpack(received, [](Unpacker<>& unpacker_) { return Order(unpacker_); }, orders);
+	*
+	*	orders[i] is always the result for message i, whatever thread ran it, so
+	*	results come out in the order the messages came in. The handler may be
+	*	called concurrently, and anything it throws is rethrown by Unpack().
+	*
+	*	Secure	 := Passed on to the Framer and each Unpacker.
+	*
+	*	Local	 := Lengths and counts are stored in host byte order. Must match
+	*				the Local parameter of the Packer that produced the data.
+	*
+	*	Executor := Runs the batches. Held by reference. See WorkStealingPool.
+	*/
+	template <bool	   Secure	= SecureBase,
+			  bool	   Local	= false,
+			  typename Executor = WorkStealingPool>
+	class BatchUnpacker
+	{
+	public:
+		/// grain_ messages are decoded per task, to keep the cost of handing out each one small
+		BatchUnpacker(Executor& executor_, const u64 grain_ = 64);
+
+		/// Decodes every complete message in memBlock_. results_ is resized to one result of handler_(Unpacker<Secure,
+		/// Local>&) per message, in order. Returns the number of bytes covered, as Framer::Split()
+		template <typename F, typename R>
+		u64 Unpack(const std::pair<void*, u64>& memBlock_, F&& handler_, std::vector<R>& results_);
+
+		/// As above for a list of messages, one element each
+		template <typename F, typename R>
+		void Unpack(const std::vector<std::pair<void*, u64>>& messages_, F&& handler_, std::vector<R>& results_);
+
+	private:
+		Executor& executor;
+		u64		  grain;
+
+		// Kept between calls, so that their memory is reused
+		std::vector<u64>				   lengths;
+		std::vector<std::pair<void*, u64>> spans;
+		std::vector<std::function<void()>> tasks;
+	};
+
+	/*
+	*	Public
+	*/
+
+	template <bool Secure, bool Local, typename Executor>
+	BatchUnpacker<Secure, Local, Executor>::BatchUnpacker(Executor& executor_, const u64 grain_) :
+											executor(executor_),
+											grain(std::max<u64>(grain_, 1))
+	{
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	template <typename F, typename R>
+	u64 BatchUnpacker<Secure, Local, Executor>::Unpack(const std::pair<void*, u64>& memBlock_, F&& handler_, std::vector<R>& results_)
+	{
+		lengths.clear();
+		const u64 covered = Framer<Secure, Local>().Split(memBlock_, lengths);
+
+		spans.clear();
+		spans.reserve(lengths.size());
+
+		u8* ptr = (u8*)memBlock_.first;
+		for (const u64 length : lengths)
+		{
+			spans.emplace_back(ptr, length);
+			ptr += length;
+		}
+
+		Unpack(spans, handler_, results_);
+		return covered;
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	template <typename F, typename R>
+	void BatchUnpacker<Secure, Local, Executor>::Unpack(const std::vector<std::pair<void*, u64>>& messages_, F&& handler_, std::vector<R>& results_)
+	{
+		static_assert(!std::is_same_v<R, bool>, "std::vector<bool> can't be written from several threads!");
+
+		results_.resize(messages_.size());
+
+		tasks.clear();
+		for (u64 begin = 0; begin < messages_.size(); begin += grain)
+		{
+			const u64 end = std::min<u64>(begin + grain, messages_.size());
+
+			// Each result is written by exactly one task, so none need locking
+			tasks.emplace_back([&messages_, &handler_, &results_, begin, end]()
+			{
+				Unpacker<Secure, Local> unpacker;
+				for (u64 i = begin; i < end; ++i)
+				{
+					unpacker.Set(messages_[i]);
+					results_[i] = handler_(unpacker);
+				}
+			});
+		}
+
+		executor(tasks);
+	}
+}
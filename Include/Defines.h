@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Literals.h"
+
 #if defined(_WINDOWS)
 	#define NOMINMAX
 	#include "winsock2.h"
@@ -7,8 +9,14 @@
 #else
 	#if defined(__linux__)
 		#include <endian.h>
+		#define betoh16(x) be16toh(x)
+		#define betoh32(x) be32toh(x)
+		#define betoh64(x) be64toh(x)
 	#elif defined(__FreeBSD__) || defined(__NetBSD__)
 		#include <sys/endian.h>
+		#define betoh16(x) be16toh(x)
+		#define betoh32(x) be32toh(x)
+		#define betoh64(x) be64toh(x)
 	#elif defined(__OpenBSD__)
 		#include <sys/types.h>
 		#define hto16be(x) htobe16(x)
@@ -27,4 +35,15 @@ namespace MSGPack
 	#else
 		static constexpr const bool SecureBase = false;
 	#endif
+
+	/// Define MSGPACK_PACK_NUL as 1 to pack every string with its NUL as part of it, for messages read by versions
+	/// that relied on it. Other MSGPack implementations see the NUL as part of the string
+	#if defined(MSGPACK_PACK_NUL) && MSGPACK_PACK_NUL
+		static constexpr const bool PackNulBase = true;
+	#else
+		static constexpr const bool PackNulBase = false;
+	#endif
+
+	/// Deepest nesting of arrays/maps accepted where Secure checks are made
+	static constexpr const u32 MaxDepthBase = 128;
 }
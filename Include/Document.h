@@ -0,0 +1,831 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "Layout.h"
+#include "Arena.h"
+#include "PackerBase.h"
+#include "Unpacker.h"
+
+#include <cassert>
+#include <vector>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+namespace MSGPack
+{
+	/*
+	*	What a Value holds
+	*/
+	enum class ValueType : u8
+	{
+		Nil,
+		Bool,
+		UInt,
+		Int, // Negative only. Positive integers are UInt
+		Float,
+		String,
+		Binary,
+		Ext,
+		Array,
+		Map
+	};
+
+	/*
+	*	One node of a Document. Arrays/maps hold their elements in one run, so
+	*	items are found in O(1) and map keys by a linear scan. Values can be read
+	*	and set in place; anything that needs memory (strings that must be copied,
+	*	new array/map elements) goes through the Document that owns the Value.
+	*
+	*	Strings, binaries and exts point into the parsed message unless the
+	*	Document copied them. References to the elements of an array/map are
+	*	invalidated when it grows, as with std::vector.
+	*/
+	struct Value
+	{
+	public:
+		/// Returns what the value holds
+		ValueType Type() const;
+
+		/// Returns true if the value is of type_
+		bool Is(const ValueType type_) const;
+
+		/// Returns the bool, or false if not a Bool
+		bool AsBool() const;
+
+		/// Returns the number as a T, whichever of UInt/Int/Float it is. 0 if not a number
+		template <typename T>
+		T AsNumber() const;
+
+		/// Returns the string, or an empty one if not a String
+		std::string_view AsString() const;
+
+		/// Returns a ptr to the binary blob and its size, or nullptr if not a Binary
+		std::pair<const u8*, u32> AsBinary() const;
+
+		/// Returns the ext type, ptr and size, or nullptr if not an Ext
+		std::tuple<i32, const u8*, u32> AsExt() const;
+
+		/// Returns the number of items of an array, key : value pairs of a map or bytes of a string/binary/ext
+		u32 Size() const;
+
+		/// Returns item i_ of an array, which must be < Size()
+		Value&		 operator[](const u32 i_);
+		const Value& operator[](const u32 i_) const;
+
+		/// Returns the key of pair i_ of a map, which must be < Size()
+		Value&		 KeyAt(const u32 i_);
+		const Value& KeyAt(const u32 i_) const;
+
+		/// Returns the value of pair i_ of a map, which must be < Size()
+		Value&		 ValueAt(const u32 i_);
+		const Value& ValueAt(const u32 i_) const;
+
+		/// Returns the value for the first string key equal to key_ in a map, or nullptr
+		Value*		 Find(const std::string_view key_);
+		const Value* Find(const std::string_view key_) const;
+
+		void SetNil();
+		void SetBool(const bool val_);
+
+		/// Stored as a Float for floating-point T, as an Int for negative values and as a UInt otherwise
+		template <typename T>
+		void SetNumber(const T val_);
+
+		/// Not copied, so val_ must outlive the value. See Document::SetString() otherwise
+		void SetString(const std::string_view val_);
+
+	private:
+		template <bool Secure, bool Local>
+		friend class Document;
+
+		ValueType type = ValueType::Nil;
+		u32		  size = 0; // Items of an array, pairs of a map, bytes of a string/binary/ext or width of a float
+
+		// Array/map elements allocated, or the type of an ext
+		union
+		{
+			u32 capacity = 0;
+			i32 extType;
+		};
+
+		union
+		{
+			bool		b;
+			u64			u;
+			i64			i;
+			f64			f;
+			const char* str;
+			const u8*	bin;
+			Value*		items; // Arrays: size items. Maps: size keys, each followed by its value
+		};
+	};
+
+	/*
+	*	Tree of Values parsed from a packed message in a single pass, for random
+	*	access and modification, and packed back out with Pack(). Every node,
+	*	array/map and copied string is allocated from an Arena that is sized from
+	*	a few times the length of the message, so parsing usually takes a single
+	*	allocation, and the whole tree is freed at once.
+	*
+	*	Secure := Parse() throws on malformed data rather than returning false and
+	*			  limits nesting to MaxDepthBase. Bounds are checked either way.
+	*
+	*	Local  := Lengths and counts are stored in host byte order. Must match
+	*			  the Local parameter of the Packer that produced the data.
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class Document
+	{
+	public:
+		Document();
+
+		/// Replaces the tree with the single element packed in memBlock_. Unless copyStrings_, strings,
+		/// binaries and exts point into memBlock_, which must then outlive the Document. Returns false,
+		/// leaving the Document empty, if memBlock_ isn't exactly one complete, valid element
+		bool Parse(const std::pair<void*, u64>& memBlock_, const bool copyStrings_ = false);
+
+		/// Returns the top-level value. Nil when empty
+		Value&		 Root();
+		const Value& Root() const;
+
+		/// Frees every Value at once, leaving the Document empty
+		void Clear();
+
+		/// Makes val_ an empty array/map with room for capacity_ items/pairs
+		void SetArray(Value& val_, const u32 capacity_ = 0);
+		void SetMap(Value& val_, const u32 capacity_ = 0);
+
+		/// Copies val_ into the Document and points val_ at the copy
+		void SetString(Value& val_, const std::string_view str_);
+		void SetBinary(Value& val_, const u8* const data_, const u32 len_);
+
+		/// Adds a Nil item to the end of array_ and returns it
+		Value& Append(Value& array_);
+
+		/// Returns the value for string key key_ in map_, adding a pair with a copy of key_ and a Nil value if
+		/// there isn't one
+		Value& Insert(Value& map_, const std::string_view key_);
+
+		/// Packs the tree as a single element. Arrays/maps are packed count-known
+		template <typename T>
+		void Pack(PackerBase<T>& packer_) const;
+
+	private:
+		Arena arena;
+		Value root;
+
+		/// Arrays/maps still being parsed or packed
+		struct Open
+		{
+			Value* items; // Of the array/map
+			u64	   next;  // Index into items
+			u64	   count; // Of items: 2 per map pair
+			bool   map;
+		};
+
+		/// Returns false, or throws when Secure
+		bool Fail(const char* reason_);
+
+		/// Copies size_ bytes into the Arena
+		const u8* Copy(const void* data_, const u64 size_);
+
+		/// Makes room for num_ more Values in the array/map val_. Returns the first
+		Value* Grow(Value& val_, const u32 num_);
+	};
+
+	/*
+	*	Value
+	*/
+
+	inline ValueType Value::Type() const
+	{
+		return type;
+	}
+
+	inline bool Value::Is(const ValueType type_) const
+	{
+		return (type == type_);
+	}
+
+	inline bool Value::AsBool() const
+	{
+		return (type == ValueType::Bool && b);
+	}
+
+	template <typename T>
+	T Value::AsNumber() const
+	{
+		switch (type)
+		{
+			case ValueType::UInt:
+			{
+				return (T)u;
+			}
+
+			case ValueType::Int:
+			{
+				return (T)i;
+			}
+
+			case ValueType::Float:
+			{
+				return (T)f;
+			}
+
+			default:
+			{
+				return (T)0;
+			}
+		}
+	}
+
+	inline std::string_view Value::AsString() const
+	{
+		return (type == ValueType::String) ? std::string_view(str, size) : std::string_view();
+	}
+
+	inline std::pair<const u8*, u32> Value::AsBinary() const
+	{
+		return (type == ValueType::Binary) ? std::pair<const u8*, u32>(bin, size) : std::pair<const u8*, u32>(nullptr, 0);
+	}
+
+	inline std::tuple<i32, const u8*, u32> Value::AsExt() const
+	{
+		return (type == ValueType::Ext) ? std::tuple<i32, const u8*, u32>(extType, bin, size) : std::tuple<i32, const u8*, u32>(0, nullptr, 0);
+	}
+
+	inline u32 Value::Size() const
+	{
+		switch (type)
+		{
+			case ValueType::String:
+			case ValueType::Binary:
+			case ValueType::Ext:
+			case ValueType::Array:
+			case ValueType::Map:
+			{
+				return size;
+			}
+
+			default:
+			{
+				return 0;
+			}
+		}
+	}
+
+	inline Value& Value::operator[](const u32 i_)
+	{
+		assert(type == ValueType::Array && i_ < size);
+		return items[i_];
+	}
+
+	inline const Value& Value::operator[](const u32 i_) const
+	{
+		assert(type == ValueType::Array && i_ < size);
+		return items[i_];
+	}
+
+	inline Value& Value::KeyAt(const u32 i_)
+	{
+		assert(type == ValueType::Map && i_ < size);
+		return items[(u64)i_ * 2];
+	}
+
+	inline const Value& Value::KeyAt(const u32 i_) const
+	{
+		assert(type == ValueType::Map && i_ < size);
+		return items[(u64)i_ * 2];
+	}
+
+	inline Value& Value::ValueAt(const u32 i_)
+	{
+		assert(type == ValueType::Map && i_ < size);
+		return items[((u64)i_ * 2) + 1];
+	}
+
+	inline const Value& Value::ValueAt(const u32 i_) const
+	{
+		assert(type == ValueType::Map && i_ < size);
+		return items[((u64)i_ * 2) + 1];
+	}
+
+	inline Value* Value::Find(const std::string_view key_)
+	{
+		return const_cast<Value*>(static_cast<const Value&>(*this).Find(key_));
+	}
+
+	inline const Value* Value::Find(const std::string_view key_) const
+	{
+		if (type != ValueType::Map)
+		{
+			return nullptr;
+		}
+
+		for (u32 i = 0; i < size; ++i)
+		{
+			const Value& key = items[(u64)i * 2];
+			if (key.type == ValueType::String && key.AsString() == key_)
+			{
+				return &items[((u64)i * 2) + 1];
+			}
+		}
+
+		return nullptr;
+	}
+
+	inline void Value::SetNil()
+	{
+		type = ValueType::Nil;
+		size = 0;
+	}
+
+	inline void Value::SetBool(const bool val_)
+	{
+		type = ValueType::Bool;
+		size = 0;
+		b	 = val_;
+	}
+
+	template <typename T>
+	void Value::SetNumber(const T val_)
+	{
+		static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "Only numbers can be set!");
+
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			// The width is kept so that a Float32 packs back as one
+			type = ValueType::Float;
+			size = sizeof(T);
+			f	 = (f64)val_;
+		}
+		else if (std::is_signed_v<T> && val_ < 0)
+		{
+			type = ValueType::Int;
+			size = 0;
+			i	 = (i64)val_;
+		}
+		else
+		{
+			type = ValueType::UInt;
+			size = 0;
+			u	 = (u64)val_;
+		}
+	}
+
+	inline void Value::SetString(const std::string_view val_)
+	{
+		type = ValueType::String;
+		size = (u32)val_.size();
+		str	 = val_.data();
+	}
+
+	/*
+	*	Document Public
+	*/
+
+	template <bool Secure, bool Local>
+	Document<Secure, Local>::Document() :
+								 arena(),
+								 root()
+	{
+	}
+
+	template <bool Secure, bool Local>
+	bool Document<Secure, Local>::Parse(const std::pair<void*, u64>& memBlock_, const bool copyStrings_)
+	{
+		Clear();
+
+		const u8* const blockPtr  = (const u8*)memBlock_.first;
+		const u64		blockSize = memBlock_.second;
+
+		// Reserving a Value per byte, the most there can be, would take sizeof(Value) times the message.
+		// Most elements are several bytes, so a few times the message usually holds the whole tree, and
+		// the Arena doubles from there if not. Strings copied are no longer than the message
+		arena.Reserve((blockSize * 4) + (copyStrings_ ? blockSize : 0));
+
+		// Bounds are checked here, as in Tape, so the Unpacker needn't check again
+		Unpacker<false, Local> unpacker(memBlock_);
+
+		std::vector<Open> open;
+		Value*			  val = &root;
+
+		while (true)
+		{
+			const u64 pos = unpacker.Tell();
+			if (pos >= blockSize)
+			{
+				return Fail("Incomplete message found during Unpack!");
+			}
+
+			const ByteInfo& info = ByteTable[blockPtr[pos]];
+			if (!info.headerSize)
+			{
+				return Fail("Invalid ByteCode found during Unpack!");
+			}
+			else if ((blockSize - pos) < info.headerSize)
+			{
+				return Fail("Incomplete message found during Unpack!");
+			}
+
+			Layout layout;
+			LayoutReader<Local>::Read(blockPtr + pos, layout);
+
+			// Written to avoid overflow with hostile lengths. A count bigger than what's left is also caught
+			// here before any Values are allocated for it
+			const u64 left = blockSize - pos - layout.headerSize;
+			if (layout.payloadSize > left || layout.numChildren > left)
+			{
+				return Fail("Incomplete message found during Unpack!");
+			}
+			else if (layout.numChildren > std::numeric_limits<u32>::max())
+			{
+				// A map of more than 2^31 pairs, whose Values can't be counted in a u32
+				return Fail("Map too big found during Unpack!");
+			}
+
+			switch (info.typeClass)
+			{
+				case TypeClass::Nil:
+				{
+					unpacker.UnpackNil();
+					val->SetNil();
+					break;
+				}
+
+				case TypeClass::Bool:
+				{
+					val->SetBool(unpacker.UnpackBool());
+					break;
+				}
+
+				case TypeClass::Number:
+				{
+					switch (info.type)
+					{
+						case FixUInt8:
+						case UInt8:
+						case UInt16:
+						case UInt32:
+						case UInt64:
+						{
+							val->SetNumber(unpacker.template UnpackNumber<u64>());
+							break;
+						}
+
+						case Float32:
+						{
+							val->SetNumber(unpacker.template UnpackNumber<f32>());
+							break;
+						}
+
+						case Float64:
+						{
+							val->SetNumber(unpacker.template UnpackNumber<f64>());
+							break;
+						}
+
+						default:
+						{
+							val->SetNumber(unpacker.template UnpackNumber<i64>());
+							break;
+						}
+					}
+
+					break;
+				}
+
+				case TypeClass::String:
+				{
+					const std::string_view str = unpacker.UnpackString();
+					val->SetString(copyStrings_ ? std::string_view((const char*)Copy(str.data(), str.size()), str.size()) : str);
+					break;
+				}
+
+				case TypeClass::Binary:
+				{
+					const std::pair<void*, u32> bin = unpacker.UnpackBinary();
+
+					val->type = ValueType::Binary;
+					val->size = bin.second;
+					val->bin  = copyStrings_ ? Copy(bin.first, bin.second) : (const u8*)bin.first;
+					break;
+				}
+
+				case TypeClass::Ext:
+				{
+					const std::tuple<i32, void*, u32> ext = unpacker.UnpackExt();
+
+					val->type	 = ValueType::Ext;
+					val->extType = std::get<0>(ext);
+					val->size	 = std::get<2>(ext);
+					val->bin	 = copyStrings_ ? Copy(std::get<1>(ext), std::get<2>(ext)) : (const u8*)std::get<1>(ext);
+					break;
+				}
+
+				case TypeClass::Array:
+				{
+					SetArray(*val, unpacker.UnpackArray());
+					val->size = val->capacity;
+					break;
+				}
+
+				default:
+				{
+					SetMap(*val, unpacker.UnpackMap());
+					val->size = val->capacity / 2;
+					break;
+				}
+			}
+
+			if (layout.numChildren)
+			{
+				if constexpr (Secure)
+				{
+					if (open.size() == MaxDepthBase)
+					{
+						return Fail("Nesting deeper than MaxDepthBase found during Unpack!");
+					}
+				}
+
+				open.push_back({ val->items, 0, layout.numChildren, info.typeClass == TypeClass::Map });
+			}
+
+			// Close every array/map just completed. The next element fills the next slot of the innermost left
+			while (open.size() && open.back().next == open.back().count)
+			{
+				open.pop_back();
+			}
+
+			if (open.empty())
+			{
+				break;
+			}
+
+			val = &open.back().items[open.back().next++];
+		}
+
+		if (unpacker.Tell() != blockSize)
+		{
+			return Fail("More than one element found during Unpack!");
+		}
+
+		return true;
+	}
+
+	template <bool Secure, bool Local>
+	Value& Document<Secure, Local>::Root()
+	{
+		return root;
+	}
+
+	template <bool Secure, bool Local>
+	const Value& Document<Secure, Local>::Root() const
+	{
+		return root;
+	}
+
+	template <bool Secure, bool Local>
+	void Document<Secure, Local>::Clear()
+	{
+		arena.Clear();
+		root = Value();
+	}
+
+	template <bool Secure, bool Local>
+	void Document<Secure, Local>::SetArray(Value& val_, const u32 capacity_)
+	{
+		val_.type	  = ValueType::Array;
+		val_.size	  = 0;
+		val_.capacity = capacity_;
+		val_.items	  = capacity_ ? arena.template Allocate<Value>(capacity_) : nullptr;
+	}
+
+	template <bool Secure, bool Local>
+	void Document<Secure, Local>::SetMap(Value& val_, const u32 capacity_)
+	{
+		// Keys and values alternate
+		const u64 num = (u64)capacity_ * 2;
+		if (num > std::numeric_limits<u32>::max())
+		{
+			throw std::runtime_error("Map of more than 2^31 pairs in a Document!");
+		}
+
+		val_.type	  = ValueType::Map;
+		val_.size	  = 0;
+		val_.capacity = (u32)num;
+		val_.items	  = num ? arena.template Allocate<Value>(num) : nullptr;
+	}
+
+	template <bool Secure, bool Local>
+	void Document<Secure, Local>::SetString(Value& val_, const std::string_view str_)
+	{
+		val_.SetString(std::string_view((const char*)Copy(str_.data(), str_.size()), str_.size()));
+	}
+
+	template <bool Secure, bool Local>
+	void Document<Secure, Local>::SetBinary(Value& val_, const u8* const data_, const u32 len_)
+	{
+		val_.type = ValueType::Binary;
+		val_.size = len_;
+		val_.bin  = Copy(data_, len_);
+	}
+
+	template <bool Secure, bool Local>
+	Value& Document<Secure, Local>::Append(Value& array_)
+	{
+		assert(array_.type == ValueType::Array);
+
+		Value* const item = Grow(array_, 1);
+		array_.size++;
+
+		return *item;
+	}
+
+	template <bool Secure, bool Local>
+	Value& Document<Secure, Local>::Insert(Value& map_, const std::string_view key_)
+	{
+		assert(map_.type == ValueType::Map);
+
+		if (Value* const found = map_.Find(key_))
+		{
+			return *found;
+		}
+
+		Value* const pair = Grow(map_, 2);
+		map_.size++;
+
+		SetString(pair[0], key_);
+		return pair[1];
+	}
+
+	template <bool Secure, bool Local>
+	template <typename T>
+	void Document<Secure, Local>::Pack(PackerBase<T>& packer_) const
+	{
+		// No recursion, so a deep tree can't run out of stack
+		std::vector<Open> open;
+		const Value*	  val = &root;
+
+		while (true)
+		{
+			switch (val->type)
+			{
+				case ValueType::Nil:
+				{
+					packer_.PackNil();
+					break;
+				}
+
+				case ValueType::Bool:
+				{
+					packer_.PackBool(val->b);
+					break;
+				}
+
+				case ValueType::UInt:
+				{
+					packer_.PackNumber(val->u);
+					break;
+				}
+
+				case ValueType::Int:
+				{
+					packer_.PackNumber(val->i);
+					break;
+				}
+
+				case ValueType::Float:
+				{
+					if (val->size == sizeof(f32))
+					{
+						packer_.PackNumber((f32)val->f);
+					}
+					else
+					{
+						packer_.PackNumber(val->f);
+					}
+
+					break;
+				}
+
+				case ValueType::String:
+				{
+					packer_.PackString(val->str, val->size);
+					break;
+				}
+
+				case ValueType::Binary:
+				{
+					packer_.PackBinary(val->bin, val->size);
+					break;
+				}
+
+				case ValueType::Ext:
+				{
+					packer_.PackExt(val->extType, val->bin, val->size);
+					break;
+				}
+
+				case ValueType::Array:
+				{
+					packer_.StartArray(val->size);
+					open.push_back({ val->items, 0, val->size, false });
+					break;
+				}
+
+				default:
+				{
+					packer_.StartMap(val->size);
+					open.push_back({ val->items, 0, (u64)val->size * 2, true });
+					break;
+				}
+			}
+
+			while (open.size() && open.back().next == open.back().count)
+			{
+				if (open.back().map)
+				{
+					packer_.EndMap();
+				}
+				else
+				{
+					packer_.EndArray();
+				}
+
+				open.pop_back();
+			}
+
+			if (open.empty())
+			{
+				break;
+			}
+
+			val = &open.back().items[open.back().next++];
+		}
+	}
+
+	/*
+	*	Document Private
+	*/
+
+	template <bool Secure, bool Local>
+	bool Document<Secure, Local>::Fail(const char* reason_)
+	{
+		Clear();
+
+		if constexpr (Secure)
+		{
+			throw std::runtime_error(reason_);
+		}
+
+		return false;
+	}
+
+	template <bool Secure, bool Local>
+	const u8* Document<Secure, Local>::Copy(const void* data_, const u64 size_)
+	{
+		if (!size_)
+		{
+			return nullptr;
+		}
+
+		u8* const ptr = (u8*)arena.Allocate(size_, 1);
+		memcpy(ptr, data_, size_);
+
+		return ptr;
+	}
+
+	template <bool Secure, bool Local>
+	Value* Document<Secure, Local>::Grow(Value& val_, const u32 num_)
+	{
+		const u64 used = (val_.type == ValueType::Map) ? ((u64)val_.size * 2) : val_.size;
+		if ((used + num_) > val_.capacity)
+		{
+			if ((used + num_) > std::numeric_limits<u32>::max())
+			{
+				throw std::runtime_error("More than 2^32 Values in an array/map of a Document!");
+			}
+
+			// Doubling, as std::vector, up to what a u32 counts. The old run is left in the Arena until Clear()
+			const u64	 capacity = std::min<u64>(std::max<u64>(used + num_, std::max<u64>((u64)val_.capacity * 2, 4)),
+												  std::numeric_limits<u32>::max());
+			Value* const items	  = arena.template Allocate<Value>(capacity);
+			if (used)
+			{
+				memcpy((void*)items, val_.items, used * sizeof(Value));
+			}
+
+			val_.items	  = items;
+			val_.capacity = (u32)capacity;
+		}
+
+		return (val_.items + used);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Literals.h"
+
+#include <array>
+#include <cassert>
+
+namespace MSGPack
+{
+	/*
+	*	Stack of at most N elements held inline, so it never allocates. Has the
+	*	members of std::stack that Packer uses, so either can hold its open
+	*	arrays/maps. Going over N is checked by the caller, or asserted here.
+	*/
+	template <typename T, u32 N>
+	class FixedStack
+	{
+	public:
+		FixedStack();
+
+		u64	 size() const;
+		bool empty() const;
+
+		T&		 top();
+		const T& top() const;
+
+		void push(const T& val_);
+		void pop();
+
+	private:
+		std::array<T, N> elements;
+		u32				 depth;
+	};
+
+	/*
+	*	Public
+	*/
+
+	template <typename T, u32 N>
+	FixedStack<T, N>::FixedStack() :
+					  elements{},
+					  depth(0)
+	{
+	}
+
+	template <typename T, u32 N>
+	u64 FixedStack<T, N>::size() const
+	{
+		return depth;
+	}
+
+	template <typename T, u32 N>
+	bool FixedStack<T, N>::empty() const
+	{
+		return !depth;
+	}
+
+	template <typename T, u32 N>
+	T& FixedStack<T, N>::top()
+	{
+		assert(depth);
+		return elements[depth - 1];
+	}
+
+	template <typename T, u32 N>
+	const T& FixedStack<T, N>::top() const
+	{
+		assert(depth);
+		return elements[depth - 1];
+	}
+
+	template <typename T, u32 N>
+	void FixedStack<T, N>::push(const T& val_)
+	{
+		assert(depth < N);
+		elements[depth++] = val_;
+	}
+
+	template <typename T, u32 N>
+	void FixedStack<T, N>::pop()
+	{
+		assert(depth);
+		depth--;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "Layout.h"
+
+#include <vector>
+#include <limits>
+#include <stdexcept>
+
+namespace MSGPack
+{
+	/*
+	*	Finds where complete top-level elements end in a stream of concatenated messages
+	*	(e.g. from a pipe or socket) by reading headers only. String, binary and ext
+	*	payloads are skipped over by their length and arrays/maps by counting their
+	*	elements, so nothing is decoded and no schema is needed.
+	*
+	*	Secure := Throws on an invalid ByteCode rather than returning Invalid.
+	*
+	*	Local  := Lengths and counts are stored in host byte order. Must match
+	*			  the Local parameter of the Packer that produced the data.
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class Framer
+	{
+	public:
+		/// Returned by Next() when the data can't be MSGPack
+		static constexpr const u64 Invalid = std::numeric_limits<u64>::max();
+
+		/// Returns the length in bytes of the first top-level element in memBlock_, or 0 if memBlock_ ends
+		/// before it does
+		u64 Next(const std::pair<void*, u64>& memBlock_) const;
+
+		/// Appends the length of every complete top-level element in memBlock_ to lengths_. Returns the
+		/// number of bytes covered; anything after that is the start of an incomplete (or, when
+		/// Next() says so, Invalid) element
+		u64 Split(const std::pair<void*, u64>& memBlock_, std::vector<u64>& lengths_) const;
+	};
+
+	/*
+	*	Public
+	*/
+
+	template <bool Secure, bool Local>
+	u64 Framer<Secure, Local>::Next(const std::pair<void*, u64>& memBlock_) const
+	{
+		const u8* const ptr	 = (const u8*)memBlock_.first;
+		const u64		size = memBlock_.second;
+
+		// No recursion needed. Each element takes one off the count and adds its children
+		u64 pos		= 0;
+		u64 pending = 1;
+
+		while (pending)
+		{
+			if (pos >= size)
+			{
+				return 0;
+			}
+
+			const u64 headerSize = LayoutReader<Local>::HeaderSize(ptr[pos]);
+			if (!headerSize)
+			{
+				if constexpr (Secure)
+				{
+					throw std::runtime_error("Invalid ByteCode found during framing!");
+				}
+
+				return Invalid;
+			}
+			else if ((size - pos) < headerSize)
+			{
+				return 0;
+			}
+
+			Layout layout;
+			LayoutReader<Local>::Read(ptr + pos, layout);
+
+			// Written to avoid overflow with hostile lengths
+			if (layout.payloadSize > (size - pos - headerSize))
+			{
+				return 0;
+			}
+
+			pos		+= (headerSize + layout.payloadSize);
+			pending += layout.numChildren;
+			pending--;
+		}
+
+		return pos;
+	}
+
+	template <bool Secure, bool Local>
+	u64 Framer<Secure, Local>::Split(const std::pair<void*, u64>& memBlock_, std::vector<u64>& lengths_) const
+	{
+		u64 pos = 0;
+
+		while (pos < memBlock_.second)
+		{
+			const u64 len = Next(std::pair<void*, u64>((u8*)memBlock_.first + pos, memBlock_.second - pos));
+			if (!len || len == Invalid)
+			{
+				break;
+			}
+
+			lengths_.push_back(len);
+			pos += len;
+		}
+
+		return pos;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+
+#include <array>
+
+namespace MSGPack
+{
+	/*
+	*	A string known at compile time, typically a map key, held already packed
+	*	(header + bytes) so that packing it is a single copy and checking for it a
+	*	single memcmp. Made from a string literal:
+	*
+	*	static constexpr Key timestamp("timestamp");
+	*
+	*	packer.PackKey(timestamp);
+	*	...
+	*	if (unpacker.UnpackKey(timestamp))
+	*
+	*	Packed exactly as Packer::PackString() packs the same string. Limited to 255
+	*	bytes, so the header never holds a multi-byte length and is the same whether
+	*	or not the Packer is Local.
+	*/
+	template <u64 N>
+	class Key
+	{
+	public:
+		constexpr Key(const char (&str_)[N]);
+
+		/// Returns the packed key
+		constexpr const u8* Data() const;
+
+		/// Returns the size of the packed key
+		constexpr u64 Size() const;
+
+		/// Returns the string, which is not NUL-terminated
+		const char* Name() const;
+
+		/// Returns the length of the string
+		constexpr u32 Length() const;
+
+	private:
+		/// Bytes of the string that are packed. The NUL only if PackNulBase
+		static constexpr const u64 PayloadSize = PackNulBase ? N : (N - 1);
+
+		/// FixString or String8
+		static constexpr const u64 HeaderSize = (PayloadSize <= 31) ? 1 : (1 + sizeof(u8));
+
+		static_assert(PayloadSize <= 255, "Keys are limited to 255 bytes!");
+
+		std::array<u8, HeaderSize + PayloadSize> bytes;
+	};
+
+	/// Lets Key k("literal") work out N
+	template <u64 N>
+	Key(const char (&str_)[N]) -> Key<N>;
+
+	/*
+	*	Public
+	*/
+
+	template <u64 N>
+	constexpr Key<N>::Key(const char (&str_)[N]) :
+						  bytes{}
+	{
+		if constexpr (HeaderSize == 1)
+		{
+			// 101x xxxx
+			bytes[0] = (u8)(FixString | PayloadSize);
+		}
+		else
+		{
+			bytes[0] = String8;
+			bytes[1] = (u8)PayloadSize;
+		}
+
+		for (u64 i = 0; i < PayloadSize; ++i)
+		{
+			bytes[HeaderSize + i] = (u8)str_[i];
+		}
+	}
+
+	template <u64 N>
+	constexpr const u8* Key<N>::Data() const
+	{
+		return bytes.data();
+	}
+
+	template <u64 N>
+	constexpr u64 Key<N>::Size() const
+	{
+		return bytes.size();
+	}
+
+	template <u64 N>
+	const char* Key<N>::Name() const
+	{
+		return (const char*)(bytes.data() + HeaderSize);
+	}
+
+	template <u64 N>
+	constexpr u32 Key<N>::Length() const
+	{
+		// Without the NUL
+		return (u32)(N - 1);
+	}
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+
+#include <array>
+#include <cstring>
+
+namespace MSGPack
+{
+	/*
+	*	Describes how a single element is laid out in a packed message. Arrays and
+	*	maps have no payload; their elements simply follow the header.
+	*/
+	struct Layout
+	{
+		u64 headerSize;	 // ByteCode and any length/count/ext type bytes
+		u64 payloadSize; // Bytes of number/string/binary/ext data following the header
+		u64 numChildren; // Elements following an array (n) or map (n * 2) header
+	};
+
+	/*
+	*	Broad kind of element a ByteCode starts
+	*/
+	enum class TypeClass : u8
+	{
+		Invalid, // ByteCodes::NeverUse
+		Nil,
+		Bool,
+		Number,
+		String,
+		Binary,
+		Ext,
+		Array,
+		Map
+	};
+
+	/*
+	*	Everything about an element that its first byte gives away. See ByteTable.
+	*/
+	struct ByteInfo
+	{
+		u8		  type;		   // ByteCode as returned by Unpacker::PeekType(), i.e. FixUInt8 for 0x00 -> 0x7f etc
+		TypeClass typeClass;
+		u8		  headerSize;  // ByteCode and any length/count/ext type bytes. 0 for NeverUse
+		u8		  lengthSize;  // Bytes of length/count following the ByteCode. 0 if the first byte says
+		u8		  fixedLength; // Payload bytes, or array/map items, when lengthSize is 0
+	};
+
+	/// Returns the ByteInfo for the first byte byte_ of an element
+	constexpr ByteInfo DescribeByte(const u8 byte_);
+
+	/// Returns every ByteInfo, indexed by first byte
+	constexpr std::array<ByteInfo, 256> MakeByteTable();
+
+	/*
+	*	Reads element headers without decoding them. Used wherever only the shape of
+	*	a message is of interest (e.g. to walk over elements).
+	*
+	*	Local  := Lengths and counts are stored in host byte order. Must match
+	*			  the Local parameter of the Packer that produced the data.
+	*/
+	template <bool Local = false>
+	class LayoutReader
+	{
+	public:
+		/// Returns the size of the header that starts with byte_, or 0 for ByteCodes::NeverUse
+		static u64 HeaderSize(const u8 byte_);
+
+		/// Fills layout_ from the complete header at ptr_. HeaderSize(*ptr_) bytes must be readable
+		static void Read(const u8* const ptr_, Layout& layout_);
+
+	private:
+		/// Returns the host-order length/count of type T stored at ptr_
+		template <typename T>
+		static u64 ReadLength(const u8* const ptr_);
+	};
+
+	/*
+	*	Public
+	*/
+
+	constexpr ByteInfo DescribeByte(const u8 byte_)
+	{
+		// Fixed types hold their value or length in the ByteCode
+		if (byte_ <= 0x7f)
+		{
+			return { FixUInt8, TypeClass::Number, 1, 0, 0 };
+		}
+		else if (byte_ <= 0x8f)
+		{
+			return { FixMap, TypeClass::Map, 1, 0, (u8)(byte_ & 0x0f) };
+		}
+		else if (byte_ <= 0x9f)
+		{
+			return { FixArr, TypeClass::Array, 1, 0, (u8)(byte_ & 0x0f) };
+		}
+		else if (byte_ <= 0xbf)
+		{
+			return { FixString, TypeClass::String, 1, 0, (u8)(byte_ & 0x1f) };
+		}
+		else if (byte_ >= 0xe0)
+		{
+			return { FixInt8, TypeClass::Number, 1, 0, 0 };
+		}
+
+		switch (byte_)
+		{
+			case Nil:
+			{
+				return { byte_, TypeClass::Nil, 1, 0, 0 };
+			}
+
+			case BoolFalse:
+			case BoolTrue:
+			{
+				return { byte_, TypeClass::Bool, 1, 0, 0 };
+			}
+
+			case UInt8:
+			case Int8:
+			{
+				return { byte_, TypeClass::Number, 1, 0, sizeof(u8) };
+			}
+
+			case UInt16:
+			case Int16:
+			{
+				return { byte_, TypeClass::Number, 1, 0, sizeof(u16) };
+			}
+
+			case UInt32:
+			case Int32:
+			case Float32:
+			{
+				return { byte_, TypeClass::Number, 1, 0, sizeof(u32) };
+			}
+
+			case UInt64:
+			case Int64:
+			case Float64:
+			{
+				return { byte_, TypeClass::Number, 1, 0, sizeof(u64) };
+			}
+
+			case String8:
+			{
+				return { byte_, TypeClass::String, 1 + sizeof(u8), sizeof(u8), 0 };
+			}
+
+			case String16:
+			{
+				return { byte_, TypeClass::String, 1 + sizeof(u16), sizeof(u16), 0 };
+			}
+
+			case String32:
+			{
+				return { byte_, TypeClass::String, 1 + sizeof(u32), sizeof(u32), 0 };
+			}
+
+			case Bin8:
+			{
+				return { byte_, TypeClass::Binary, 1 + sizeof(u8), sizeof(u8), 0 };
+			}
+
+			case Bin16:
+			{
+				return { byte_, TypeClass::Binary, 1 + sizeof(u16), sizeof(u16), 0 };
+			}
+
+			case Bin32:
+			{
+				return { byte_, TypeClass::Binary, 1 + sizeof(u32), sizeof(u32), 0 };
+			}
+
+			case Arr16:
+			{
+				return { byte_, TypeClass::Array, 1 + sizeof(u16), sizeof(u16), 0 };
+			}
+
+			case Arr32:
+			{
+				return { byte_, TypeClass::Array, 1 + sizeof(u32), sizeof(u32), 0 };
+			}
+
+			case Map16:
+			{
+				return { byte_, TypeClass::Map, 1 + sizeof(u16), sizeof(u16), 0 };
+			}
+
+			case Map32:
+			{
+				return { byte_, TypeClass::Map, 1 + sizeof(u32), sizeof(u32), 0 };
+			}
+
+			case FixExt1:
+			case FixExt2:
+			case FixExt4:
+			case FixExt8:
+			case FixExt16:
+			{
+				// Ext types are packed as 4 bytes by Packer. FixExt1 -> 1 byte, FixExt2 -> 2 bytes etc
+				return { byte_, TypeClass::Ext, 1 + sizeof(u32), 0, (u8)(1 << (byte_ - FixExt1)) };
+			}
+
+			case Ext8:
+			{
+				return { byte_, TypeClass::Ext, 1 + sizeof(u8) + sizeof(u32), sizeof(u8), 0 };
+			}
+
+			case Ext16:
+			{
+				return { byte_, TypeClass::Ext, 1 + sizeof(u16) + sizeof(u32), sizeof(u16), 0 };
+			}
+
+			case Ext32:
+			{
+				return { byte_, TypeClass::Ext, 1 + sizeof(u32) + sizeof(u32), sizeof(u32), 0 };
+			}
+
+			default:
+			{
+				// NeverUse
+				return { byte_, TypeClass::Invalid, 0, 0, 0 };
+			}
+		}
+	}
+
+	constexpr std::array<ByteInfo, 256> MakeByteTable()
+	{
+		std::array<ByteInfo, 256> table{};
+		for (u32 i = 0; i < table.size(); ++i)
+		{
+			table[i] = DescribeByte((u8)i);
+		}
+
+		return table;
+	}
+
+	/// Looked up by every first byte read, in place of comparing it against each range of ByteCodes in turn
+	inline constexpr std::array<ByteInfo, 256> ByteTable = MakeByteTable();
+
+	template <bool Local>
+	u64 LayoutReader<Local>::HeaderSize(const u8 byte_)
+	{
+		return ByteTable[byte_].headerSize;
+	}
+
+	template <bool Local>
+	void LayoutReader<Local>::Read(const u8* const ptr_, Layout& layout_)
+	{
+		const ByteInfo& info = ByteTable[*ptr_];
+
+		// Sizes are constant per case where possible, so that callers moving on by them don't have to wait for
+		// the lookup. Ext headers hold the 4 byte ext type too
+		const u64 extSize = (info.typeClass == TypeClass::Ext) ? sizeof(u32) : 0;
+
+		u64 length;
+		switch (info.lengthSize)
+		{
+			case 0:
+			{
+				// Already waiting on the lookup for the length. 0 for NeverUse
+				layout_.headerSize = info.headerSize;
+				length			   = info.fixedLength;
+				break;
+			}
+
+			case sizeof(u8):
+			{
+				layout_.headerSize = 1 + sizeof(u8) + extSize;
+				length			   = ReadLength<u8>(ptr_ + 1);
+				break;
+			}
+
+			case sizeof(u16):
+			{
+				layout_.headerSize = 1 + sizeof(u16) + extSize;
+				length			   = ReadLength<u16>(ptr_ + 1);
+				break;
+			}
+
+			default:
+			{
+				layout_.headerSize = 1 + sizeof(u32) + extSize;
+				length			   = ReadLength<u32>(ptr_ + 1);
+				break;
+			}
+		}
+
+		// Arrays/maps have children rather than a payload. Map pairs are two elements each
+		const bool container = (info.typeClass == TypeClass::Array || info.typeClass == TypeClass::Map);
+
+		layout_.payloadSize = container ? 0 : length;
+		layout_.numChildren = container ? (length << (info.typeClass == TypeClass::Map)) : 0;
+	}
+
+	/*
+	*	Private
+	*/
+
+	template <bool Local>
+	template <typename T>
+	u64 LayoutReader<Local>::ReadLength(const u8* const ptr_)
+	{
+		T val;
+		memcpy(&val, ptr_, sizeof(T));
+
+		if constexpr (Local || sizeof(T) == sizeof(u8))
+		{
+			return val;
+		}
+		else if constexpr (sizeof(T) == sizeof(u16))
+		{
+			#if defined(_WINDOWS)
+				return ntohs(val);
+			#else
+				return betoh16(val);
+			#endif
+		}
+		else
+		{
+			#if defined(_WINDOWS)
+				return ntohl(val);
+			#else
+				return betoh32(val);
+			#endif
+		}
+	}
+}
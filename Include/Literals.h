@@ -1,13 +1,15 @@
 #pragma once
 
+#include <cstddef>
+
 typedef double                 f64;
 typedef float                  f32;
 typedef signed char			   i8;
 typedef short int              i16;
-typedef long int               i32;
+typedef int                    i32;
 typedef long long int		   i64;
 typedef unsigned char          u8;
 typedef unsigned short         u16;
-typedef long unsigned int      u32;
+typedef unsigned int           u32;
 typedef long long unsigned int u64;
 typedef size_t                 usize;
@@ -4,16 +4,40 @@
 #include "Bytecodes.h"
 #include "Defines.h"
 #include "PackerBase.h"
+#include "Layout.h"
+#include "Sinks.h"
+#include "Key.h"
+#include "FixedStack.h"
+#include "Unpacker.h"
+#include "Patch.h"
 
 #include <cassert>
 #include <array>
 #include <vector>
-#include <variant>
 #include <stack>
 #include <stdexcept>
+#include <exception>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <string_view>
+
+#if defined(_WINDOWS)
+	#include <intrin.h>
+#endif
 
 namespace MSGPack
 {
+	/*
+	*	What a fixed-Size Packer does when a write doesn't fit in its store
+	*/
+	enum class Overflow : u8
+	{
+		Throw, // Throws a std::runtime_error
+		Flag,  // Drops this and all further writes until Clear(). See Overflowed()
+		Spill  // Moves the data to a std::vector and carries on using that
+	};
+
 	/*
 	*	Size   := If != std::numeric_limits<u32>::max(), uses a fixed
 	*			  store on the stack of Size bytes.
@@ -23,15 +47,37 @@ namespace MSGPack
 	*
 	*	Local  := Disables hton[s/l/ll] endianness conversions on the assumption
 	*			  that packing and unpacking is an operation local to the PC.
+	*
+	*	Reserve := Reserves the largest (5 byte) header for every array/map so that
+	*			  EndArray()/EndMap() never shift the data that follows. The unused
+	*			  header bytes are removed in a single pass once the outermost
+	*			  array/map is closed.
+	*
+	*	OnOverflow := Behaviour when the fixed store of Size bytes is full. Writes
+	*			  are always bounds-checked for a fixed Size, regardless of Secure.
+	*
+	*	Sink   := If not NoSink, packs straight into the memory of a Sink (see Sinks.h)
+	*			  given to the constructor instead of a store of Size bytes. OnOverflow
+	*			  applies if the Sink can't grow.
+	*
+	*	MaxDepth := If != 0, open arrays/maps are tracked in a fixed stack of MaxDepth
+	*			  entries within the Packer rather than a std::stack, so that with a
+	*			  fixed Size nothing is allocated. Nesting deeper always throws,
+	*			  regardless of Secure.
 	*/
-	template <u32  Size   = std::numeric_limits<u32>::max(),
-			  bool Secure = SecureBase,
-			  bool Local  = false>
-	class Packer : public PackerBase<Packer<Size, Secure, Local>>
+	template <u32	   Size		  = std::numeric_limits<u32>::max(),
+			  bool	   Secure	  = SecureBase,
+			  bool	   Local	  = false,
+			  bool	   Reserve	  = false,
+			  Overflow OnOverflow = Overflow::Throw,
+			  typename Sink		  = NoSink,
+			  u32	   MaxDepth	  = 0>
+	class Packer : public PackerBase<Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>>
 	{
 	public:
 		Packer();
-		~Packer();
+		Packer(Sink& sink_);
+		~Packer() noexcept(false);
 
 		/// Clears the packer
 		void Clear();
@@ -46,24 +92,63 @@ namespace MSGPack
 		template <typename T>
 		void PackNumber(const T val_);
 
-		/// Must be null-terminated
+		/// Packs val_ at the full width of T (e.g. always UInt64 for a u64), so that any T can later be patched
+		/// over it. Returns its position in Message(), which stays put only if every enclosing array/map is
+		/// count-known and nothing has been handed to a Sink. Otherwise, find it with Unpacker::Tell()
+		template <typename T>
+		u64 PackFixedNumber(const T val_);
+
+		/// Must be null-terminated. The NUL is only packed if PackNulBase
 		void PackString(const char* val_);
 
+		/// Packs exactly len_ bytes of val_, which needn't be null-terminated
+		void PackString(const char* val_, const u32 len_);
+
+		/// As PackString(val_.data(), val_.size())
+		void PackString(const std::string_view val_);
+
+		/// Packs a string encoded at compile time with a single copy. See Key.h
+		template <u64 N>
+		void PackKey(const Key<N>& key_);
+
 		/// Binary in form of [val_ = ptr, len_ = size]
 		void PackBinary(const u8* const val_, const u32 len_);
 
 		/// Packs the ext type with the integer and data_
 		void PackExt(const i32 type_, const u8* const data_, const u32 len_);
 
+		/// Splices in raw_, exactly one complete packed element (e.g. from Unpacker::UnpackRaw()), with a
+		/// single copy. It counts as one element of the open array/map. Secure checks raw_ is one element
+		void PackRaw(const std::pair<void*, u64>& raw_);
+
+		/// As above for numElements_ complete elements one after another, e.g. a run of array items packed
+		/// by another Packer. They count as numElements_ elements. Secure checks raw_ is exactly that many
+		void PackRaw(const std::pair<void*, u64>& raw_, const u64 numElements_);
+
 		/// Starts an array with the size determined between this call and EndArray()
 		void StartArray();
 
+		/// Starts an array of exactly numItems_ elements. The header is written immediately
+		/// and EndArray() has nothing to backpatch. Secure checks the count in EndArray()
+		void StartArray(const u32 numItems_);
+
+		/// Packs num_ numbers as a complete array in one go. Space is reserved once and each number
+		/// encoded straight into it. With fixedWidth_, every number takes the full width of T (e.g.
+		/// UInt32 for a u32), so the array is exactly header + num_ * (1 + sizeof(T)) bytes. Bools aren't
+		/// numbers in MSGPack, so pack them one at a time with PackBool()
+		template <typename T>
+		void PackArray(const T* const data_, const u32 num_, const bool fixedWidth_ = false);
+
 		/// Stops writing to the array and defines the correct MSGPack size
 		void EndArray();
 
 		/// Starts a map with the size determined between this call and EndMap()
 		void StartMap();
 
+		/// Starts a map of exactly numItems_ key : value pairs. As with StartArray(numItems_),
+		/// the header is written immediately
+		void StartMap(const u32 numItems_);
+
 		/// Stops writing to the map and defines the correct MSGPack size
 		void EndMap();
 
@@ -73,56 +158,147 @@ namespace MSGPack
 		/// Returns a std::pair<void* u64> of the full packed message
 		std::pair<void*, u64> Message() const;
 
+		/// Returns true if a write was dropped under Overflow::Flag. The message is incomplete
+		bool Overflowed() const;
+
+		/// Overwrites the number at position_ in place. See PatchNumber() in Patch.h
+		template <typename T>
+		bool PatchNumber(const u64 position_, const T val_);
+
+		/// Hands everything packed so far to the Sink. Any open arrays/maps must be count-known
+		void Flush();
+
 	private:
 		struct StartAndNumItems
 		{
 			u64 startIdx;
 			u64 numItems;
+			u64 numDeclared;  // Secure only. Elements promised by StartArray/Map(numItems_)
+			u32 numKnownOpen; // !Secure only. Count-known arrays/maps open directly inside this one
 		};
 
-		std::variant<std::array<u8, (Size == std::numeric_limits<u32>::max()) ? 1 : Size>,
-					 std::vector<u8>> data;
-		u32							  dataStaticSize;
+		static constexpr const u64 NotDeclared = std::numeric_limits<u64>::max();
+
+		/// Open arrays/maps, innermost on top. See MaxDepth
+		using ContainerStack = std::conditional_t<MaxDepth == 0, std::stack<StartAndNumItems>, FixedStack<StartAndNumItems, MaxDepth>>;
+
+		static constexpr const bool HasSink = !std::is_same_v<Sink, NoSink>;
+
+		std::array<u8, (Size == std::numeric_limits<u32>::max() || HasSink) ? 1 : Size> dataStatic;
+		u64																				dataStaticSize;
+		Sink*																			sink;
+		std::vector<u8>																	dataDynamic;
+		bool																			spilled;
+		bool																			overflowed;
+
+		ContainerStack containerStartIdxs;
+		u32			   rootNumKnownOpen;
+		u32			   numDeferredOpen;
+
+		/// True if dataDynamic is in use, either due to Size or a spill
+		bool IsDynamic() const;
+
+		/// Returns the start of whichever store is in use
+		u8* Data();
+
+		/// Returns the start of dataStatic, or of the sink's memory
+		u8*		  StaticData();
+		const u8* StaticData() const;
 
-		std::stack<StartAndNumItems> containerStartIdxs;
+		/// Checks that size_ more bytes fit in dataStatic or the sink, applying OnOverflow if not. Returns
+		/// true if they fit. On false, the write is either dropped or must go to dataDynamic after a spill
+		bool StaticFits(const u64 size_);
 
-		/// Pushes a single byte onto the variant. Returns the position of the first byte
+		/// As StaticFits(), but with no OnOverflow action
+		bool StaticHasRoom(const u64 size_);
+
+		/// Returns true if size_ more bytes are within dataStatic, or the sink's memory as it stands. Written so
+		/// that nothing can wrap, which lets the compiler see that a copy it guards is in bounds
+		bool StaticInBounds(const u64 size_) const;
+
+		/// Offers the data to the sink, if any, once no array/map header awaits a backpatch
+		void Commit(const bool flush_);
+
+		/// Pushes a single byte onto the store. Returns the position of the first byte
 		u64 PushByte(const u8 byte_);
 
-		/// Pushes a selection of bytes onto the variant. Returns the position of the first byte
+		/// Pushes a selection of bytes onto the store. Returns the position of the first byte
 		u64 PushBytes(const u8* const bytes_, const u64 size_);
 
+		/// Pushes the len_ bytes of a packed string, the last of which is the NUL if PackNulBase
+		void PushString(const char* val_, const u32 len_);
+
 		/// Changes the byte at position_ to val_
 		void ChangeByte(const u64 position_, const u8 val_);
 
 		/// Changes the selection of bytes starting at position_ to bytes_
 		void ChangeBytes(const u64 position_, const u8* const bytes_, const u32 len_);
 
+		/// Pushes the placeholder for an array/map header. Returns the position of the first byte
+		u64 PushHeader();
+
+		/// Writes the final array/map header of len_ bytes for the placeholder at position_
+		void SetHeader(const u64 position_, const u8* const bytes_, const u32 len_);
+
+		/// Removes the unused reserved header bytes from position_ onwards
+		void Compact(const u64 position_);
+
+		/// Fills bytes_ with the array/map header for numItems_. Returns the number of bytes used,
+		/// or 0 if numItems_ is too large
+		u32 ContainerHeader(const u64 numItems_, const u8 fixCode_, const u8 code16_, const u8 code32_, u8* const bytes_) const;
+
+		/// Tracks a count-known array/map of numElements_ elements whose header is at position_
+		void StartKnown(const u64 numElements_, const u64 position_);
+
+		/// Opens an array/map whose header is at startIdx_, checking MaxDepth
+		void PushContainer(const u64 startIdx_, const u64 numDeclared_);
+
+		/// Closes a count-known array/map if one is innermost. Returns false if it's a deferred one
+		bool EndKnown();
+
 		/// Host -> Network byte order functions
 		u16 HostToNetwork(const u16 val_) const;
 		u32 HostToNetwork(const u32 val_) const;
 		u64 HostToNetwork(const u64 val_) const;
 
+		/// Writes val_ to bytes_ in the smallest form that holds it, as PackNumber() packs it. bytes_ must have
+		/// room for 1 + sizeof(T). Returns the number of bytes written
+		template <typename T>
+		u32 EncodeNumber(const T val_, u8* const bytes_) const;
+
+		/// Writes val_ to bytes_ at the full width of T (e.g. always UInt32 for a u32). Returns 1 + sizeof(T)
+		template <typename T>
+		u32 EncodeFixedNumber(const T val_, u8* const bytes_) const;
+
+		/// Returns the number of bits up to and including the highest set bit of val_, or 1 for 0
+		static u32 BitWidth(const u64 val_);
+
+		/// Appends size_ bytes to the store and returns where they start, or nullptr if the write was dropped
+		u8* PushSpace(const u64 size_);
+
+		/// Removes the last size_ bytes from the store, e.g. the unused end of a PushSpace()
+		void PopSpace(const u64 size_);
+
 		/// Fix[type] functions
-		void PackFixUInt(const u8 val_);
-		void PackFixInt(const i8 val_);
+		u32	 EncodeFixUInt(const u8 val_, u8* const bytes_) const;
+		u32	 EncodeFixInt(const i8 val_, u8* const bytes_) const;
 		void PackFixStr(const char* val_, const u8 len_);
 
 		/// Fixed sizes for u8, u16, u32, u64
-		void PackU8(const u8 val_);
-		void PackU16(const u16 val_);
-		void PackU32(const u32 val_);
-		void PackU64(const u64 val_);
+		u32 EncodeU8(const u8 val_, u8* const bytes_) const;
+		u32 EncodeU16(const u16 val_, u8* const bytes_) const;
+		u32 EncodeU32(const u32 val_, u8* const bytes_) const;
+		u32 EncodeU64(const u64 val_, u8* const bytes_) const;
 
 		/// Fixed sizes for i8, i16, i32, i64
-		void PackI8(const i8 val_);
-		void PackI16(const i16 val_);
-		void PackI32(const i32 val_);
-		void PackI64(const i64 val_);
+		u32 EncodeI8(const i8 val_, u8* const bytes_) const;
+		u32 EncodeI16(const i16 val_, u8* const bytes_) const;
+		u32 EncodeI32(const i32 val_, u8* const bytes_) const;
+		u32 EncodeI64(const i64 val_, u8* const bytes_) const;
 
 		/// Floats and doubles
-		void PackF32(const f32 val_);
-		void PackF64(const f64 val_);
+		u32 EncodeF32(const f32 val_, u8* const bytes_) const;
+		u32 EncodeF64(const f64 val_, u8* const bytes_) const;
 
 		/// Various string sizes
 		void PackStr8(const char* val_, const u8 len_);
@@ -148,56 +324,68 @@ namespace MSGPack
 	*	Public
 	*/
 
-	template <u32 Size, bool Secure, bool Local>
-	Packer<Size, Secure, Local>::Packer()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Packer()
 	{
-		if constexpr (Size != std::numeric_limits<u32>::max())
-		{
-			std::array<u8, Size>& arr = std::get<std::array<u8, Size>>(data);
-			arr.fill('\0');
+		static_assert(!HasSink, "Packer with a Sink must be given one on construction!");
 
-			dataStaticSize = 0;
-		}
-		else
+		if constexpr (Size != std::numeric_limits<u32>::max())
 		{
-			data = std::vector<u8>();
+			dataStatic.fill('\0');
 		}
+
+		dataStaticSize	 = 0;
+		sink			 = nullptr;
+		spilled			 = false;
+		overflowed		 = false;
+		rootNumKnownOpen = 0;
+		numDeferredOpen	 = 0;
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	Packer<Size, Secure, Local>::~Packer()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Packer(Sink& sink_)
 	{
-		// No open arrays/maps
+		dataStaticSize	 = 0;
+		sink			 = &sink_;
+		spilled			 = false;
+		overflowed		 = false;
+		rootNumKnownOpen = 0;
+		numDeferredOpen	 = 0;
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::~Packer() noexcept(false)
+	{
+		// No open arrays/maps. Destructors are otherwise noexcept, which would turn this into std::terminate().
+		// Not while unwinding from another throw, which would std::terminate() too and is already an error
 		if constexpr (Secure)
 		{
-			if (containerStartIdxs.size() != 0)
+			if (containerStartIdxs.size() != 0 && std::uncaught_exceptions() == 0)
 			{
 				throw std::runtime_error("Open Maps/Arrays when Pack completed!");
 			}
 		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::Clear()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Clear()
 	{
 		while (!containerStartIdxs.empty())
 		{
 			containerStartIdxs.pop();
 		}
+		rootNumKnownOpen = 0;
+		numDeferredOpen	 = 0;
 
-		if constexpr (Size == std::numeric_limits<u32>::max())
-		{
-			std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			arr.clear();
-		}
-		else
-		{
-			dataStaticSize = 0;
-		}
+		// A spilled Packer goes back to its fixed store
+		dataDynamic.clear();
+		dataStaticSize = 0;
+		spilled		   = false;
+		overflowed	   = false;
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackNil()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackNil()
 	{
 		PushByte(ByteCodes::Nil);
 
@@ -206,10 +394,12 @@ namespace MSGPack
 		{
 			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackBool(const bool val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackBool(const bool val_)
 	{
 		if (val_)
 		{
@@ -225,117 +415,55 @@ namespace MSGPack
 		{
 			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
 	template <typename T>
-	void Packer<Size, Secure, Local>::PackNumber(const T val_)
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackNumber(const T val_)
 	{
-		if constexpr (std::is_unsigned_v<T> && std::is_integral_v<T>)
-		{
-			if ((u8)val_ == val_)
-			{
-				if (val_ <= 127)
-				{
-					// Can pack using 7 bits
-					PackFixUInt(val_);
-				}
-				else
-				{
-					PackU8(val_);
-				}
-			}
-			else if ((u16)val_ == val_)
-			{
-				PackU16(val_);
-			}
-			else if ((u32)val_ == val_)
-			{
-				PackU32(val_);
-			}
-			else if ((u64)val_ == val_)
-			{
-				PackU64(val_);
-			}
-			else
-			{
-				if constexpr (Secure)
-				{
-					throw std::runtime_error("Unknown error during PackNumber!");
-				}
-			}
-		}
-		else if constexpr (std::is_signed_v<T> && std::is_integral_v<T>)
-		{
-			if ((i8)val_ == val_)
-			{
-				if (val_ < 0 && val_ >= -31)
-				{
-					// Can pack using 5 bits
-					PackFixInt(val_);
-				}
-				else
-				{
-					PackI8(val_);
-				}
-			}
-			else if ((i16)val_ == val_)
-			{
-				PackI16(val_);
-			}
-			else if ((i32)val_ == val_)
-			{
-				PackI32(val_);
-			}
-			else if ((i64)val_ == val_)
-			{
-				PackI64(val_);
-			}
-			else
-			{
-				if constexpr (Secure)
-				{
-					throw std::runtime_error("Unknown error during PackNumber!");
-				}
-			}
-		}
-		else if constexpr (std::is_floating_point_v<T>)
-		{
-			if constexpr (sizeof(T) == sizeof(f32))
-			{
-				PackF32(val_);
-			}
-			else if constexpr (sizeof(T) == sizeof(f64))
-			{
-				PackF64(val_);
-			}
-			else
-			{
-				if constexpr (Secure)
-				{
-					throw std::runtime_error("Unknown error during PackNumber!");
-				}
-			}
-		}
-		else
+		u8 bytes[1 + sizeof(u64)];
+		PushBytes(bytes, EncodeNumber(val_, bytes));
+
+		// Add to map/array size
+		if (containerStartIdxs.size())
 		{
-			if constexpr (Secure)
-			{
-				throw std::runtime_error("Unknown error during PackNumber!");
-			}
+			containerStartIdxs.top().numItems++;
 		}
 
+		Commit(false);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	template <typename T>
+	u64 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackFixedNumber(const T val_)
+	{
+		u8 bytes[1 + sizeof(u64)];
+		const u64 position = PushBytes(bytes, EncodeFixedNumber(val_, bytes));
+
 		// Add to map/array size
 		if (containerStartIdxs.size())
 		{
 			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
+		return position;
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackString(const char* val_)
+	{
+		// Through the string_view overload, so that a length >= 2^32 is checked before it's narrowed
+		PackString(std::string_view(val_));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackString(const char* val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackString(const char* val_, const u32 len_)
 	{
-		const u32 len = strlen(val_) + 1;
+		// A packed NUL counts towards the length
+		const u64 len = (u64)len_ + (PackNulBase ? 1 : 0);
 
 		if (len <= 31)
 		{
@@ -369,10 +497,41 @@ namespace MSGPack
 		{
 			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackString(const std::string_view val_)
+	{
+		if constexpr (Secure)
+		{
+			if (val_.size() > std::numeric_limits<u32>::max())
+			{
+				throw std::runtime_error("Strings >= 2^32 not supported during Pack!");
+			}
+		}
+
+		PackString(val_.data(), (u32)val_.size());
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	template <u64 N>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackKey(const Key<N>& key_)
+	{
+		PushBytes(key_.Data(), key_.Size());
+
+		// Add to map/array size
+		if (containerStartIdxs.size())
+		{
+			containerStartIdxs.top().numItems++;
+		}
+
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackBinary(const u8* const val_, const u32 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackBinary(const u8* const val_, const u32 len_)
 	{
 		if (len_ <= std::numeric_limits<u8>::max())
 		{
@@ -402,10 +561,12 @@ namespace MSGPack
 		{
 			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackExt(const i32 type_, const u8* const data_, const u32 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackExt(const i32 type_, const u8* const data_, const u32 len_)
 	{
 		if (len_ == 1)
 		{
@@ -452,77 +613,82 @@ namespace MSGPack
 		{
 			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::StartArray()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackRaw(const std::pair<void*, u64>& raw_)
 	{
-		// Add to map/array size. This goes before we push a new array as we're now counting
-		// for that one instead
+		if constexpr (Secure)
+		{
+			// Anything else would throw the array/map counts out
+			Unpacker<true, Local> unpacker(raw_);
+			try
+			{
+				unpacker.Skip();
+			}
+			catch (const std::runtime_error&)
+			{
+				throw std::runtime_error("Raw data is not a valid element during Pack!");
+			}
+
+			if (unpacker.Tell() != raw_.second)
+			{
+				throw std::runtime_error("Raw data is more than one element during Pack!");
+			}
+		}
+
+		PushBytes((const u8*)raw_.first, raw_.second);
+
+		// Add to map/array size
 		if (containerStartIdxs.size())
 		{
 			containerStartIdxs.top().numItems++;
 		}
 
-		// Temp
-		containerStartIdxs.push(StartAndNumItems{ PushByte(ByteCodes::NeverUse), 0 });
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::EndArray()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackRaw(const std::pair<void*, u64>& raw_, const u64 numElements_)
 	{
-		const StartAndNumItems arrData = containerStartIdxs.top();
-		if (arrData.numItems <= 15)
-		{
-			// Set byte as 1001[diff]
-			u8 val = arrData.numItems;
-			val    = val |  (1 << 7);
-			val    = val & ~(1 << 6);
-			val    = val & ~(1 << 5);
-			val    = val |  (1 << 4);
-
-			ChangeByte(arrData.startIdx, val);
-		}
-		else if (arrData.numItems <= std::numeric_limits<u16>::max())
+		if constexpr (Secure)
 		{
-			const u16 nVal = HostToNetwork((u16)arrData.numItems);
-
-			u8 bytes[1 + sizeof(u16)];
-			bytes[0] = ByteCodes::Arr16;
-			bytes[1] = nVal		   & 0xFF;
-			bytes[2] = (nVal >> 8) & 0xFF;
+			Unpacker<true, Local> unpacker(raw_);
+			try
+			{
+				for (u64 i = 0; i < numElements_; ++i)
+				{
+					unpacker.Skip();
+				}
+			}
+			catch (const std::runtime_error&)
+			{
+				throw std::runtime_error("Raw data is not valid elements during Pack!");
+			}
 
-			ChangeBytes(arrData.startIdx, bytes, sizeof(bytes));
+			if (unpacker.Tell() != raw_.second)
+			{
+				throw std::runtime_error("Raw data is more elements than given during Pack!");
+			}
 		}
-		else if (arrData.numItems <= std::numeric_limits<u32>::max())
-		{
-			const u32 nVal = HostToNetwork((u32)arrData.numItems);
 
-			u8 bytes[1 + sizeof(u32)];
-			bytes[0] = ByteCodes::Arr32;
-			bytes[1] = nVal			& 0xFF;
-			bytes[2] = (nVal >> 8)  & 0xFF;
-			bytes[3] = (nVal >> 16) & 0xFF;
-			bytes[4] = (nVal >> 24) & 0xFF;
+		PushBytes((const u8*)raw_.first, raw_.second);
 
-			ChangeBytes(arrData.startIdx, bytes, sizeof(bytes));
-		}
-		else
+		// Add to map/array size
+		if (containerStartIdxs.size())
 		{
-			if constexpr (Secure)
-			{
-				throw std::runtime_error("Array element count >= 2^32 not supported during Pack!");
-			}
+			containerStartIdxs.top().numItems += numElements_;
 		}
 
-		// Array completed
-		containerStartIdxs.pop();
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::StartMap()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StartArray()
 	{
-		// Add to map/array size. This goes before we push a new map as we're now counting
+		// Add to map/array size. This goes before we push a new array as we're now counting
 		// for that one instead
 		if (containerStartIdxs.size())
 		{
@@ -530,106 +696,250 @@ namespace MSGPack
 		}
 
 		// Temp
-		containerStartIdxs.push(StartAndNumItems{ PushByte(ByteCodes::NeverUse), 0 });
+		PushContainer(PushHeader(), NotDeclared);
+		numDeferredOpen++;
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::EndMap()
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StartArray(const u32 numItems_)
 	{
-		// Get top, check it is key : value and then / 2 to make rest of func easier
-		StartAndNumItems mapData = containerStartIdxs.top();
-		if constexpr (Secure)
-		{
-			if (mapData.numItems % 2)
-			{
-				throw std::runtime_error("Map with !%2 elements detected during Pack!");
-			}
-		}
-		mapData.numItems /= 2;
+		// Header is final, so there's nothing to backpatch
+		u8 bytes[1 + sizeof(u32)];
+		const u32 len = ContainerHeader(numItems_, ByteCodes::FixArr, ByteCodes::Arr16, ByteCodes::Arr32, bytes);
 
-		if (mapData.numItems <= (15 * 2))
-		{
-			// Set byte as 1000[diff]
-			u8 val = mapData.numItems;
-			val    = val |  (1 << 7);
-			val    = val & ~(1 << 6);
-			val    = val & ~(1 << 5);
-			val    = val & ~(1 << 4);
+		StartKnown(numItems_, PushBytes(bytes, len));
+	}
 
-			ChangeByte(mapData.startIdx, val);
-		}
-		else if (mapData.numItems <= (std::numeric_limits<u16>::max() * 2))
-		{
-			const u16 nVal = HostToNetwork((u16)mapData.numItems);
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	template <typename T>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackArray(const T* const data_, const u32 num_, const bool fixedWidth_)
+	{
+		static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "PackArray() only takes numbers!");
 
-			u8 bytes[1 + sizeof(u16)];
-			bytes[0] = ByteCodes::Map16;
-			bytes[1] = nVal		   & 0xFF;
-			bytes[2] = (nVal >> 8) & 0xFF;
+		u8 header[1 + sizeof(u32)];
+		const u32 headerLen = ContainerHeader(num_, ByteCodes::FixArr, ByteCodes::Arr16, ByteCodes::Arr32, header);
 
-			ChangeBytes(mapData.startIdx, bytes, sizeof(bytes));
-		}
-		else if (mapData.numItems <= (std::numeric_limits<u32>::max() * 2))
+		// Every number at full width is the most this can take
+		const u64 maxSize = headerLen + ((u64)num_ * (1 + sizeof(T)));
+
+		if (fixedWidth_ || IsDynamic() || StaticHasRoom(maxSize))
 		{
-			const u32 nVal = HostToNetwork((u32)mapData.numItems);
+			u8* const out = PushSpace(maxSize);
+			if (out)
+			{
+				memcpy(out, header, headerLen);
 
-			u8 bytes[1 + sizeof(u32)];
-			bytes[0] = ByteCodes::Map32;
-			bytes[1] = nVal			& 0xFF;
-			bytes[2] = (nVal >> 8)  & 0xFF;
-			bytes[3] = (nVal >> 16) & 0xFF;
-			bytes[4] = (nVal >> 24) & 0xFF;
+				u64 pos = headerLen;
+				if (fixedWidth_)
+				{
+					for (u32 i = 0; i < num_; ++i)
+					{
+						pos += EncodeFixedNumber(data_[i], out + pos);
+					}
+				}
+				else
+				{
+					for (u32 i = 0; i < num_; ++i)
+					{
+						pos += EncodeNumber(data_[i], out + pos);
+					}
+				}
 
-			ChangeBytes(mapData.startIdx, bytes, sizeof(bytes));
+				// Give back what smaller encodings didn't use
+				PopSpace(maxSize - pos);
+			}
 		}
 		else
 		{
-			// Maps can only contain 2^32 - 1 elements
-			if constexpr (Secure)
+			// Might still fit once encoded, so go number by number and let OnOverflow apply only if it doesn't
+			PushBytes(header, headerLen);
+			for (u32 i = 0; i < num_; ++i)
 			{
-				throw std::runtime_error("Map element count >= 2^32 not supported during Pack!");
+				u8 bytes[1 + sizeof(u64)];
+				PushBytes(bytes, EncodeNumber(data_[i], bytes));
 			}
 		}
 
-		// Map completed
-		containerStartIdxs.pop();
-	}
-
-	template <u32 Size, bool Secure, bool Local>
-	u64 Packer<Size, Secure, Local>::CurrentSize() const
-	{
-		if constexpr (Size == std::numeric_limits<u32>::max())
-		{
-			const std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			return arr.size();
-		}
-		else
+		// The whole array is a single element of the enclosing map/array
+		if (containerStartIdxs.size())
 		{
-			return dataStaticSize;
+			containerStartIdxs.top().numItems++;
 		}
+
+		Commit(false);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	std::pair<void*, u64> Packer<Size, Secure, Local>::Message() const
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EndArray()
 	{
-		if constexpr (Size == std::numeric_limits<u32>::max())
+		// Count-known arrays were completed by StartArray(numItems_)
+		if (EndKnown())
 		{
-			const std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			return std::make_pair<void*, u64>((void*)arr.data(), arr.size());
+			Commit(false);
+			return;
 		}
-		else
+
+		const StartAndNumItems arrData = containerStartIdxs.top();
+
+		u8 bytes[1 + sizeof(u32)];
+		const u32 len = ContainerHeader(arrData.numItems, ByteCodes::FixArr, ByteCodes::Arr16, ByteCodes::Arr32, bytes);
+		if (len)
+		{
+			SetHeader(arrData.startIdx, bytes, len);
+		}
+		else
+		{
+			if constexpr (Secure)
+			{
+				throw std::runtime_error("Array element count >= 2^32 not supported during Pack!");
+			}
+		}
+
+		// Array completed
+		containerStartIdxs.pop();
+		numDeferredOpen--;
+
+		// Remove the unused header bytes once nothing is left to backpatch
+		if constexpr (Reserve)
+		{
+			if (!numDeferredOpen)
+			{
+				Compact(arrData.startIdx);
+			}
+		}
+
+		Commit(false);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StartMap()
+	{
+		// Add to map/array size. This goes before we push a new map as we're now counting
+		// for that one instead
+		if (containerStartIdxs.size())
 		{
-			const std::array<u8, Size>& arr = std::get<std::array<u8, Size>>(data);
-			return std::make_pair<void*, u64>((void*)arr.data(), dataStaticSize);
+			containerStartIdxs.top().numItems++;
 		}
+
+		// Temp
+		PushContainer(PushHeader(), NotDeclared);
+		numDeferredOpen++;
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StartMap(const u32 numItems_)
+	{
+		// Header is final, so there's nothing to backpatch
+		u8 bytes[1 + sizeof(u32)];
+		const u32 len = ContainerHeader(numItems_, ByteCodes::FixMap, ByteCodes::Map16, ByteCodes::Map32, bytes);
+
+		// Key : value
+		StartKnown((u64)numItems_ * 2, PushBytes(bytes, len));
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EndMap()
+	{
+		// Count-known maps were completed by StartMap(numItems_)
+		if (EndKnown())
+		{
+			Commit(false);
+			return;
+		}
+
+		// Get top, check it is key : value and then / 2 to make rest of func easier
+		StartAndNumItems mapData = containerStartIdxs.top();
+		if constexpr (Secure)
+		{
+			if (mapData.numItems % 2)
+			{
+				throw std::runtime_error("Map with !%2 elements detected during Pack!");
+			}
+		}
+		mapData.numItems /= 2;
+
+		u8 bytes[1 + sizeof(u32)];
+		const u32 len = ContainerHeader(mapData.numItems, ByteCodes::FixMap, ByteCodes::Map16, ByteCodes::Map32, bytes);
+		if (len)
+		{
+			SetHeader(mapData.startIdx, bytes, len);
+		}
+		else
+		{
+			// Maps can only contain 2^32 - 1 elements
+			if constexpr (Secure)
+			{
+				throw std::runtime_error("Map element count >= 2^32 not supported during Pack!");
+			}
+		}
+
+		// Map completed
+		containerStartIdxs.pop();
+		numDeferredOpen--;
+
+		// Remove the unused header bytes once nothing is left to backpatch
+		if constexpr (Reserve)
+		{
+			if (!numDeferredOpen)
+			{
+				Compact(mapData.startIdx);
+			}
+		}
+
+		Commit(false);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u64 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::CurrentSize() const
+	{
+		if (IsDynamic())
+		{
+			return dataDynamic.size();
+		}
+		else
+		{
+			return dataStaticSize;
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	std::pair<void*, u64> Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Message() const
+	{
+		if (IsDynamic())
+		{
+			return std::make_pair<void*, u64>((void*)dataDynamic.data(), dataDynamic.size());
+		}
+		else
+		{
+			return std::make_pair<void*, u64>((void*)StaticData(), (u64)dataStaticSize);
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Overflowed() const
+	{
+		return overflowed;
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	template <typename T>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PatchNumber(const u64 position_, const T val_)
+	{
+		return MSGPack::PatchNumber<Local>(Message(), position_, val_);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Flush()
+	{
+		Commit(true);
 	}
 
 	/*
 	*	Private
 	*/
 
-	template <u32 Size, bool Secure, bool Local>
-	u16 Packer<Size, Secure, Local>::HostToNetwork(const u16 val_) const
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u16 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::HostToNetwork(const u16 val_) const
 	{
 		if constexpr (Local)
 		{
@@ -645,8 +955,8 @@ namespace MSGPack
 		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	u32 Packer<Size, Secure, Local>::HostToNetwork(const u32 val_) const
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::HostToNetwork(const u32 val_) const
 	{
 		if constexpr (Local)
 		{
@@ -662,8 +972,8 @@ namespace MSGPack
 		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	u64 Packer<Size, Secure, Local>::HostToNetwork(const u64 val_) const
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u64 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::HostToNetwork(const u64 val_) const
 	{
 		if constexpr (Local)
 		{
@@ -679,17 +989,181 @@ namespace MSGPack
 		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackFixUInt(const u8 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	template <typename T>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeNumber(const T val_, u8* const bytes_) const
+	{
+		if constexpr (std::is_unsigned_v<T> && std::is_integral_v<T>)
+		{
+			const u32 bits = BitWidth((u64)val_);
+			if (bits <= 7)
+			{
+				// Can pack using 7 bits
+				return EncodeFixUInt(val_, bytes_);
+			}
+
+			// Smallest width from the bit count, rather than trying each width in turn
+			switch ((bits > 8) + (bits > 16) + (bits > 32))
+			{
+				case 0:
+				{
+					return EncodeU8(val_, bytes_);
+				}
+
+				case 1:
+				{
+					return EncodeU16(val_, bytes_);
+				}
+
+				case 2:
+				{
+					return EncodeU32(val_, bytes_);
+				}
+
+				default:
+				{
+					return EncodeU64(val_, bytes_);
+				}
+			}
+		}
+		else if constexpr (std::is_signed_v<T> && std::is_integral_v<T>)
+		{
+			if (val_ < 0 && val_ >= -31)
+			{
+				// Can pack using 5 bits
+				return EncodeFixInt(val_, bytes_);
+			}
+
+			// Flipping negatives leaves the bits that differ from the sign, which then needs one more
+			const i64 val  = val_;
+			const u32 bits = BitWidth((u64)val ^ (u64)(val >> 63)) + 1;
+
+			switch ((bits > 8) + (bits > 16) + (bits > 32))
+			{
+				case 0:
+				{
+					return EncodeI8(val_, bytes_);
+				}
+
+				case 1:
+				{
+					return EncodeI16(val_, bytes_);
+				}
+
+				case 2:
+				{
+					return EncodeI32(val_, bytes_);
+				}
+
+				default:
+				{
+					return EncodeI64(val_, bytes_);
+				}
+			}
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			if constexpr (sizeof(T) == sizeof(f32))
+			{
+				return EncodeF32(val_, bytes_);
+			}
+			else if constexpr (sizeof(T) == sizeof(f64))
+			{
+				return EncodeF64(val_, bytes_);
+			}
+			else
+			{
+				if constexpr (Secure)
+				{
+					throw std::runtime_error("Unknown error during PackNumber!");
+				}
+			}
+		}
+		else
+		{
+			if constexpr (Secure)
+			{
+				throw std::runtime_error("Unknown error during PackNumber!");
+			}
+		}
+
+		return 0;
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::BitWidth(const u64 val_)
+	{
+		// Or-ing in 1 keeps the count defined for 0, without a branch
+		#if defined(_WINDOWS)
+			unsigned long idx;
+			_BitScanReverse64(&idx, val_ | 1);
+			return (u32)idx + 1;
+		#else
+			return (u32)(64 - __builtin_clzll(val_ | 1));
+		#endif
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	template <typename T>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeFixedNumber(const T val_, u8* const bytes_) const
+	{
+		static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "Only numbers can be packed at a fixed width!");
+
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			return EncodeNumber(val_, bytes_);
+		}
+		else if constexpr (std::is_unsigned_v<T>)
+		{
+			if constexpr (sizeof(T) == sizeof(u8))
+			{
+				return EncodeU8(val_, bytes_);
+			}
+			else if constexpr (sizeof(T) == sizeof(u16))
+			{
+				return EncodeU16(val_, bytes_);
+			}
+			else if constexpr (sizeof(T) == sizeof(u32))
+			{
+				return EncodeU32(val_, bytes_);
+			}
+			else
+			{
+				return EncodeU64(val_, bytes_);
+			}
+		}
+		else
+		{
+			if constexpr (sizeof(T) == sizeof(i8))
+			{
+				return EncodeI8(val_, bytes_);
+			}
+			else if constexpr (sizeof(T) == sizeof(i16))
+			{
+				return EncodeI16(val_, bytes_);
+			}
+			else if constexpr (sizeof(T) == sizeof(i32))
+			{
+				return EncodeI32(val_, bytes_);
+			}
+			else
+			{
+				return EncodeI64(val_, bytes_);
+			}
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeFixUInt(const u8 val_, u8* const bytes_) const
 	{
 		// Replace last bit in val with 0
-		const u8 val = val_ & ~(1 << 7);
+		bytes_[0] = val_ & ~(1 << 7);
 
-		PushByte(val);
+		return 1;
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackFixInt(const i8 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeFixInt(const i8 val_, u8* const bytes_) const
 	{
 		// Replace last 3 bits in val with 1
 		u8 val = val_;
@@ -697,11 +1171,13 @@ namespace MSGPack
 		val    = val | (1 << 6);
 		val    = val | (1 << 5);
 
-		PushByte(val);
+		bytes_[0] = val;
+
+		return 1;
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackFixStr(const char* val_, const u8 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackFixStr(const char* val_, const u8 len_)
 	{
 		// Replace last 3 bits in len_ with 101
 		u8 val = len_;
@@ -710,84 +1186,267 @@ namespace MSGPack
 		val    = val |  (1 << 5);
 
 		PushByte(val);
-		PushBytes((u8*)val_, len_);
+		PushString(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	u64 Packer<Size, Secure, Local>::PushByte(const u8 byte_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::IsDynamic() const
 	{
-		if constexpr (Size == std::numeric_limits<u32>::max())
+		if constexpr (Size == std::numeric_limits<u32>::max() && !HasSink)
+		{
+			return true;
+		}
+		else if constexpr (OnOverflow == Overflow::Spill)
+		{
+			return spilled;
+		}
+		else
 		{
-			std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			arr.push_back(byte_);
+			return false;
+		}
+	}
 
-			return (arr.size() - 1);
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u8* Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Data()
+	{
+		return IsDynamic() ? dataDynamic.data() : StaticData();
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u8* Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StaticData()
+	{
+		if constexpr (HasSink)
+		{
+			return sink->Data();
 		}
 		else
 		{
-			std::array<u8, Size>& arr = std::get<std::array<u8, Size>>(data);
-			arr[dataStaticSize++]	  = byte_;
+			return dataStatic.data();
+		}
+	}
 
-			return (dataStaticSize - 1);
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	const u8* Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StaticData() const
+	{
+		if constexpr (HasSink)
+		{
+			return sink->Data();
 		}
+		else
+		{
+			return dataStatic.data();
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StaticFits(const u64 size_)
+	{
+		if (StaticHasRoom(size_))
+		{
+			return true;
+		}
+
+		if constexpr (OnOverflow == Overflow::Throw)
+		{
+			throw std::runtime_error("Fixed Size exceeded during Pack!");
+		}
+		else if constexpr (OnOverflow == Overflow::Flag)
+		{
+			overflowed = true;
+		}
+		else
+		{
+			// Moved once. Everything from here on goes through dataDynamic
+			dataDynamic.reserve(dataStaticSize * 2 + size_);
+			dataDynamic.assign(StaticData(), StaticData() + dataStaticSize);
+			spilled = true;
+		}
+
+		return false;
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	u64 Packer<Size, Secure, Local>::PushBytes(const u8* const bytes_, const u64 size_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StaticHasRoom(const u64 size_)
 	{
-		if constexpr (Size == std::numeric_limits<u32>::max())
+		if (overflowed)
+		{
+			return false;
+		}
+
+		if (StaticInBounds(size_))
+		{
+			return true;
+		}
+
+		// Capacity is checked again after Reserve(), in case the sink said yes without growing
+		if constexpr (HasSink)
 		{
-			std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			arr.insert(arr.end(), bytes_, bytes_ + size_);
+			return (size_ <= (std::numeric_limits<u64>::max() - dataStaticSize) && sink->Reserve(dataStaticSize + size_) && StaticInBounds(size_));
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StaticInBounds(const u64 size_) const
+	{
+		if constexpr (HasSink)
+		{
+			return (size_ <= sink->Capacity() && dataStaticSize <= (sink->Capacity() - size_));
+		}
+		else
+		{
+			return (size_ <= Size && dataStaticSize <= (Size - size_));
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u64 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PushByte(const u8 byte_)
+	{
+		if (!IsDynamic())
+		{
+			if (StaticFits(1))
+			{
+				StaticData()[dataStaticSize++] = byte_;
+
+				return (dataStaticSize - 1);
+			}
+			else if (!IsDynamic())
+			{
+				// Dropped
+				return dataStaticSize;
+			}
+		}
+
+		dataDynamic.push_back(byte_);
+
+		return (dataDynamic.size() - 1);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u64 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PushBytes(const u8* const bytes_, const u64 size_)
+	{
+		if (!IsDynamic())
+		{
+			// StaticFits() only passes when StaticInBounds() does. It's checked again right at the copy, so that
+			// the compiler can see it's in bounds
+			if (StaticFits(size_) && StaticInBounds(size_))
+			{
+				memcpy(StaticData() + dataStaticSize, bytes_, size_);
+				dataStaticSize += size_;
+
+				return (dataStaticSize - size_);
+			}
+			else if (!IsDynamic())
+			{
+				// Dropped
+				return dataStaticSize;
+			}
+		}
 
-			return (arr.size() - size_);
+		dataDynamic.insert(dataDynamic.end(), bytes_, bytes_ + size_);
+
+		return (dataDynamic.size() - size_);
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PushString(const char* val_, const u32 len_)
+	{
+		if constexpr (PackNulBase)
+		{
+			// val_ itself may not be null-terminated
+			PushBytes((const u8*)val_, len_ - 1);
+			PushByte('\0');
 		}
 		else
 		{
-			std::array<u8, Size>& arr = std::get<std::array<u8, Size>>(data);
-			memcpy(arr.data() + dataStaticSize, bytes_, size_);
-			dataStaticSize += size_;
+			PushBytes((const u8*)val_, len_);
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u8* Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PushSpace(const u64 size_)
+	{
+		if (!IsDynamic())
+		{
+			if (StaticFits(size_))
+			{
+				dataStaticSize += size_;
 
-			return (dataStaticSize - size_);
+				return (StaticData() + dataStaticSize - size_);
+			}
+			else if (!IsDynamic())
+			{
+				// Dropped
+				return nullptr;
+			}
 		}
+
+		dataDynamic.resize(dataDynamic.size() + size_);
+
+		return (dataDynamic.data() + dataDynamic.size() - size_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::ChangeByte(const u64 position_, const u8 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PopSpace(const u64 size_)
 	{
-		if constexpr (Size == std::numeric_limits<u32>::max())
+		if (IsDynamic())
 		{
-			std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			arr[position_]		 = val_;
+			dataDynamic.resize(dataDynamic.size() - size_);
 		}
 		else
 		{
-			std::array<u8, Size>& arr = std::get<std::array<u8, Size>>(data);
-			arr[position_]			  = val_;
+			dataStaticSize -= size_;
 		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::ChangeBytes(const u64 position_, const u8* const bytes_, const u32 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::ChangeByte(const u64 position_, const u8 val_)
 	{
-		if constexpr (Size == std::numeric_limits<u32>::max())
+		if (IsDynamic())
 		{
-			std::vector<u8>& arr = std::get<std::vector<u8>>(data);
-			arr.insert(arr.begin() + position_, len_ - 1, ByteCodes::NeverUse);
+			dataDynamic[position_] = val_;
 		}
 		else
 		{
-			std::array<u8, Size>& arr = std::get<std::array<u8, Size>>(data);
+			// Positions handed out after a dropped write are past the end
+			if constexpr (OnOverflow == Overflow::Flag)
+			{
+				if (position_ >= dataStaticSize)
+				{
+					return;
+				}
+			}
+
+			StaticData()[position_] = val_;
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::ChangeBytes(const u64 position_, const u8* const bytes_, const u32 len_)
+	{
+		if (!IsDynamic())
+		{
+			if (StaticFits(len_ - 1))
+			{
+				// Shift everything after the placeholder byte along
+				memmove(StaticData() + position_ + len_, StaticData() + position_ + 1, dataStaticSize - (position_ + 1));
 
-			// i32 to avoid position_ = 0 and u32--
-			for (i32 i = (dataStaticSize - 1); i > position_; --i)
+				// Add extra bytes
+				dataStaticSize += (len_ - 1);
+			}
+			else if (!IsDynamic())
 			{
-				// Backwards iteration to avoid overwriting data
-				arr[i + (len_ - 1)] = arr[i];
+				// Dropped
+				return;
 			}
+		}
 
-			// Add extra bytes
-			dataStaticSize += (len_ - 1);
+		if (IsDynamic())
+		{
+			dataDynamic.insert(dataDynamic.begin() + position_, len_ - 1, ByteCodes::NeverUse);
 		}
 
 		for (u32 i = 0; i < len_; ++i)
@@ -796,170 +1455,383 @@ namespace MSGPack
 		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackU8(const u8 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Commit(const bool flush_)
 	{
-		u8 bytes[1 + sizeof(u8)];
-		bytes[0] = ByteCodes::UInt8;
-		bytes[1] = val_;
+		if constexpr (HasSink)
+		{
+			// Positions of deferred headers would be invalidated. Nothing more to give after a spill
+			if (numDeferredOpen || !dataStaticSize || overflowed || IsDynamic())
+			{
+				return;
+			}
 
-		PushBytes(bytes, sizeof(bytes));
+			if (sink->Commit(dataStaticSize, flush_))
+			{
+				dataStaticSize = 0;
+			}
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u64 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PushHeader()
+	{
+		if constexpr (Reserve)
+		{
+			// Room for [Arr32/Map32][u32]. Unused bytes stay as NeverUse until Compact()
+			const u8 bytes[1 + sizeof(u32)] = { ByteCodes::NeverUse, ByteCodes::NeverUse, ByteCodes::NeverUse,
+												ByteCodes::NeverUse, ByteCodes::NeverUse };
+
+			return PushBytes(bytes, sizeof(bytes));
+		}
+		else
+		{
+			return PushByte(ByteCodes::NeverUse);
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::SetHeader(const u64 position_, const u8* const bytes_, const u32 len_)
+	{
+		if constexpr (Reserve)
+		{
+			// Right-align the header so that the padding comes first. Compact() can then
+			// tell padding apart from headers as NeverUse is never a valid ByteCode
+			const u64 headerStart = position_ + (1 + sizeof(u32)) - len_;
+			for (u32 i = 0; i < len_; ++i)
+			{
+				ChangeByte(headerStart + i, bytes_[i]);
+			}
+		}
+		else if (len_ == 1)
+		{
+			ChangeByte(position_, bytes_[0]);
+		}
+		else
+		{
+			ChangeBytes(position_, bytes_, len_);
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::ContainerHeader(const u64 numItems_, const u8 fixCode_, const u8 code16_, const u8 code32_, u8* const bytes_) const
+	{
+		if (numItems_ <= 15)
+		{
+			// Set byte as [fixCode_][numItems_]
+			bytes_[0] = fixCode_ | (u8)numItems_;
+
+			return 1;
+		}
+		else if (numItems_ <= std::numeric_limits<u16>::max())
+		{
+			const u16 nVal = HostToNetwork((u16)numItems_);
+
+			bytes_[0] = code16_;
+			bytes_[1] = nVal		& 0xFF;
+			bytes_[2] = (nVal >> 8) & 0xFF;
+
+			return 1 + sizeof(u16);
+		}
+		else if (numItems_ <= std::numeric_limits<u32>::max())
+		{
+			const u32 nVal = HostToNetwork((u32)numItems_);
+
+			bytes_[0] = code32_;
+			bytes_[1] = nVal		 & 0xFF;
+			bytes_[2] = (nVal >> 8)  & 0xFF;
+			bytes_[3] = (nVal >> 16) & 0xFF;
+			bytes_[4] = (nVal >> 24) & 0xFF;
+
+			return 1 + sizeof(u32);
+		}
+
+		return 0;
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::StartKnown(const u64 numElements_, const u64 position_)
+	{
+		if constexpr (Secure)
+		{
+			// Counted as normal so that EndArray()/EndMap() can check the count
+			if (containerStartIdxs.size())
+			{
+				containerStartIdxs.top().numItems++;
+			}
+
+			PushContainer(position_, numElements_);
+		}
+		else
+		{
+			// No push. The numElements_ that follow will be counted by the enclosing array/map,
+			// so they are discounted from it up front (relies on u64 wrap-around)
+			if (containerStartIdxs.size())
+			{
+				StartAndNumItems& top = containerStartIdxs.top();
+				top.numItems		 += (1 - numElements_);
+				top.numKnownOpen++;
+			}
+			else
+			{
+				rootNumKnownOpen++;
+			}
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PushContainer(const u64 startIdx_, const u64 numDeclared_)
+	{
+		// Regardless of Secure, as the fixed stack would be overrun. One compare per Start
+		if constexpr (MaxDepth != 0)
+		{
+			if (containerStartIdxs.size() == MaxDepth)
+			{
+				throw std::runtime_error("Nesting deeper than MaxDepth during Pack!");
+			}
+		}
+
+		containerStartIdxs.push(StartAndNumItems{ startIdx_, 0, numDeclared_, 0 });
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	bool Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EndKnown()
+	{
+		if constexpr (Secure)
+		{
+			const StartAndNumItems& top = containerStartIdxs.top();
+			if (top.numDeclared == NotDeclared)
+			{
+				return false;
+			}
+
+			// Closed either way, so that the exception doesn't leave it open
+			const bool counted = (top.numItems == top.numDeclared);
+			containerStartIdxs.pop();
+
+			if (!counted)
+			{
+				throw std::runtime_error("Element count differs from StartArray/Map(numItems_) during Pack!");
+			}
+
+			return true;
+		}
+		else
+		{
+			u32& numKnownOpen = containerStartIdxs.size() ? containerStartIdxs.top().numKnownOpen : rootNumKnownOpen;
+			if (!numKnownOpen)
+			{
+				return false;
+			}
+
+			numKnownOpen--;
+			return true;
+		}
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackU16(const u16 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::Compact(const u64 position_)
+	{
+		// Nothing sensible to walk over if writes were dropped
+		if (overflowed)
+		{
+			return;
+		}
+
+		u8* arr = Data();
+
+		// Walk the elements, moving each run between padding bytes down in one go. Every
+		// container is closed by now, so any NeverUse found at an element boundary is padding
+		const u64 size = CurrentSize();
+		u64 readPos	   = position_;
+		u64 writePos   = position_;
+		u64 runStart   = position_;
+
+		while (readPos < size)
+		{
+			if (arr[readPos] == ByteCodes::NeverUse)
+			{
+				memmove(arr + writePos, arr + runStart, readPos - runStart);
+				writePos += (readPos - runStart);
+				runStart  = ++readPos;
+
+				continue;
+			}
+
+			Layout layout;
+			LayoutReader<Local>::Read(arr + readPos, layout);
+
+			readPos += (layout.headerSize + layout.payloadSize);
+		}
+
+		// Final run
+		memmove(arr + writePos, arr + runStart, size - runStart);
+		writePos += (size - runStart);
+
+		if (IsDynamic())
+		{
+			dataDynamic.resize(writePos);
+		}
+		else
+		{
+			dataStaticSize = writePos;
+		}
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeU8(const u8 val_, u8* const bytes_) const
+	{
+		bytes_[0] = ByteCodes::UInt8;
+		bytes_[1] = val_;
+
+		return (1 + sizeof(u8));
+	}
+
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeU16(const u16 val_, u8* const bytes_) const
 	{
 		const u16 nVal = HostToNetwork(val_);
 
-		u8 bytes[1 + sizeof(u16)];
-		bytes[0] = ByteCodes::UInt16;
-		bytes[1] = nVal		   & 0xFF;
-		bytes[2] = (nVal >> 8) & 0xFF;
+		bytes_[0] = ByteCodes::UInt16;
+		bytes_[1] = nVal		   & 0xFF;
+		bytes_[2] = (nVal >> 8) & 0xFF;
 
-		PushBytes(bytes, sizeof(bytes));
+		return (1 + sizeof(u16));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackU32(const u32 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeU32(const u32 val_, u8* const bytes_) const
 	{
 		const u32 nVal = HostToNetwork(val_);
 
-		u8 bytes[1 + sizeof(u32)];
-		bytes[0] = ByteCodes::UInt32;
-		bytes[1] = nVal			& 0xFF;
-		bytes[2] = (nVal >> 8)  & 0xFF;
-		bytes[3] = (nVal >> 16) & 0xFF;
-		bytes[4] = (nVal >> 24) & 0xFF;
+		bytes_[0] = ByteCodes::UInt32;
+		bytes_[1] = nVal			& 0xFF;
+		bytes_[2] = (nVal >> 8)  & 0xFF;
+		bytes_[3] = (nVal >> 16) & 0xFF;
+		bytes_[4] = (nVal >> 24) & 0xFF;
 
-		PushBytes(bytes, sizeof(bytes));
+		return (1 + sizeof(u32));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackU64(const u64 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeU64(const u64 val_, u8* const bytes_) const
 	{
 		const u64 nVal = HostToNetwork(val_);
 
-		u8 bytes[1 + sizeof(u64)];
-		bytes[0] = ByteCodes::UInt64;
-		bytes[1] = nVal			& 0xFF;
-		bytes[2] = (nVal >> 8)  & 0xFF;
-		bytes[3] = (nVal >> 16) & 0xFF;
-		bytes[4] = (nVal >> 24) & 0xFF;
-		bytes[5] = (nVal >> 32) & 0xFF;
-		bytes[6] = (nVal >> 40) & 0xFF;
-		bytes[7] = (nVal >> 48) & 0xFF;
-		bytes[8] = (nVal >> 56) & 0xFF;
-
-		PushBytes(bytes, sizeof(bytes));
+		bytes_[0] = ByteCodes::UInt64;
+		bytes_[1] = nVal			& 0xFF;
+		bytes_[2] = (nVal >> 8)  & 0xFF;
+		bytes_[3] = (nVal >> 16) & 0xFF;
+		bytes_[4] = (nVal >> 24) & 0xFF;
+		bytes_[5] = (nVal >> 32) & 0xFF;
+		bytes_[6] = (nVal >> 40) & 0xFF;
+		bytes_[7] = (nVal >> 48) & 0xFF;
+		bytes_[8] = (nVal >> 56) & 0xFF;
+
+		return (1 + sizeof(u64));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackI8(const i8 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeI8(const i8 val_, u8* const bytes_) const
 	{
-		u8 bytes[1 + sizeof(i8)];
-		bytes[0] = ByteCodes::Int8;
-		bytes[1] = val_;
+		bytes_[0] = ByteCodes::Int8;
+		bytes_[1] = val_;
 
-		PushBytes(bytes, sizeof(bytes));
+		return (1 + sizeof(i8));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackI16(const i16 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeI16(const i16 val_, u8* const bytes_) const
 	{
 		// The u16/u32/u64 in these functions aren't typos; it makes
 		// no difference either way
 		const u16 nVal = HostToNetwork(*(u16*)&val_);
 
-		u8 bytes[1 + sizeof(u16)];
-		bytes[0] = ByteCodes::Int16;
-		bytes[1] = nVal		   & 0xFF;
-		bytes[2] = (nVal >> 8) & 0xFF;
+		bytes_[0] = ByteCodes::Int16;
+		bytes_[1] = nVal		   & 0xFF;
+		bytes_[2] = (nVal >> 8) & 0xFF;
 
-		PushBytes(bytes, sizeof(bytes));
+		return (1 + sizeof(i16));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackI32(const i32 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeI32(const i32 val_, u8* const bytes_) const
 	{
 		const u32 nVal = HostToNetwork(*(u32*)&val_);
 
-		u8 bytes[1 + sizeof(u32)];
-		bytes[0] = ByteCodes::Int32;
-		bytes[1] = nVal			& 0xFF;
-		bytes[2] = (nVal >> 8)  & 0xFF;
-		bytes[3] = (nVal >> 16) & 0xFF;
-		bytes[4] = (nVal >> 24) & 0xFF;
+		bytes_[0] = ByteCodes::Int32;
+		bytes_[1] = nVal			& 0xFF;
+		bytes_[2] = (nVal >> 8)  & 0xFF;
+		bytes_[3] = (nVal >> 16) & 0xFF;
+		bytes_[4] = (nVal >> 24) & 0xFF;
 
-		PushBytes(bytes, sizeof(bytes));
+		return (1 + sizeof(i32));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackI64(const i64 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeI64(const i64 val_, u8* const bytes_) const
 	{
 		const u64 nVal = HostToNetwork(*(u64*)&val_);
 
-		u8 bytes[1 + sizeof(u64)];
-		bytes[0] = ByteCodes::Int64;
-		bytes[1] = nVal			& 0xFF;
-		bytes[2] = (nVal >> 8)  & 0xFF;
-		bytes[3] = (nVal >> 16) & 0xFF;
-		bytes[4] = (nVal >> 24) & 0xFF;
-		bytes[5] = (nVal >> 32) & 0xFF;
-		bytes[6] = (nVal >> 40) & 0xFF;
-		bytes[7] = (nVal >> 48) & 0xFF;
-		bytes[8] = (nVal >> 56) & 0xFF;
-
-		PushBytes(bytes, sizeof(bytes));
+		bytes_[0] = ByteCodes::Int64;
+		bytes_[1] = nVal			& 0xFF;
+		bytes_[2] = (nVal >> 8)  & 0xFF;
+		bytes_[3] = (nVal >> 16) & 0xFF;
+		bytes_[4] = (nVal >> 24) & 0xFF;
+		bytes_[5] = (nVal >> 32) & 0xFF;
+		bytes_[6] = (nVal >> 40) & 0xFF;
+		bytes_[7] = (nVal >> 48) & 0xFF;
+		bytes_[8] = (nVal >> 56) & 0xFF;
+
+		return (1 + sizeof(i64));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackF32(const f32 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeF32(const f32 val_, u8* const bytes_) const
 	{
 		// We can recover f32/f64 values back later
 		const u32 nVal = HostToNetwork(*(u32*)&val_);
 
-		u8 bytes[1 + sizeof(u32)];
-		bytes[0] = ByteCodes::Float32;
-		bytes[1] = nVal			& 0xFF;
-		bytes[2] = (nVal >> 8)  & 0xFF;
-		bytes[3] = (nVal >> 16) & 0xFF;
-		bytes[4] = (nVal >> 24) & 0xFF;
+		bytes_[0] = ByteCodes::Float32;
+		bytes_[1] = nVal			& 0xFF;
+		bytes_[2] = (nVal >> 8)  & 0xFF;
+		bytes_[3] = (nVal >> 16) & 0xFF;
+		bytes_[4] = (nVal >> 24) & 0xFF;
 
-		PushBytes(bytes, sizeof(bytes));
+		return (1 + sizeof(f32));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackF64(const f64 val_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	u32 Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::EncodeF64(const f64 val_, u8* const bytes_) const
 	{
 		const u64 nVal = HostToNetwork(*(u64*)&val_);
 
-		u8 bytes[1 + sizeof(u64)];
-		bytes[0] = ByteCodes::Float64;
-		bytes[1] = nVal			& 0xFF;
-		bytes[2] = (nVal >> 8)  & 0xFF;
-		bytes[3] = (nVal >> 16) & 0xFF;
-		bytes[4] = (nVal >> 24) & 0xFF;
-		bytes[5] = (nVal >> 32) & 0xFF;
-		bytes[6] = (nVal >> 40) & 0xFF;
-		bytes[7] = (nVal >> 48) & 0xFF;
-		bytes[8] = (nVal >> 56) & 0xFF;
-
-		PushBytes(bytes, sizeof(bytes));
+		bytes_[0] = ByteCodes::Float64;
+		bytes_[1] = nVal			& 0xFF;
+		bytes_[2] = (nVal >> 8)  & 0xFF;
+		bytes_[3] = (nVal >> 16) & 0xFF;
+		bytes_[4] = (nVal >> 24) & 0xFF;
+		bytes_[5] = (nVal >> 32) & 0xFF;
+		bytes_[6] = (nVal >> 40) & 0xFF;
+		bytes_[7] = (nVal >> 48) & 0xFF;
+		bytes_[8] = (nVal >> 56) & 0xFF;
+
+		return (1 + sizeof(f64));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackStr8(const char* val_, const u8 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackStr8(const char* val_, const u8 len_)
 	{
 		u8 bytes[1 + sizeof(u8)];
 		bytes[0] = ByteCodes::String8;
 		bytes[1] = len_;
 
 		PushBytes(bytes, sizeof(bytes));
-		PushBytes((u8*)val_, len_);
+		PushString(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackStr16(const char* val_, const u16 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackStr16(const char* val_, const u16 len_)
 	{
 		const u16 nLen = HostToNetwork(len_);
 
@@ -969,11 +1841,11 @@ namespace MSGPack
 		bytes[2] = (nLen >> 8) & 0xFF;
 
 		PushBytes(bytes, sizeof(bytes));
-		PushBytes((u8*)val_, len_);
+		PushString(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackStr32(const char* val_, const u32 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackStr32(const char* val_, const u32 len_)
 	{
 		const u32 nLen = HostToNetwork(len_);
 
@@ -985,11 +1857,11 @@ namespace MSGPack
 		bytes[4] = (nLen >> 24) & 0xFF;
 
 		PushBytes(bytes, sizeof(bytes));
-		PushBytes((u8*)val_, len_);
+		PushString(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackBin8(const u8* const val_, const u8 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackBin8(const u8* const val_, const u8 len_)
 	{
 		u8 bytes[1 + sizeof(u8)];
 		bytes[0] = ByteCodes::Bin8;
@@ -999,8 +1871,8 @@ namespace MSGPack
 		PushBytes(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackBin16(const u8* const val_, const u16 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackBin16(const u8* const val_, const u16 len_)
 	{
 		const u16 nLen = HostToNetwork(len_);
 
@@ -1013,8 +1885,8 @@ namespace MSGPack
 		PushBytes(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackBin32(const u8* const val_, const u32 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackBin32(const u8* const val_, const u32 len_)
 	{
 		const u32 nLen = HostToNetwork(len_);
 
@@ -1029,9 +1901,9 @@ namespace MSGPack
 		PushBytes(val_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
 	template <u32 N>
-	void Packer<Size, Secure, Local>::PackFixExtN(const i32 type_, const u8* const data_)
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackFixExtN(const i32 type_, const u8* const data_)
 	{
 		const u32 nType = HostToNetwork(*(u32*)&type_);
 
@@ -1050,8 +1922,8 @@ namespace MSGPack
 		PushBytes(bytes, sizeof(bytes));
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackExt8(const i32 type_, const u8* const data_, const u8 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackExt8(const i32 type_, const u8* const data_, const u8 len_)
 	{
 		const u32 nType = HostToNetwork(*(u32*)&type_);
 
@@ -1067,8 +1939,8 @@ namespace MSGPack
 		PushBytes(data_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackExt16(const i32 type_, const u8* const data_, const u16 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackExt16(const i32 type_, const u8* const data_, const u16 len_)
 	{
 		const u32 nType = HostToNetwork(*(u32*)&type_);
 		const u16 nLen  = HostToNetwork(len_);
@@ -1086,8 +1958,8 @@ namespace MSGPack
 		PushBytes(data_, len_);
 	}
 
-	template <u32 Size, bool Secure, bool Local>
-	void Packer<Size, Secure, Local>::PackExt32(const i32 type_, const u8* const data_, const u32 len_)
+	template <u32 Size, bool Secure, bool Local, bool Reserve, Overflow OnOverflow, typename Sink, u32 MaxDepth>
+	void Packer<Size, Secure, Local, Reserve, OnOverflow, Sink, MaxDepth>::PackExt32(const i32 type_, const u8* const data_, const u32 len_)
 	{
 		const u32 nType = HostToNetwork(*(u32*)&type_);
 		const u32 nLen  = HostToNetwork(len_);
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Literals.h"
+#include "Key.h"
 
 #include <string>
+#include <string_view>
 
 namespace MSGPack
 {
@@ -50,7 +52,13 @@ namespace MSGPack
 		template <typename S>
 		void PackNumber(const S val_)
 		{
-			static_cast<T&>(*this).PackNumber<S>(val_);
+			static_cast<T&>(*this).template PackNumber<S>(val_);
+		}
+
+		template <typename S>
+		u64 PackFixedNumber(const S val_)
+		{
+			return static_cast<T&>(*this).template PackFixedNumber<S>(val_);
 		}
 
 		void PackString(const char* val_)
@@ -58,6 +66,22 @@ namespace MSGPack
 			static_cast<T&>(*this).PackString(val_);
 		}
 
+		void PackString(const char* val_, const u32 len_)
+		{
+			static_cast<T&>(*this).PackString(val_, len_);
+		}
+
+		void PackString(const std::string_view val_)
+		{
+			static_cast<T&>(*this).PackString(val_);
+		}
+
+		template <u64 N>
+		void PackKey(const Key<N>& key_)
+		{
+			static_cast<T&>(*this).PackKey(key_);
+		}
+
 		void PackBinary(const u8* const val_, const u32 len_)
 		{
 			static_cast<T&>(*this).PackBinary(val_, len_);
@@ -68,11 +92,32 @@ namespace MSGPack
 			static_cast<T&>(*this).PackExt(type_, data_, len_);
 		}
 
+		void PackRaw(const std::pair<void*, u64>& raw_)
+		{
+			static_cast<T&>(*this).PackRaw(raw_);
+		}
+
+		void PackRaw(const std::pair<void*, u64>& raw_, const u64 numElements_)
+		{
+			static_cast<T&>(*this).PackRaw(raw_, numElements_);
+		}
+
 		void StartArray()
 		{
 			static_cast<T&>(*this).StartArray();
 		}
 
+		void StartArray(const u32 numItems_)
+		{
+			static_cast<T&>(*this).StartArray(numItems_);
+		}
+
+		template <typename S>
+		void PackArray(const S* const data_, const u32 num_, const bool fixedWidth_ = false)
+		{
+			static_cast<T&>(*this).PackArray(data_, num_, fixedWidth_);
+		}
+
 		void EndArray()
 		{
 			static_cast<T&>(*this).EndArray();
@@ -83,6 +128,11 @@ namespace MSGPack
 			static_cast<T&>(*this).StartMap();
 		}
 
+		void StartMap(const u32 numItems_)
+		{
+			static_cast<T&>(*this).StartMap(numItems_);
+		}
+
 		void EndMap()
 		{
 			static_cast<T&>(*this).EndMap();
@@ -90,12 +140,28 @@ namespace MSGPack
 
 		u64 CurrentSize() const
 		{
-			return static_cast<T&>(*this).CurrentSize();
+			return static_cast<const T&>(*this).CurrentSize();
+		}
+
+		template <typename S>
+		bool PatchNumber(const u64 position_, const S val_)
+		{
+			return static_cast<T&>(*this).template PatchNumber<S>(position_, val_);
 		}
 
 		std::pair<void*, u64> Message() const
 		{
 			return static_cast<const T&>(*this).Message();
 		}
+
+		bool Overflowed() const
+		{
+			return static_cast<const T&>(*this).Overflowed();
+		}
+
+		void Flush()
+		{
+			static_cast<T&>(*this).Flush();
+		}
 	};
 }
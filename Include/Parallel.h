@@ -0,0 +1,343 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "PackerBase.h"
+#include "Packer.h"
+#include "Unpacker.h"
+#include "Patch.h"
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+
+namespace MSGPack
+{
+	/*
+	*	Runs each task on a std::thread of its own, the first on the calling thread,
+	*	and returns once they have all run. Any callable taking the same vector of
+	*	tasks and returning once they're done can be used in its place, e.g. one
+	*	that hands them to an existing pool.
+	*/
+	struct ThreadExecutor
+	{
+		void operator()(std::vector<std::function<void()>>& tasks_) const;
+	};
+
+	/*
+	*	Packs the items of one large array or map on several threads. The items
+	*	are split into contiguous ranges. A callable packs each range into a
+	*	Packer of its own, and the fragments are then spliced after a single
+	*	header for the whole count. As the items are independent, the result is
+	*	byte for byte what one Packer packing them in order would give.
+	*
+	*		ParallelPacker<> parallel;
+	*		parallel.PackArray(numRecords, [&](ParallelPacker<>::ChunkPacker& packer_, u64 begin_, u64 end_)
+	*		{
+	*			for (u64 i = begin_; i < end_; ++i)
+	*			{
+	*				records[i].Pack(packer_);
+	*			}
+	*		}, std::thread::hardware_concurrency());
+	*
+	*		parallel.Splice(packer); // Or write out Spans() with writev()
+	*
+	*	Secure	 := Checks, on its own thread, that each range packed exactly its
+	*				number of items.
+	*
+	*	Local	 := Passed on to the chunk Packers and used for the header. Must
+	*				match the Packer spliced into.
+	*
+	*	Executor := Runs the range tasks. See ThreadExecutor.
+	*/
+	template <bool	   Secure	= SecureBase,
+			  bool	   Local	= false,
+			  typename Executor = ThreadExecutor>
+	class ParallelPacker
+	{
+	public:
+		/// What each range is packed into
+		using ChunkPacker = Packer<std::numeric_limits<u32>::max(), Secure, Local>;
+
+		ParallelPacker(const Executor& executor_ = Executor());
+		~ParallelPacker();
+
+		/// Packs numItems_ array items, split into up to numChunks_ ranges. packRange_(ChunkPacker&, begin, end) is
+		/// called once for each range, maybe concurrently, and must pack items [begin, end) at the top level.
+		/// Anything it throws is rethrown here once every range is done
+		template <typename F>
+		void PackArray(const u32 numItems_, F&& packRange_, const u32 numChunks_);
+
+		/// As PackArray() for numPairs_ key : value pairs. Each range packs both the keys and values of its pairs
+		template <typename F>
+		void PackMap(const u32 numPairs_, F&& packRange_, const u32 numChunks_);
+
+		/// Packs the array/map into packer_ as one element, copying each fragment once. If packer_ is Secure,
+		/// it checks the fragments again as it goes
+		template <typename T>
+		void Splice(PackerBase<T>& packer_) const;
+
+		/// Returns the header and then each fragment, in order, for a scatter/gather write (e.g. writev())
+		/// without copying. Valid until the next PackArray()/PackMap()
+		std::vector<std::pair<void*, u64>> Spans() const;
+
+		/// Returns the size in bytes of the packed array/map
+		u64 Size() const;
+
+	private:
+		Executor								  executor;
+		std::vector<std::unique_ptr<ChunkPacker>> chunks; // Kept between calls, so that their stores are reused
+		u32										  numChunks; // In use, of chunks
+
+		std::array<u8, 1 + sizeof(u32)> header;
+		u32								 headerSize;
+		u32								 numItems;
+		bool							 isMap;
+
+		/// Packs the ranges of numItems_ items, each of itemElements_ elements
+		template <typename F>
+		void Pack(const u32 numItems_, F&& packRange_, const u32 numChunks_, const u32 itemElements_);
+
+		/// Returns the first item of range chunk_. Range chunk_ ends where range chunk_ + 1 starts
+		u64 RangeStart(const u32 chunk_) const;
+
+		/// Writes the array/map header for numItems_ items, as Packer would
+		void SetHeader(const u32 numItems_, const u8 fixCode_, const u8 code16_, const u8 code32_);
+	};
+
+	/*
+	*	ThreadExecutor
+	*/
+
+	inline void ThreadExecutor::operator()(std::vector<std::function<void()>>& tasks_) const
+	{
+		if (tasks_.empty())
+		{
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		threads.reserve(tasks_.size() - 1);
+		for (u64 i = 1; i < tasks_.size(); ++i)
+		{
+			threads.emplace_back(tasks_[i]);
+		}
+
+		tasks_[0]();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	/*
+	*	Public
+	*/
+
+	template <bool Secure, bool Local, typename Executor>
+	ParallelPacker<Secure, Local, Executor>::ParallelPacker(const Executor& executor_) :
+											 executor(executor_),
+											 numChunks(0),
+											 headerSize(0),
+											 numItems(0),
+											 isMap(false)
+	{
+		SetHeader(0, ByteCodes::FixArr, ByteCodes::Arr16, ByteCodes::Arr32);
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	ParallelPacker<Secure, Local, Executor>::~ParallelPacker()
+	{
+		// A range that threw may have left arrays/maps open, which a Secure Packer throws on when destroyed
+		for (std::unique_ptr<ChunkPacker>& chunk : chunks)
+		{
+			chunk->Clear();
+		}
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	template <typename F>
+	void ParallelPacker<Secure, Local, Executor>::PackArray(const u32 numItems_, F&& packRange_, const u32 numChunks_)
+	{
+		isMap = false;
+		SetHeader(numItems_, ByteCodes::FixArr, ByteCodes::Arr16, ByteCodes::Arr32);
+		Pack(numItems_, packRange_, numChunks_, 1);
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	template <typename F>
+	void ParallelPacker<Secure, Local, Executor>::PackMap(const u32 numPairs_, F&& packRange_, const u32 numChunks_)
+	{
+		isMap = true;
+		SetHeader(numPairs_, ByteCodes::FixMap, ByteCodes::Map16, ByteCodes::Map32);
+		Pack(numPairs_, packRange_, numChunks_, 2);
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	template <typename T>
+	void ParallelPacker<Secure, Local, Executor>::Splice(PackerBase<T>& packer_) const
+	{
+		const u32 itemElements = isMap ? 2 : 1;
+
+		if (isMap)
+		{
+			packer_.StartMap(numItems);
+		}
+		else
+		{
+			packer_.StartArray(numItems);
+		}
+
+		for (u32 i = 0; i < numChunks; ++i)
+		{
+			packer_.PackRaw(chunks[i]->Message(), (RangeStart(i + 1) - RangeStart(i)) * itemElements);
+		}
+
+		if (isMap)
+		{
+			packer_.EndMap();
+		}
+		else
+		{
+			packer_.EndArray();
+		}
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	std::vector<std::pair<void*, u64>> ParallelPacker<Secure, Local, Executor>::Spans() const
+	{
+		std::vector<std::pair<void*, u64>> spans;
+		spans.reserve(1 + numChunks);
+
+		spans.emplace_back((void*)header.data(), headerSize);
+		for (u32 i = 0; i < numChunks; ++i)
+		{
+			spans.push_back(chunks[i]->Message());
+		}
+
+		return spans;
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	u64 ParallelPacker<Secure, Local, Executor>::Size() const
+	{
+		u64 size = headerSize;
+		for (u32 i = 0; i < numChunks; ++i)
+		{
+			size += chunks[i]->CurrentSize();
+		}
+
+		return size;
+	}
+
+	/*
+	*	Private
+	*/
+
+	template <bool Secure, bool Local, typename Executor>
+	template <typename F>
+	void ParallelPacker<Secure, Local, Executor>::Pack(const u32 numItems_, F&& packRange_, const u32 numChunks_, const u32 itemElements_)
+	{
+		// Never an empty range
+		numItems  = numItems_;
+		numChunks = std::min(std::max(numChunks_, 1u), numItems_);
+
+		while (chunks.size() < numChunks)
+		{
+			chunks.emplace_back(new ChunkPacker());
+		}
+
+		// Caught on each thread, so that a failed range can't take the rest down with it
+		std::vector<std::exception_ptr>	   errors(numChunks);
+		std::vector<std::function<void()>> tasks;
+		tasks.reserve(numChunks);
+
+		for (u32 i = 0; i < numChunks; ++i)
+		{
+			tasks.emplace_back([this, &packRange_, &errors, itemElements_, i]()
+			{
+				const u64	 begin	= RangeStart(i);
+				const u64	 end	= RangeStart(i + 1);
+				ChunkPacker& packer = *chunks[i];
+
+				try
+				{
+					packer.Clear();
+					packRange_(packer, begin, end);
+
+					if constexpr (Secure)
+					{
+						Unpacker<true, Local> unpacker(packer.Message());
+						try
+						{
+							for (u64 j = 0; j < (end - begin) * itemElements_; ++j)
+							{
+								unpacker.Skip();
+							}
+						}
+						catch (const std::runtime_error&)
+						{
+							throw std::runtime_error("Range packed too few items during Pack!");
+						}
+
+						if (unpacker.Tell() != packer.CurrentSize())
+						{
+							throw std::runtime_error("Range packed too many items during Pack!");
+						}
+					}
+				}
+				catch (...)
+				{
+					packer.Clear();
+					errors[i] = std::current_exception();
+				}
+			});
+		}
+
+		executor(tasks);
+
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	u64 ParallelPacker<Secure, Local, Executor>::RangeStart(const u32 chunk_) const
+	{
+		return ((u64)numItems * chunk_) / numChunks;
+	}
+
+	template <bool Secure, bool Local, typename Executor>
+	void ParallelPacker<Secure, Local, Executor>::SetHeader(const u32 numItems_, const u8 fixCode_, const u8 code16_, const u8 code32_)
+	{
+		if (numItems_ <= 15)
+		{
+			header[0]  = fixCode_ | (u8)numItems_;
+			headerSize = 1;
+		}
+		else if (numItems_ <= std::numeric_limits<u16>::max())
+		{
+			header[0] = code16_;
+			StoreNumber<Local>(&header[1], (u16)numItems_);
+			headerSize = 1 + sizeof(u16);
+		}
+		else
+		{
+			header[0] = code32_;
+			StoreNumber<Local>(&header[1], numItems_);
+			headerSize = 1 + sizeof(u32);
+		}
+	}
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace MSGPack
+{
+	/*
+	*	Overwrites a number in an already-packed message without repacking it, e.g.
+	*	the sequence number or timestamp of a cached message that is re-sent. The
+	*	element keeps its ByteCode, and so its size, so nothing else in the message
+	*	moves and the cost is O(1). Pack such fields with Packer::PackFixedNumber()
+	*	so that any later value of the same type fits.
+	*
+	*	position_ is the offset of the element's header in the message: as returned
+	*	by Packer::PackFixedNumber(), from Unpacker::Tell() just before unpacking it,
+	*	or TapeEntry::offset.
+	*
+	*	Local := Lengths and numbers are stored in host byte order. Must match
+	*			 the Local parameter of the Packer that produced the data.
+	*/
+
+	/// Overwrites the number at position_ in memBlock_ with val_. Returns false and changes nothing if there's
+	/// no complete number at position_, or if val_ doesn't fit the width it was packed at (e.g. 300 over a UInt8)
+	template <bool Local = false, typename T>
+	bool PatchNumber(const std::pair<void*, u64>& memBlock_, const u64 position_, const T val_);
+
+	/// Returns true if val_ is exactly representable as a W
+	template <typename W, typename T>
+	bool FitsIn(const T val_);
+
+	/// Writes the bytes of val_ to ptr_ as Packer would
+	template <bool Local, typename W>
+	void StoreNumber(u8* const ptr_, const W val_);
+
+	template <bool Local, typename T>
+	bool PatchNumber(const std::pair<void*, u64>& memBlock_, const u64 position_, const T val_)
+	{
+		static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "Only numbers can be patched!");
+
+		if (position_ >= memBlock_.second)
+		{
+			return false;
+		}
+
+		u8* const ptr  = (u8*)memBlock_.first + position_;
+		const u64 left = memBlock_.second - position_;
+		const u8  code = *ptr;
+
+		// Fixints are in the ByteCode itself
+		if (code <= 0x7f)
+		{
+			if (!FitsIn<u8>(val_) || (u8)val_ > 0x7f)
+			{
+				return false;
+			}
+
+			*ptr = (u8)val_;
+			return true;
+		}
+		else if (code >= ByteCodes::FixInt8)
+		{
+			if (!FitsIn<i8>(val_) || (i8)val_ < -32 || (i8)val_ >= 0)
+			{
+				return false;
+			}
+
+			*ptr = (u8)(i8)val_;
+			return true;
+		}
+
+		// Everything else is the ByteCode followed by the number at its full width
+		switch (code)
+		{
+			case UInt8:
+			{
+				return (left > sizeof(u8) && FitsIn<u8>(val_)) ? (StoreNumber<Local>(ptr + 1, (u8)val_), true) : false;
+			}
+
+			case UInt16:
+			{
+				return (left > sizeof(u16) && FitsIn<u16>(val_)) ? (StoreNumber<Local>(ptr + 1, (u16)val_), true) : false;
+			}
+
+			case UInt32:
+			{
+				return (left > sizeof(u32) && FitsIn<u32>(val_)) ? (StoreNumber<Local>(ptr + 1, (u32)val_), true) : false;
+			}
+
+			case UInt64:
+			{
+				return (left > sizeof(u64) && FitsIn<u64>(val_)) ? (StoreNumber<Local>(ptr + 1, (u64)val_), true) : false;
+			}
+
+			case Int8:
+			{
+				return (left > sizeof(i8) && FitsIn<i8>(val_)) ? (StoreNumber<Local>(ptr + 1, (i8)val_), true) : false;
+			}
+
+			case Int16:
+			{
+				return (left > sizeof(i16) && FitsIn<i16>(val_)) ? (StoreNumber<Local>(ptr + 1, (i16)val_), true) : false;
+			}
+
+			case Int32:
+			{
+				return (left > sizeof(i32) && FitsIn<i32>(val_)) ? (StoreNumber<Local>(ptr + 1, (i32)val_), true) : false;
+			}
+
+			case Int64:
+			{
+				return (left > sizeof(i64) && FitsIn<i64>(val_)) ? (StoreNumber<Local>(ptr + 1, (i64)val_), true) : false;
+			}
+
+			case Float32:
+			{
+				return (left > sizeof(f32) && FitsIn<f32>(val_)) ? (StoreNumber<Local>(ptr + 1, (f32)val_), true) : false;
+			}
+
+			case Float64:
+			{
+				return (left > sizeof(f64) && FitsIn<f64>(val_)) ? (StoreNumber<Local>(ptr + 1, (f64)val_), true) : false;
+			}
+
+			default:
+			{
+				// Not a number
+				return false;
+			}
+		}
+	}
+
+	template <typename W, typename T>
+	bool FitsIn(const T val_)
+	{
+		if constexpr (std::is_floating_point_v<W>)
+		{
+			// Floats only ever patch floats, as the unpacked type depends on the ByteCode
+			return (std::is_floating_point_v<T> && (sizeof(W) >= sizeof(T) || (T)(W)val_ == val_));
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			return false;
+		}
+		else if constexpr (std::is_signed_v<T>)
+		{
+			if (val_ < 0)
+			{
+				return (std::is_signed_v<W> && (i64)val_ >= (i64)std::numeric_limits<W>::min());
+			}
+
+			return ((u64)val_ <= (u64)std::numeric_limits<W>::max());
+		}
+		else
+		{
+			return ((u64)val_ <= (u64)std::numeric_limits<W>::max());
+		}
+	}
+
+	template <bool Local, typename W>
+	void StoreNumber(u8* const ptr_, const W val_)
+	{
+		if constexpr (Local)
+		{
+			memcpy(ptr_, &val_, sizeof(W));
+		}
+		else
+		{
+			// Big-endian, from the bit pattern so that floats are handled too
+			std::conditional_t<sizeof(W) == sizeof(u8), u8, std::conditional_t<sizeof(W) == sizeof(u16), u16,
+			std::conditional_t<sizeof(W) == sizeof(u32), u32, u64>>> bits;
+			memcpy(&bits, &val_, sizeof(W));
+
+			for (u64 i = 0; i < sizeof(W); ++i)
+			{
+				ptr_[i] = (u8)(bits >> ((sizeof(W) - 1 - i) * 8));
+			}
+		}
+	}
+}
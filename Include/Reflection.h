@@ -0,0 +1,336 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "PackerBase.h"
+#include "UnpackerBase.h"
+#include "Key.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <cstring>
+#include <type_traits>
+
+/*
+*	Declares the fields of a struct/class for MSGPack::Pack() and MSGPack::Unpack(),
+*	which then (un)pack it as a map of field name : value. Goes inside the type:
+*
+*	struct Reading
+*	{
+*		u64				 timestamp;
+*		std::string		 unit;
+*		std::vector<f32> samples;
+*
+*		MSGPACK_FIELDS(timestamp, unit, samples)
+*	};
+*
+*	Fields may be numbers, bools, std::string, std::vector of any of these, or other
+*	types with MSGPACK_FIELDS. Up to 32 fields are supported.
+*/
+#define MSGPACK_FIELDS(...)																	\
+	static constexpr auto MSGPackFields()													\
+	{																						\
+		return std::make_tuple(MSGPACK_FOR_EACH(MSGPACK_FIELD, __VA_ARGS__));				\
+	}
+
+#define MSGPACK_FIELD(name_) ::MSGPack::MakeField(#name_, [](auto& self_) -> auto& { return self_.name_; })
+
+/// Applies m_ to each argument, separated by commas
+#define MSGPACK_EXPAND(x_) x_
+#define MSGPACK_FE_1(m_, x_) m_(x_)
+#define MSGPACK_FE_2(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_1(m_, __VA_ARGS__))
+#define MSGPACK_FE_3(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_2(m_, __VA_ARGS__))
+#define MSGPACK_FE_4(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_3(m_, __VA_ARGS__))
+#define MSGPACK_FE_5(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_4(m_, __VA_ARGS__))
+#define MSGPACK_FE_6(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_5(m_, __VA_ARGS__))
+#define MSGPACK_FE_7(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_6(m_, __VA_ARGS__))
+#define MSGPACK_FE_8(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_7(m_, __VA_ARGS__))
+#define MSGPACK_FE_9(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_8(m_, __VA_ARGS__))
+#define MSGPACK_FE_10(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_9(m_, __VA_ARGS__))
+#define MSGPACK_FE_11(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_10(m_, __VA_ARGS__))
+#define MSGPACK_FE_12(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_11(m_, __VA_ARGS__))
+#define MSGPACK_FE_13(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_12(m_, __VA_ARGS__))
+#define MSGPACK_FE_14(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_13(m_, __VA_ARGS__))
+#define MSGPACK_FE_15(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_14(m_, __VA_ARGS__))
+#define MSGPACK_FE_16(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_15(m_, __VA_ARGS__))
+#define MSGPACK_FE_17(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_16(m_, __VA_ARGS__))
+#define MSGPACK_FE_18(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_17(m_, __VA_ARGS__))
+#define MSGPACK_FE_19(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_18(m_, __VA_ARGS__))
+#define MSGPACK_FE_20(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_19(m_, __VA_ARGS__))
+#define MSGPACK_FE_21(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_20(m_, __VA_ARGS__))
+#define MSGPACK_FE_22(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_21(m_, __VA_ARGS__))
+#define MSGPACK_FE_23(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_22(m_, __VA_ARGS__))
+#define MSGPACK_FE_24(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_23(m_, __VA_ARGS__))
+#define MSGPACK_FE_25(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_24(m_, __VA_ARGS__))
+#define MSGPACK_FE_26(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_25(m_, __VA_ARGS__))
+#define MSGPACK_FE_27(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_26(m_, __VA_ARGS__))
+#define MSGPACK_FE_28(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_27(m_, __VA_ARGS__))
+#define MSGPACK_FE_29(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_28(m_, __VA_ARGS__))
+#define MSGPACK_FE_30(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_29(m_, __VA_ARGS__))
+#define MSGPACK_FE_31(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_30(m_, __VA_ARGS__))
+#define MSGPACK_FE_32(m_, x_, ...) m_(x_), MSGPACK_EXPAND(MSGPACK_FE_31(m_, __VA_ARGS__))
+#define MSGPACK_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name_, ...) name_
+#define MSGPACK_FOR_EACH(m_, ...) MSGPACK_EXPAND(MSGPACK_FE_PICK(__VA_ARGS__, MSGPACK_FE_32, MSGPACK_FE_31, MSGPACK_FE_30, MSGPACK_FE_29, MSGPACK_FE_28, MSGPACK_FE_27, MSGPACK_FE_26, MSGPACK_FE_25, MSGPACK_FE_24, MSGPACK_FE_23, MSGPACK_FE_22, MSGPACK_FE_21, MSGPACK_FE_20, MSGPACK_FE_19, MSGPACK_FE_18, MSGPACK_FE_17, MSGPACK_FE_16, MSGPACK_FE_15, MSGPACK_FE_14, MSGPACK_FE_13, MSGPACK_FE_12, MSGPACK_FE_11, MSGPACK_FE_10, MSGPACK_FE_9, MSGPACK_FE_8, MSGPACK_FE_7, MSGPACK_FE_6, MSGPACK_FE_5, MSGPACK_FE_4, MSGPACK_FE_3, MSGPACK_FE_2, MSGPACK_FE_1)(m_, __VA_ARGS__))
+
+namespace MSGPack
+{
+	/*
+	*	One entry of MSGPACK_FIELDS. The name is packed at compile time and Access
+	*	returns a reference to the field of the object it's given.
+	*/
+	template <typename Access, u64 N>
+	struct Field
+	{
+		Key<N> key;
+		Access access;
+	};
+
+	/// Returns a Field with name_ packed at compile time
+	template <typename Access, u64 N>
+	constexpr Field<Access, N> MakeField(const char (&name_)[N], const Access access_);
+
+	/// True for types with MSGPACK_FIELDS
+	template <typename T, typename = void>
+	struct IsReflected : std::false_type
+	{
+	};
+
+	template <typename T>
+	struct IsReflected<T, std::void_t<decltype(T::MSGPackFields())>> : std::true_type
+	{
+	};
+
+	/// Packs val_. A type with MSGPACK_FIELDS becomes a map with a key for every field
+	template <typename T, typename V>
+	void Pack(PackerBase<T>& packer_, const V& val_);
+
+	/// Unpacks into val_. For a type with MSGPACK_FIELDS, each key is first compared whole against the field
+	/// packed in the same place, then by length and memcmp against every field. Unknown keys are skipped and
+	/// fields without a key are left as they are
+	template <typename S, typename V>
+	void Unpack(UnpackerBase<S>& unpacker_, V& val_);
+
+	/*
+	*	Internal
+	*/
+
+	template <typename T>
+	struct IsVector : std::false_type
+	{
+	};
+
+	template <typename T>
+	struct IsVector<std::vector<T>> : std::true_type
+	{
+	};
+
+	/// For static_assert()s that only fail when instantiated
+	template <typename T>
+	struct AlwaysFalse : std::false_type
+	{
+	};
+
+	/// If the next key is that of field idx_, as when fields come in the order they were packed, unpacks the
+	/// key and value into it with one memcmp. Returns false, having unpacked nothing, otherwise
+	template <u64 I, typename S, typename V, typename Fields>
+	bool UnpackFieldAt(UnpackerBase<S>& unpacker_, V& val_, const Fields& fields_, const u64 idx_);
+
+	/// Unpacks the value for key_ into the matching field from I onwards. Returns false if no field matches
+	template <u64 I, typename S, typename V, typename Fields>
+	bool UnpackField(UnpackerBase<S>& unpacker_, V& val_, const Fields& fields_, const char* key_, const u32 len_);
+
+	/*
+	*	Public
+	*/
+
+	template <typename Access, u64 N>
+	constexpr Field<Access, N> MakeField(const char (&name_)[N], const Access access_)
+	{
+		return Field<Access, N>{ Key<N>(name_), access_ };
+	}
+
+	template <typename T, typename V>
+	void Pack(PackerBase<T>& packer_, const V& val_)
+	{
+		if constexpr (IsReflected<V>::value)
+		{
+			constexpr auto fields = V::MSGPackFields();
+
+			// Number of fields is known, so the header needs no backpatch
+			packer_.StartMap(std::tuple_size_v<decltype(fields)>);
+			std::apply([&](const auto&... field_)
+			{
+				((packer_.PackKey(field_.key), Pack(packer_, field_.access(val_))), ...);
+			}, fields);
+			packer_.EndMap();
+		}
+		else if constexpr (std::is_same_v<V, bool>)
+		{
+			packer_.PackBool(val_);
+		}
+		else if constexpr (std::is_arithmetic_v<V>)
+		{
+			packer_.PackNumber(val_);
+		}
+		else if constexpr (std::is_same_v<V, std::string>)
+		{
+			packer_.PackString(std::string_view(val_));
+		}
+		else if constexpr (IsVector<V>::value)
+		{
+			using E = typename V::value_type;
+
+			if constexpr (std::is_arithmetic_v<E> && !std::is_same_v<E, bool>)
+			{
+				packer_.PackArray(val_.data(), val_.size());
+			}
+			else
+			{
+				packer_.StartArray(val_.size());
+				for (const E& e : val_)
+				{
+					Pack(packer_, e);
+				}
+				packer_.EndArray();
+			}
+		}
+		else
+		{
+			static_assert(AlwaysFalse<V>::value, "Type can't be packed. Missing MSGPACK_FIELDS?");
+		}
+	}
+
+	template <typename S, typename V>
+	void Unpack(UnpackerBase<S>& unpacker_, V& val_)
+	{
+		if constexpr (IsReflected<V>::value)
+		{
+			constexpr auto fields = V::MSGPackFields();
+
+			const u32 numItems = unpacker_.UnpackMap();
+			for (u32 i = 0; i < numItems; ++i)
+			{
+				if (UnpackFieldAt<0>(unpacker_, val_, fields, i))
+				{
+					continue;
+				}
+
+				const ByteCodes code = unpacker_.PeekType();
+				if (code != FixString && code != String8 && code != String16 && code != String32)
+				{
+					// Not a field name. Skip key and value
+					unpacker_.Skip();
+					unpacker_.Skip();
+					continue;
+				}
+
+				const std::string_view key = unpacker_.UnpackString();
+				if (!UnpackField<0>(unpacker_, val_, fields, key.data(), (u32)key.size()))
+				{
+					unpacker_.Skip();
+				}
+			}
+		}
+		else if constexpr (std::is_same_v<V, bool>)
+		{
+			val_ = unpacker_.UnpackBool();
+		}
+		else if constexpr (std::is_arithmetic_v<V>)
+		{
+			val_ = unpacker_.template UnpackNumber<V>();
+		}
+		else if constexpr (std::is_same_v<V, std::string>)
+		{
+			val_ = unpacker_.UnpackString();
+		}
+		else if constexpr (IsVector<V>::value)
+		{
+			using E = typename V::value_type;
+
+			if constexpr (std::is_arithmetic_v<E> && !std::is_same_v<E, bool>)
+			{
+				// Nothing is unpacked if val_ is too small, so grow it and go again
+				const u32 numItems = unpacker_.UnpackArray(val_.data(), val_.size());
+				if (numItems > val_.size())
+				{
+					val_.resize(numItems);
+					unpacker_.UnpackArray(val_.data(), numItems);
+				}
+
+				val_.resize(numItems);
+			}
+			else if constexpr (std::is_same_v<E, bool>)
+			{
+				// std::vector<bool> hands out proxies rather than bool&
+				val_.resize(unpacker_.UnpackArray());
+				for (u64 i = 0; i < val_.size(); ++i)
+				{
+					val_[i] = unpacker_.UnpackBool();
+				}
+			}
+			else
+			{
+				val_.resize(unpacker_.UnpackArray());
+				for (E& e : val_)
+				{
+					Unpack(unpacker_, e);
+				}
+			}
+		}
+		else
+		{
+			static_assert(AlwaysFalse<V>::value, "Type can't be unpacked. Missing MSGPACK_FIELDS?");
+		}
+	}
+
+	/*
+	*	Internal
+	*/
+
+	template <u64 I, typename S, typename V, typename Fields>
+	bool UnpackFieldAt(UnpackerBase<S>& unpacker_, V& val_, const Fields& fields_, const u64 idx_)
+	{
+		if constexpr (I == std::tuple_size_v<Fields>)
+		{
+			return false;
+		}
+		else if (I != idx_)
+		{
+			return UnpackFieldAt<I + 1>(unpacker_, val_, fields_, idx_);
+		}
+		else
+		{
+			const auto& field = std::get<I>(fields_);
+			if (!unpacker_.UnpackKey(field.key))
+			{
+				return false;
+			}
+
+			Unpack(unpacker_, field.access(val_));
+			return true;
+		}
+	}
+
+	template <u64 I, typename S, typename V, typename Fields>
+	bool UnpackField(UnpackerBase<S>& unpacker_, V& val_, const Fields& fields_, const char* key_, const u32 len_)
+	{
+		if constexpr (I == std::tuple_size_v<Fields>)
+		{
+			return false;
+		}
+		else
+		{
+			// Lengths first, so memcmp only runs on likely matches
+			const auto& field = std::get<I>(fields_);
+			if (field.key.Length() == len_ && !memcmp(field.key.Name(), key_, len_))
+			{
+				Unpack(unpacker_, field.access(val_));
+				return true;
+			}
+
+			return UnpackField<I + 1>(unpacker_, val_, fields_, key_, len_);
+		}
+	}
+}
@@ -0,0 +1,358 @@
+#pragma once
+
+#include "Literals.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#if defined(_WINDOWS)
+	#include <io.h>
+#else
+	#include <unistd.h>
+	#include <sys/uio.h>
+#endif
+
+namespace MSGPack
+{
+	/*
+	*	Sinks let Packer write straight into memory owned by someone else. A Sink is
+	*	any class with the following members:
+	*
+	*	u8*  Data()						  := Start of the memory Packer writes to.
+	*	u64  Capacity() const			  := Number of bytes available at Data().
+	*	bool Reserve(const u64 size_)	  := Makes Capacity() >= size_, keeping existing bytes. May
+	*										 move Data(). Returns false if that isn't possible.
+	*	bool Commit(const u64 size_,	  := Offers the size_ bytes at Data() once they are final (i.e.
+	*				const bool flush_)		 no array/map header is waiting to be backpatched). Returns
+	*										 true if the sink took them, after which Packer starts again
+	*										 from Data(). flush_ is set by Packer::Flush().
+	*
+	*	Count-known arrays/maps (StartArray(numItems_) etc) never need a backpatch, so
+	*	only data inside deferred ones is held back from Commit().
+	*/
+
+	/// Default for Packer. Packer uses its own store
+	struct NoSink
+	{
+	};
+
+	/*
+	*	Writes into a caller-provided buffer of fixed size. Data is never taken, so
+	*	Packer::Message() returns everything packed so far.
+	*/
+	class SpanSink
+	{
+	public:
+		SpanSink(void* data_, const u64 size_);
+
+		u8*	 Data();
+		u64	 Capacity() const;
+		bool Reserve(const u64 size_);
+		bool Commit(const u64 size_, const bool flush_);
+
+	private:
+		u8* data;
+		u64 size;
+	};
+
+	/*
+	*	Growable buffer owned by the caller. Unlike Packer's own store, the memory
+	*	survives the Packer and can be reused by the next one without reallocating.
+	*/
+	class ArenaSink
+	{
+	public:
+		ArenaSink(const u64 initialCapacity_ = 1 << 12);
+
+		u8*	 Data();
+		u64	 Capacity() const;
+		bool Reserve(const u64 size_);
+		bool Commit(const u64 size_, const bool flush_);
+
+	private:
+		std::vector<u8> buffer;
+	};
+
+	/*
+	*	Packs into a chain of chunks of at least chunkSize_ bytes that can be handed
+	*	to writev()/WSASend() as-is. Chunks are only cut between complete elements.
+	*/
+	class IovecSink
+	{
+	public:
+		IovecSink(const u64 chunkSize_ = 1 << 16);
+
+		u8*	 Data();
+		u64	 Capacity() const;
+		bool Reserve(const u64 size_);
+		bool Commit(const u64 size_, const bool flush_);
+
+		/// Returns a [ptr, len] for each completed chunk
+		std::vector<std::pair<void*, u64>> Chunks() const;
+
+		#if !defined(_WINDOWS)
+			/// Returns the completed chunks as iovecs for writev()
+			std::vector<iovec> Iovecs() const;
+		#endif
+
+		/// Drops all completed chunks
+		void Clear();
+
+	private:
+		/// Left uninitialised, unlike a std::vector<u8>, so that a new chunk isn't zeroed only to be packed over
+		struct Chunk
+		{
+			std::unique_ptr<u8[]> data;
+			u64					  size;
+		};
+
+		u64				   chunkSize;
+		Chunk			   current; // Whose size is its capacity until it's cut
+		std::vector<Chunk> chunks;
+
+		/// Returns a chunk of size_ uninitialised bytes
+		static Chunk NewChunk(const u64 size_);
+	};
+
+	/*
+	*	Writes to a file descriptor (file, pipe, socket) every time at least chunkSize_
+	*	bytes are final, so messages larger than chunkSize_ never need to be resident.
+	*	Call Packer::Flush() to write whatever remains.
+	*/
+	class FdSink
+	{
+	public:
+		FdSink(const int fd_, const u64 chunkSize_ = 1 << 16);
+
+		u8*	 Data();
+		u64	 Capacity() const;
+		bool Reserve(const u64 size_);
+		bool Commit(const u64 size_, const bool flush_);
+
+	private:
+		int				fd;
+		u64				chunkSize;
+		std::vector<u8> buffer;
+	};
+
+	/*
+	*	SpanSink
+	*/
+
+	inline SpanSink::SpanSink(void* data_, const u64 size_) :
+							  data((u8*)data_),
+							  size(size_)
+	{
+	}
+
+	inline u8* SpanSink::Data()
+	{
+		return data;
+	}
+
+	inline u64 SpanSink::Capacity() const
+	{
+		return size;
+	}
+
+	inline bool SpanSink::Reserve(const u64 size_)
+	{
+		return (size_ <= size);
+	}
+
+	inline bool SpanSink::Commit(const u64 /*size_*/, const bool /*flush_*/)
+	{
+		// Everything stays in the caller's buffer
+		return false;
+	}
+
+	/*
+	*	ArenaSink
+	*/
+
+	inline ArenaSink::ArenaSink(const u64 initialCapacity_)
+	{
+		buffer.resize(initialCapacity_);
+	}
+
+	inline u8* ArenaSink::Data()
+	{
+		return buffer.data();
+	}
+
+	inline u64 ArenaSink::Capacity() const
+	{
+		return buffer.size();
+	}
+
+	inline bool ArenaSink::Reserve(const u64 size_)
+	{
+		if (size_ > buffer.size())
+		{
+			// Double to keep pushes amortised O(1)
+			buffer.resize(std::max<u64>(size_, buffer.size() * 2));
+		}
+
+		return true;
+	}
+
+	inline bool ArenaSink::Commit(const u64 /*size_*/, const bool /*flush_*/)
+	{
+		return false;
+	}
+
+	/*
+	*	IovecSink
+	*/
+
+	inline IovecSink::IovecSink(const u64 chunkSize_) :
+								chunkSize(chunkSize_),
+								current(NewChunk(chunkSize_))
+	{
+	}
+
+	inline u8* IovecSink::Data()
+	{
+		return current.data.get();
+	}
+
+	inline u64 IovecSink::Capacity() const
+	{
+		return current.size;
+	}
+
+	inline bool IovecSink::Reserve(const u64 size_)
+	{
+		if (size_ > current.size)
+		{
+			// A single element bigger than a chunk makes a bigger chunk
+			Chunk bigger = NewChunk(std::max<u64>(size_, current.size * 2));
+			memcpy(bigger.data.get(), current.data.get(), current.size);
+			current = std::move(bigger);
+		}
+
+		return true;
+	}
+
+	inline bool IovecSink::Commit(const u64 size_, const bool flush_)
+	{
+		if (size_ < chunkSize && !flush_)
+		{
+			return false;
+		}
+
+		// Cut the chunk here and start a new one. No bytes are copied or zeroed
+		current.size = size_;
+		chunks.push_back(std::move(current));
+
+		current = NewChunk(chunkSize);
+
+		return true;
+	}
+
+	inline std::vector<std::pair<void*, u64>> IovecSink::Chunks() const
+	{
+		std::vector<std::pair<void*, u64>> out;
+		out.reserve(chunks.size());
+
+		for (const Chunk& chunk : chunks)
+		{
+			out.emplace_back((void*)chunk.data.get(), chunk.size);
+		}
+
+		return out;
+	}
+
+	#if !defined(_WINDOWS)
+		inline std::vector<iovec> IovecSink::Iovecs() const
+		{
+			std::vector<iovec> out;
+			out.reserve(chunks.size());
+
+			for (const Chunk& chunk : chunks)
+			{
+				out.push_back(iovec{ (void*)chunk.data.get(), chunk.size });
+			}
+
+			return out;
+		}
+	#endif
+
+	inline void IovecSink::Clear()
+	{
+		chunks.clear();
+	}
+
+	inline IovecSink::Chunk IovecSink::NewChunk(const u64 size_)
+	{
+		// new[] without () leaves the bytes uninitialised
+		return Chunk{ std::unique_ptr<u8[]>(new u8[size_]), size_ };
+	}
+
+	/*
+	*	FdSink
+	*/
+
+	inline FdSink::FdSink(const int fd_, const u64 chunkSize_) :
+						  fd(fd_),
+						  chunkSize(chunkSize_)
+	{
+		buffer.resize(chunkSize);
+	}
+
+	inline u8* FdSink::Data()
+	{
+		return buffer.data();
+	}
+
+	inline u64 FdSink::Capacity() const
+	{
+		return buffer.size();
+	}
+
+	inline bool FdSink::Reserve(const u64 size_)
+	{
+		if (size_ > buffer.size())
+		{
+			buffer.resize(std::max<u64>(size_, buffer.size() * 2));
+		}
+
+		return true;
+	}
+
+	inline bool FdSink::Commit(const u64 size_, const bool flush_)
+	{
+		if (size_ < chunkSize && !flush_)
+		{
+			return false;
+		}
+
+		// write() may take less than asked for
+		u64 written = 0;
+		while (written < size_)
+		{
+			#if defined(_WINDOWS)
+				const int res = _write(fd, buffer.data() + written, (unsigned int)(size_ - written));
+			#else
+				const ssize_t res = write(fd, buffer.data() + written, size_ - written);
+			#endif
+
+			if (res < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			else if (res <= 0)
+			{
+				throw std::runtime_error("Failed to write to fd during Pack!");
+			}
+
+			written += res;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "Layout.h"
+#include "Unpacker.h"
+
+#include <vector>
+#include <algorithm>
+#include <tuple>
+#include <string_view>
+#include <stdexcept>
+#include <initializer_list>
+
+namespace MSGPack
+{
+	/*
+	*	Result of every StreamUnpacker operation
+	*/
+	enum class StreamStatus : u8
+	{
+		Ok,		  // Element unpacked
+		NeedMore, // Element isn't complete yet. Feed() the next chunk and call again
+		Error	  // Wrong type or invalid ByteCode. Nothing was consumed
+	};
+
+	/*
+	*	Unpacks a message that arrives in chunks (e.g. from a socket), without waiting
+	*	for all of it. Elements contained in a single chunk are returned in place. An
+	*	element split across chunks is collected internally as it arrives, so a call
+	*	that returned NeedMore picks up where it left off once the next chunk is fed.
+	*
+	*	Pointers returned (strings, binary, ext) are valid until the next call to this
+	*	object, or for as long as the chunk they came from, if longer.
+	*
+	*	Secure := Throws on type mismatches rather than returning Error, as Unpacker does.
+	*
+	*	Local  := Disables ntoh[s/l/ll] endianness conversions on the assumption
+	*			  that packing and unpacking is an operation local to the PC.
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class StreamUnpacker
+	{
+	public:
+		StreamUnpacker();
+
+		/// Drops any partially-received element and the current chunk
+		void Reset();
+
+		/// Sets the next chunk of the stream. Must only be called once the previous chunk is used up,
+		/// i.e. after NeedMore. The chunk must stay valid until then
+		void Feed(const std::pair<void*, u64>& chunk_);
+
+		/// Elements still to come before the current top-level element is complete. 0 between messages
+		u64 Remaining() const;
+
+		/// Sets type_ to the ByteCode of the next element
+		StreamStatus PeekType(ByteCodes& type_);
+
+		/// See Unpacker for details of each type
+		StreamStatus UnpackNil();
+		StreamStatus UnpackBool(bool& val_);
+		StreamStatus UnpackString(std::string_view& val_);
+		StreamStatus UnpackBinary(std::pair<void*, u32>& val_);
+		StreamStatus UnpackExt(std::tuple<i32, void*, u32>& val_);
+		StreamStatus UnpackArray(u32& val_);
+		StreamStatus UnpackMap(u32& val_);
+
+		template <typename T>
+		StreamStatus UnpackNumber(T& val_);
+
+	private:
+		const u8*		chunkPtr;
+		u64				chunkSize;
+		u64				chunkPos;
+		std::vector<u8> partial;
+		u64				remaining;
+
+		/// Element found by Next(). Only the element's own header and payload
+		const u8* elementPtr;
+		Layout	  elementLayout;
+		bool	  elementPartial;
+
+		/// Makes the next element contiguous in memory and checks that its ByteCode is one of codes_
+		StreamStatus Next(const std::initializer_list<ByteCodes> codes_);
+
+		/// Tops up partial from the chunk until it holds size_ bytes. Returns false if the chunk ran out
+		bool Collect(const u64 size_);
+
+		/// Moves past the element found by Next()
+		void Consume();
+
+		/// Returns an Unpacker over the element found by Next()
+		Unpacker<false, Local> Element() const;
+	};
+
+	/*
+	*	Public
+	*/
+
+	template <bool Secure, bool Local>
+	StreamUnpacker<Secure, Local>::StreamUnpacker()
+	{
+		Reset();
+	}
+
+	template <bool Secure, bool Local>
+	void StreamUnpacker<Secure, Local>::Reset()
+	{
+		chunkPtr	   = nullptr;
+		chunkSize	   = 0;
+		chunkPos	   = 0;
+		remaining	   = 0;
+		elementPtr	   = nullptr;
+		elementPartial = false;
+
+		partial.clear();
+	}
+
+	template <bool Secure, bool Local>
+	void StreamUnpacker<Secure, Local>::Feed(const std::pair<void*, u64>& chunk_)
+	{
+		if constexpr (Secure)
+		{
+			if (chunkPos != chunkSize)
+			{
+				throw std::runtime_error("Feed() called before the previous chunk was used up!");
+			}
+		}
+
+		chunkPtr  = (const u8*)chunk_.first;
+		chunkSize = chunk_.second;
+		chunkPos  = 0;
+	}
+
+	template <bool Secure, bool Local>
+	u64 StreamUnpacker<Secure, Local>::Remaining() const
+	{
+		return remaining;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::PeekType(ByteCodes& type_)
+	{
+		// Only the first byte is needed
+		const u8* ptr;
+		if (partial.size())
+		{
+			ptr = partial.data();
+		}
+		else if (chunkPos < chunkSize)
+		{
+			ptr = chunkPtr + chunkPos;
+		}
+		else
+		{
+			return StreamStatus::NeedMore;
+		}
+
+		const Unpacker<false, Local> unpacker(std::pair<void*, u64>((void*)ptr, 1));
+		type_ = unpacker.PeekType();
+
+		return StreamStatus::Ok;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackNil()
+	{
+		const StreamStatus status = Next({ ByteCodes::Nil });
+		if (status == StreamStatus::Ok)
+		{
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackBool(bool& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::BoolFalse, ByteCodes::BoolTrue });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().UnpackBool();
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackString(std::string_view& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::FixString, ByteCodes::String8, ByteCodes::String16, ByteCodes::String32 });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().UnpackString();
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackBinary(std::pair<void*, u32>& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::Bin8, ByteCodes::Bin16, ByteCodes::Bin32 });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().UnpackBinary();
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackExt(std::tuple<i32, void*, u32>& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::FixExt1, ByteCodes::FixExt2, ByteCodes::FixExt4, ByteCodes::FixExt8,
+										   ByteCodes::FixExt16, ByteCodes::Ext8, ByteCodes::Ext16, ByteCodes::Ext32 });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().UnpackExt();
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackArray(u32& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::FixArr, ByteCodes::Arr16, ByteCodes::Arr32 });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().UnpackArray();
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackMap(u32& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::FixMap, ByteCodes::Map16, ByteCodes::Map32 });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().UnpackMap();
+			Consume();
+		}
+
+		return status;
+	}
+
+	template <bool Secure, bool Local>
+	template <typename T>
+	StreamStatus StreamUnpacker<Secure, Local>::UnpackNumber(T& val_)
+	{
+		const StreamStatus status = Next({ ByteCodes::FixUInt8, ByteCodes::UInt8, ByteCodes::UInt16, ByteCodes::UInt32,
+										   ByteCodes::UInt64, ByteCodes::FixInt8, ByteCodes::Int8, ByteCodes::Int16,
+										   ByteCodes::Int32, ByteCodes::Int64, ByteCodes::Float32, ByteCodes::Float64 });
+		if (status == StreamStatus::Ok)
+		{
+			val_ = Element().template UnpackNumber<T>();
+			Consume();
+		}
+
+		return status;
+	}
+
+	/*
+	*	Private
+	*/
+
+	template <bool Secure, bool Local>
+	StreamStatus StreamUnpacker<Secure, Local>::Next(const std::initializer_list<ByteCodes> codes_)
+	{
+		ByteCodes code;
+		if (PeekType(code) == StreamStatus::NeedMore)
+		{
+			return StreamStatus::NeedMore;
+		}
+
+		bool matches = false;
+		for (const ByteCodes allowed : codes_)
+		{
+			matches |= (code == allowed);
+		}
+
+		const u64 headerSize = LayoutReader<Local>::HeaderSize(partial.size() ? partial[0] : chunkPtr[chunkPos]);
+		if (!matches || !headerSize)
+		{
+			if constexpr (Secure)
+			{
+				throw std::runtime_error("Incorrect ByteCode found during Unpack!");
+			}
+
+			return StreamStatus::Error;
+		}
+
+		// Whole element in the chunk. The common case and no copies
+		if (partial.empty())
+		{
+			const u64 available = chunkSize - chunkPos;
+			if (available >= headerSize)
+			{
+				LayoutReader<Local>::Read(chunkPtr + chunkPos, elementLayout);
+				if (available >= (elementLayout.headerSize + elementLayout.payloadSize))
+				{
+					elementPtr	   = chunkPtr + chunkPos;
+					elementPartial = false;
+					return StreamStatus::Ok;
+				}
+			}
+		}
+
+		// Split over chunks. Collect the header first to find out how much payload follows
+		if (!Collect(headerSize))
+		{
+			return StreamStatus::NeedMore;
+		}
+
+		LayoutReader<Local>::Read(partial.data(), elementLayout);
+		if (!Collect(elementLayout.headerSize + elementLayout.payloadSize))
+		{
+			return StreamStatus::NeedMore;
+		}
+
+		elementPtr	   = partial.data();
+		elementPartial = true;
+		return StreamStatus::Ok;
+	}
+
+	template <bool Secure, bool Local>
+	bool StreamUnpacker<Secure, Local>::Collect(const u64 size_)
+	{
+		if (partial.size() < size_)
+		{
+			const u64 needed = size_ - partial.size();
+			const u64 taken	 = std::min<u64>(needed, chunkSize - chunkPos);
+
+			partial.insert(partial.end(), chunkPtr + chunkPos, chunkPtr + chunkPos + taken);
+			chunkPos += taken;
+		}
+
+		return (partial.size() >= size_);
+	}
+
+	template <bool Secure, bool Local>
+	void StreamUnpacker<Secure, Local>::Consume()
+	{
+		if (elementPartial)
+		{
+			// Keeps its memory, so anything returned stays valid until the next element is collected
+			partial.clear();
+		}
+		else
+		{
+			chunkPos += (elementLayout.headerSize + elementLayout.payloadSize);
+		}
+
+		// Same counting as for skipping: this element is done, its children are still to come
+		if (remaining)
+		{
+			remaining--;
+		}
+		remaining += elementLayout.numChildren;
+	}
+
+	template <bool Secure, bool Local>
+	Unpacker<false, Local> StreamUnpacker<Secure, Local>::Element() const
+	{
+		return Unpacker<false, Local>(std::pair<void*, u64>((void*)elementPtr, elementLayout.headerSize + elementLayout.payloadSize));
+	}
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "Layout.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+
+namespace MSGPack
+{
+	/*
+	*	One element of a message, as indexed by Tape.
+	*/
+	struct TapeEntry
+	{
+		u64 offset;	  // Position of the element's header in the message. Pass to Unpacker::Seek()
+		u64 end;	  // Tape index just past the element and everything within it, i.e. its next sibling
+		u64 count;	  // Items in an array, pairs in a map, or payload bytes of a string/binary/ext
+		u64 children; // Arrays/maps only. Start of the element's run in the child table
+		u8	type;	  // First byte of the element. See ByteCodes
+	};
+
+	/*
+	*	Structural index of a packed message, built in one pass over its headers. Once
+	*	built, the i'th element of an array is found in O(1) and the value for a map
+	*	key in O(log n), so repeated lookups into the same message don't need to
+	*	unpack it from the start each time. Every top-level element in the message is
+	*	indexed; the first is at index 0 and each following one at the previous one's
+	*	end.
+	*
+	*	The message must outlive the Tape.
+	*
+	*	Secure := Build() throws on malformed data rather than returning false and
+	*			  limits nesting to MaxDepthBase.
+	*
+	*	Local  := Lengths and counts are stored in host byte order. Must match
+	*			  the Local parameter of the Packer that produced the data.
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class Tape
+	{
+	public:
+		/// Returned by Child() and Find() when there is no such element
+		static constexpr const u64 NotFound = std::numeric_limits<u64>::max();
+
+		Tape();
+		Tape(const std::pair<void*, u64>& memBlock_);
+
+		/// Indexes memBlock_, replacing any previous index. Returns false if memBlock_ isn't complete, valid MSGPack
+		bool Build(const std::pair<void*, u64>& memBlock_);
+
+		/// Returns the number of indexed elements
+		u64 Size() const;
+
+		/// Returns the element at tape index idx_
+		const TapeEntry& operator[](const u64 idx_) const;
+
+		/// Returns the tape index of item i_ of the array at idx_
+		u64 Child(const u64 idx_, const u64 i_) const;
+
+		/// Returns the tape index of the value for string key key_ in the map at idx_
+		u64 Find(const u64 idx_, const char* key_) const;
+
+		/// Returns the tape index of the value for the key packed as key_ (header included) in the map at idx_
+		u64 Find(const u64 idx_, const void* key_, const u64 size_) const;
+
+	private:
+		const u8*			   blockPtr;
+		u64					   blockSize;
+		std::vector<TapeEntry> entries;
+
+		/// Tape indices of array items in order, and of map keys sorted by their packed bytes
+		std::vector<u64> children;
+
+		/// Arrays/maps still being indexed by Build()
+		struct Open
+		{
+			u64 idx;  // Tape index of the array/map
+			u64 left; // Elements still to come within it (2 per map pair)
+		};
+
+		/// Returns false, or throws when Secure
+		bool Fail(const char* reason_);
+
+		/// Returns true if type_ is the ByteCode of a map
+		static bool IsMap(const u8 type_);
+
+		/// Writes val_ to ptr_ as Packer would
+		template <typename T>
+		static void StoreLength(u8* const ptr_, const T val_);
+
+		/// Returns the packed size of the element at idx_, including everything within it
+		u64 PackedSize(const u64 idx_) const;
+
+		/// Orders the packed bytes of the element at idx_ against hdr_ followed by payload_. Shorter sorts first
+		int Compare(const u64 idx_, const u8* hdr_, const u64 hdrSize_, const u8* payload_, const u64 payloadSize_) const;
+
+		/// Binary search of the keys of the map at idx_
+		u64 Find(const u64 idx_, const u8* hdr_, const u64 hdrSize_, const u8* payload_, const u64 payloadSize_) const;
+	};
+
+	/*
+	*	Public
+	*/
+
+	template <bool Secure, bool Local>
+	Tape<Secure, Local>::Tape() :
+						 blockPtr(nullptr),
+						 blockSize(0)
+	{
+	}
+
+	template <bool Secure, bool Local>
+	Tape<Secure, Local>::Tape(const std::pair<void*, u64>& memBlock_) :
+						 Tape()
+	{
+		Build(memBlock_);
+	}
+
+	template <bool Secure, bool Local>
+	bool Tape<Secure, Local>::Build(const std::pair<void*, u64>& memBlock_)
+	{
+		blockPtr  = (const u8*)memBlock_.first;
+		blockSize = memBlock_.second;
+
+		entries.clear();
+		children.clear();
+
+		std::vector<Open> open;
+		u64				  pos = 0;
+
+		while (pos < blockSize)
+		{
+			const u64 headerSize = LayoutReader<Local>::HeaderSize(blockPtr[pos]);
+			if (!headerSize)
+			{
+				return Fail("Invalid ByteCode found during Unpack!");
+			}
+			else if ((blockSize - pos) < headerSize)
+			{
+				return Fail("Incomplete message found during Unpack!");
+			}
+
+			Layout layout;
+			LayoutReader<Local>::Read(blockPtr + pos, layout);
+
+			// Written to avoid overflow with hostile lengths. Every element is at least a byte, so a count
+			// bigger than what's left is also caught here before the child table is sized from it
+			const u64 left = blockSize - pos - headerSize;
+			if (layout.payloadSize > left || layout.numChildren > left)
+			{
+				return Fail("Incomplete message found during Unpack!");
+			}
+
+			const u64 idx = entries.size();
+
+			// Note where this element sits within its array, or where it's a map key
+			if (open.size())
+			{
+				const Open&		 parent		 = open.back();
+				const TapeEntry& parentEntry = entries[parent.idx];
+				if (!IsMap(parentEntry.type))
+				{
+					children[parentEntry.children + (parentEntry.count - parent.left)] = idx;
+				}
+				else if (!(parent.left % 2))
+				{
+					children[parentEntry.children + (parentEntry.count - (parent.left / 2))] = idx;
+				}
+			}
+
+			TapeEntry entry;
+			entry.offset   = pos;
+			entry.end	   = idx + 1;
+			entry.count	   = layout.numChildren ? layout.numChildren : layout.payloadSize;
+			entry.children = 0;
+			entry.type	   = blockPtr[pos];
+
+			pos += (headerSize + layout.payloadSize);
+
+			if (layout.numChildren)
+			{
+				if constexpr (Secure)
+				{
+					if (open.size() == MaxDepthBase)
+					{
+						return Fail("Nesting deeper than MaxDepthBase found during Unpack!");
+					}
+				}
+
+				// Maps hold numChildren / 2 pairs, indexed by their keys
+				if (IsMap(entry.type))
+				{
+					entry.count = layout.numChildren / 2;
+				}
+
+				entry.children = children.size();
+				children.resize(children.size() + entry.count);
+
+				entries.push_back(entry);
+				open.push_back({ idx, layout.numChildren });
+				continue;
+			}
+
+			entries.push_back(entry);
+
+			// Each element completed may complete the arrays/maps it closes
+			while (open.size())
+			{
+				Open& parent = open.back();
+				if (--parent.left)
+				{
+					break;
+				}
+
+				TapeEntry& parentEntry = entries[parent.idx];
+				parentEntry.end		   = entries.size();
+
+				if (IsMap(parentEntry.type))
+				{
+					const auto first = children.begin() + parentEntry.children;
+					std::sort(first, first + parentEntry.count, [this](const u64 a_, const u64 b_)
+					{
+						const u64 aSize = PackedSize(a_);
+						return (Compare(b_, blockPtr + entries[a_].offset, aSize, nullptr, 0) > 0);
+					});
+				}
+
+				open.pop_back();
+			}
+		}
+
+		if (open.size())
+		{
+			return Fail("Incomplete message found during Unpack!");
+		}
+
+		return true;
+	}
+
+	template <bool Secure, bool Local>
+	u64 Tape<Secure, Local>::Size() const
+	{
+		return entries.size();
+	}
+
+	template <bool Secure, bool Local>
+	const TapeEntry& Tape<Secure, Local>::operator[](const u64 idx_) const
+	{
+		return entries[idx_];
+	}
+
+	template <bool Secure, bool Local>
+	u64 Tape<Secure, Local>::Child(const u64 idx_, const u64 i_) const
+	{
+		const TapeEntry& entry = entries[idx_];
+		if (i_ >= entry.count || (entry.end - idx_) == 1 || IsMap(entry.type))
+		{
+			return NotFound;
+		}
+
+		return children[entry.children + i_];
+	}
+
+	template <bool Secure, bool Local>
+	u64 Tape<Secure, Local>::Find(const u64 idx_, const char* key_) const
+	{
+		// Same header Packer::PackString() would write, so packed keys can be compared byte for byte
+		const u64 len = strlen(key_) + (PackNulBase ? 1 : 0);
+
+		u8	hdr[1 + sizeof(u32)];
+		u64 hdrSize;
+		if (len <= 31)
+		{
+			hdr[0]	= FixString | (u8)len;
+			hdrSize = 1;
+		}
+		else if (len <= std::numeric_limits<u8>::max())
+		{
+			hdr[0]	= String8;
+			hdr[1]	= (u8)len;
+			hdrSize = 1 + sizeof(u8);
+		}
+		else if (len <= std::numeric_limits<u16>::max())
+		{
+			hdr[0]	= String16;
+			hdrSize = 1 + sizeof(u16);
+			StoreLength<u16>(hdr + 1, (u16)len);
+		}
+		else
+		{
+			hdr[0]	= String32;
+			hdrSize = 1 + sizeof(u32);
+			StoreLength<u32>(hdr + 1, (u32)len);
+		}
+
+		return Find(idx_, hdr, hdrSize, (const u8*)key_, len);
+	}
+
+	template <bool Secure, bool Local>
+	u64 Tape<Secure, Local>::Find(const u64 idx_, const void* key_, const u64 size_) const
+	{
+		return Find(idx_, (const u8*)key_, size_, nullptr, 0);
+	}
+
+	/*
+	*	Private
+	*/
+
+	template <bool Secure, bool Local>
+	bool Tape<Secure, Local>::Fail(const char* reason_)
+	{
+		entries.clear();
+		children.clear();
+
+		if constexpr (Secure)
+		{
+			throw std::runtime_error(reason_);
+		}
+
+		return false;
+	}
+
+	template <bool Secure, bool Local>
+	bool Tape<Secure, Local>::IsMap(const u8 type_)
+	{
+		return ((type_ & 0xf0) == FixMap || type_ == Map16 || type_ == Map32);
+	}
+
+	template <bool Secure, bool Local>
+	template <typename T>
+	void Tape<Secure, Local>::StoreLength(u8* const ptr_, const T val_)
+	{
+		if constexpr (Local)
+		{
+			memcpy(ptr_, &val_, sizeof(T));
+		}
+		else
+		{
+			// Big-endian
+			for (u64 i = 0; i < sizeof(T); ++i)
+			{
+				ptr_[i] = (u8)(val_ >> ((sizeof(T) - 1 - i) * 8));
+			}
+		}
+	}
+
+	template <bool Secure, bool Local>
+	u64 Tape<Secure, Local>::PackedSize(const u64 idx_) const
+	{
+		const u64 end = entries[idx_].end;
+		return ((end < entries.size()) ? entries[end].offset : blockSize) - entries[idx_].offset;
+	}
+
+	template <bool Secure, bool Local>
+	int Tape<Secure, Local>::Compare(const u64 idx_, const u8* hdr_, const u64 hdrSize_, const u8* payload_, const u64 payloadSize_) const
+	{
+		const u64 size	  = PackedSize(idx_);
+		const u64 keySize = hdrSize_ + payloadSize_;
+		if (size != keySize)
+		{
+			return (size < keySize) ? -1 : 1;
+		}
+
+		const u8* const ptr = blockPtr + entries[idx_].offset;
+		if (const int res = memcmp(ptr, hdr_, hdrSize_))
+		{
+			return res;
+		}
+
+		return payloadSize_ ? memcmp(ptr + hdrSize_, payload_, payloadSize_) : 0;
+	}
+
+	template <bool Secure, bool Local>
+	u64 Tape<Secure, Local>::Find(const u64 idx_, const u8* hdr_, const u64 hdrSize_, const u8* payload_, const u64 payloadSize_) const
+	{
+		const TapeEntry& entry = entries[idx_];
+		if ((entry.end - idx_) == 1 || !IsMap(entry.type))
+		{
+			return NotFound;
+		}
+
+		const auto first = children.begin() + entry.children;
+		const auto last	 = first + entry.count;
+		const auto it	 = std::partition_point(first, last, [&](const u64 key_)
+		{
+			return (Compare(key_, hdr_, hdrSize_, payload_, payloadSize_) < 0);
+		});
+
+		if (it == last || Compare(*it, hdr_, hdrSize_, payload_, payloadSize_))
+		{
+			return NotFound;
+		}
+
+		// The value follows its key
+		return entries[*it].end;
+	}
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "Literals.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace MSGPack
+{
+	/*
+	*	Fixed set of threads that run batches of tasks. Each thread has a queue of
+	*	its own, and a batch is dealt out across them in contiguous runs, so that
+	*	neighbouring tasks (e.g. neighbouring messages) stay on one thread. A
+	*	thread runs its own queue from the front, and once that is empty steals
+	*	from the back of another's, so uneven tasks still keep every thread busy.
+	*
+	*	The calling thread works too, so a pool of numThreads_ threads starts
+	*	numThreads_ - 1 of its own. A pool of 1 runs everything on the caller.
+	*	One batch runs at a time. As an Executor, e.g. for ParallelPacker, give
+	*	it by reference: ParallelPacker<Secure, Local, WorkStealingPool&>.
+	*/
+	class WorkStealingPool
+	{
+	public:
+		WorkStealingPool(const u32 numThreads_ = std::max(std::thread::hardware_concurrency(), 1u));
+		~WorkStealingPool();
+
+		WorkStealingPool(const WorkStealingPool&)			 = delete;
+		WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+		/// Returns the number of threads that run tasks, including the caller's
+		u32 NumThreads() const;
+
+		/// Runs every task and returns once they have all run. The first exception thrown by a task is
+		/// rethrown here once the rest are done
+		void operator()(std::vector<std::function<void()>>& tasks_);
+
+	private:
+		struct Queue
+		{
+			std::mutex						   mutex;
+			std::deque<std::function<void()>*> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues; // One per thread. queues[0] is the caller's
+		std::vector<std::thread>			threads;
+
+		std::mutex				mutex;
+		std::condition_variable wake; // A batch has started, or the pool is stopping
+		std::condition_variable done; // The last task of the batch has run
+		u64						batch;
+		bool					stopping;
+		std::atomic<u64>		pending;
+		std::exception_ptr		error;
+
+		/// Loop of every thread but the caller's
+		void Worker(const u32 self_);
+
+		/// Runs one task from queue self_, or stolen from another. Returns false if there were none
+		bool RunOne(const u32 self_);
+	};
+
+	/*
+	*	Public
+	*/
+
+	inline WorkStealingPool::WorkStealingPool(const u32 numThreads_) :
+											  batch(0),
+											  stopping(false),
+											  pending(0)
+	{
+		const u32 numThreads = std::max(numThreads_, 1u);
+
+		for (u32 i = 0; i < numThreads; ++i)
+		{
+			queues.emplace_back(new Queue());
+		}
+
+		// Started once every queue exists
+		for (u32 i = 1; i < numThreads; ++i)
+		{
+			threads.emplace_back(&WorkStealingPool::Worker, this, i);
+		}
+	}
+
+	inline WorkStealingPool::~WorkStealingPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		wake.notify_all();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	inline u32 WorkStealingPool::NumThreads() const
+	{
+		return (u32)queues.size();
+	}
+
+	inline void WorkStealingPool::operator()(std::vector<std::function<void()>>& tasks_)
+	{
+		if (tasks_.empty())
+		{
+			return;
+		}
+
+		// Before any task is queued. A worker still looping in RunOne() from the last batch may take one
+		// straight away, and must not decrement a count that is then overwritten
+		pending = tasks_.size();
+
+		// Contiguous runs, so that a thread stealing takes the tasks furthest from what the owner is on
+		const u64 numQueues = queues.size();
+		for (u64 i = 0; i < numQueues; ++i)
+		{
+			const u64 begin = (tasks_.size() * i) / numQueues;
+			const u64 end	= (tasks_.size() * (i + 1)) / numQueues;
+
+			std::lock_guard<std::mutex> lock(queues[i]->mutex);
+			for (u64 j = begin; j < end; ++j)
+			{
+				queues[i]->tasks.push_back(&tasks_[j]);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batch++;
+		}
+
+		wake.notify_all();
+
+		while (RunOne(0))
+		{
+		}
+
+		std::exception_ptr batchError;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]() { return pending == 0; });
+
+			std::swap(batchError, error);
+		}
+
+		if (batchError)
+		{
+			std::rethrow_exception(batchError);
+		}
+	}
+
+	/*
+	*	Private
+	*/
+
+	inline void WorkStealingPool::Worker(const u32 self_)
+	{
+		u64 seen = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this, seen]() { return stopping || batch != seen; });
+
+				if (stopping)
+				{
+					return;
+				}
+
+				seen = batch;
+			}
+
+			while (RunOne(self_))
+			{
+			}
+		}
+	}
+
+	inline bool WorkStealingPool::RunOne(const u32 self_)
+	{
+		std::function<void()>* task = nullptr;
+
+		// Own queue first, from the front
+		{
+			Queue& queue = *queues[self_];
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+		}
+
+		// Then the others', from the back
+		for (u64 i = 1; !task && i < queues.size(); ++i)
+		{
+			Queue& queue = *queues[(self_ + i) % queues.size()];
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+		}
+
+		if (!task)
+		{
+			return false;
+		}
+
+		try
+		{
+			(*task)();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error)
+			{
+				error = std::current_exception();
+			}
+		}
+
+		// Under the lock, so that the caller can't miss the notify between its check and its wait
+		if (--pending == 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+
+		return true;
+	}
+}
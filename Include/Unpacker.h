@@ -4,6 +4,10 @@
 #include "Bytecodes.h"
 #include "Defines.h"
 #include "UnpackerBase.h"
+#include "Layout.h"
+#include "Key.h"
+#include "FixedStack.h"
+#include "Visitor.h"
 
 #include <cassert>
 #include <array>
@@ -11,19 +15,54 @@
 #include <variant>
 #include <stack>
 #include <stdexcept>
+#include <tuple>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <string_view>
+#include <optional>
 
 namespace MSGPack 
 {
+	/*
+	*	What a Secure Unpacker does when a check fails
+	*/
+	enum class Failure : u8
+	{
+		Throw, // Throws a std::runtime_error
+		Flag   // Records the first failure and stops. See Error()
+	};
+
+	/*
+	*	First failure recorded under Failure::Flag
+	*/
+	enum class UnpackError : u8
+	{
+		None,
+		OutOfBounds,	 // A read or Seek() past the end of the memory block, e.g. a truncated message
+		TypeMismatch,	 // The element isn't of the type asked for
+		TooDeep,		 // Arrays/maps nested deeper than MaxDepthBase
+		InvalidByteCode	 // ByteCodes::NeverUse found where an element should start
+	};
+
 	/*
 	*   Secure := Performs certain run-time checks to guard against
 	*			  incorrectly-packed data
 	*
 	*	Local  := Disables ntoh[s/l/ll] endianness conversions on the assumption
 	*			  that packing and unpacking is an operation local to the PC.
+	*
+	*	OnFailure := What a failed Secure check does. Under Failure::Flag nothing
+	*			  is thrown: the first failure is kept as an UnpackError and the
+	*			  Unpacker moves to the end of the memory block, so that it and every
+	*			  later call return their error value (nullptr, 0, false or empty)
+	*			  until Reset()/Set(). Error() is then checked once, when done.
 	*/
-	template <bool Secure = SecureBase,
-			  bool Local  = false>
-	class Unpacker : public UnpackerBase<Unpacker<Secure, Local>>
+	template <bool	  Secure	= SecureBase,
+			  bool	  Local		= false,
+			  Failure OnFailure = Failure::Throw>
+	class Unpacker : public UnpackerBase<Unpacker<Secure, Local, OnFailure>>
 	{
 	public:
 		Unpacker();
@@ -35,6 +74,15 @@ namespace MSGPack
 		/// Sets the current block to unpack
 		void Set(const std::pair<void*, u64>& memBlock_);
 
+		/// Returns the current position in the memory block, for a later Seek()
+		u64 Tell() const;
+
+		/// Moves to position_ in the memory block, which must be the start of an element (e.g. TapeEntry::offset)
+		void Seek(const u64 position_);
+
+		/// Returns the first failure since Reset()/Set(). Only ever recorded when Secure with Failure::Flag
+		UnpackError Error() const;
+
 		/// Returns the ByteCode of the currently pointed-to type
 		ByteCodes PeekType() const;
 
@@ -48,8 +96,14 @@ namespace MSGPack
 		template <typename T>
 		T UnpackNumber();
 
-		/// Returns a [ptr, len] of the string
-		std::pair<char*, u32> UnpackString();
+		/// Returns the string, which points into the memory block and is not NUL-terminated. Without a NUL packed
+		/// (see PackNulBase), the length is exactly as packed
+		std::string_view UnpackString();
+
+		/// Moves past the next element and returns true if it's key_, with a single memcmp. Otherwise returns
+		/// false and stays put, so the element can be unpacked some other way
+		template <u64 N>
+		bool UnpackKey(const Key<N>& key_);
 
 		/// Returns a ptr to the start of the binary blob in the memory block and its size. This ptr is only valid for
 		/// as long as Unpacker exists, so it's recommended to memcpy/move this to your own memory ASAP
@@ -62,16 +116,54 @@ namespace MSGPack
 		/// Starts the unpack process for an array. Returns the number of elements in the array
 		u32 UnpackArray();
 
+		/// Unpacks a whole array of numbers into out_ and returns the number of elements. Runs of elements of
+		/// the same type are bounds-checked once and converted in a tight loop. If there are more than
+		/// capacity_ elements, nothing is unpacked, so out_ can be grown and the call repeated
+		template <typename T>
+		u32 UnpackArray(T* const out_, const u32 capacity_);
+
 		/// Starts the unpack process for a map. Returns the number of elements in the map
 		u32 UnpackMap();
 
+		/// Moves past the next element of any type, including everything within an array/map. Only
+		/// headers are read. Secure limits nesting to MaxDepthBase
+		void Skip();
+
+		/// Moves past the next element as Skip() does and returns the span of its packed bytes, for
+		/// Packer::PackRaw() to forward unchanged. As with UnpackBinary(), this points into the memory
+		/// block. Returns nullptr and stays put if the element is invalid
+		std::pair<void*, u64> UnpackRaw();
+
+		/// Walks every element from here to the end of the memory block in one pass, calling the matching
+		/// member of handler_ (see Visitor) for each. Returns false, stopped at the offending element, if
+		/// the data is invalid, truncated or nested deeper than MaxDepthBase. Secure also fails as OnFailure says
+		template <typename H>
+		bool Visit(H& handler_);
+
+		/// As the Unpack*() of the same name, but check the next element is complete and of the right type
+		/// first, whatever Secure is. If it isn't, return std::nullopt and stay put; nothing is thrown or
+		/// recorded, so the element can be unpacked some other way
+		bool TryUnpackNil();
+		std::optional<bool> TryUnpackBool();
+		template <typename T>
+		std::optional<T> TryUnpackNumber();
+		std::optional<std::string_view> TryUnpackString();
+		std::optional<std::pair<void*, u32>> TryUnpackBinary();
+		std::optional<std::tuple<i32, void*, u32>> TryUnpackExt();
+		std::optional<u32> TryUnpackArray();
+		std::optional<u32> TryUnpackMap();
+
 	private:
 		const void* blockPtr;
 		u64			blockSize;
 		u64			blockPos;
+		UnpackError error;
+
+		/// Throws reason_, or under Failure::Flag records error_ if it's the first and moves to the end
+		void Fail(const UnpackError error_, const char* reason_);
 
-		/// Safely increments the blockPos member var
-		void IncrementPosition(const u64 increment_);
+		/// Safely increments the blockPos member var. Returns false if it would pass the end
+		bool IncrementPosition(const u64 increment_);
 
 		/// Returns the ptr to the element at blockPtr[blockPos_]
 		template <typename T>
@@ -82,1044 +174,1197 @@ namespace MSGPack
 		u32 NetworkToHost(const u32 val_) const;
 		u64 NetworkToHost(const u64 val_) const;
 
-		/// Fix[type] functions
-		u8					  UnpackFixUInt();
-		i8					  UnpackFixInt();
-		std::pair<char*, u32> UnpackFixStr();
-		u8					  UnpackFixArr();
-		u8					  UnpackFixMap();
-
-		/// Fixed sizes for u8, u16, u32, u64
-		u8  UnpackU8();
-		u16 UnpackU16();
-		u32 UnpackU32();
-		u64 UnpackU64();
-
-		/// Fixed sizes for i8, i16, i32, i64
-		i8  UnpackI8();
-		i16 UnpackI16();
-		i32 UnpackI32();
-		i64 UnpackI64();
-
-		/// Floats and doubles
-		f32 UnpackF32();
-		f64 UnpackF64();
-
-		/// Various string sizes
-		std::pair<char*, u32> UnpackStr8();
-		std::pair<char*, u32> UnpackStr16();
-		std::pair<char*, u32> UnpackStr32();
-
-		/// Binary blobs
-		std::pair<void*, u32> UnpackBin8();
-		std::pair<void*, u32> UnpackBin16();
-		std::pair<void*, u32> UnpackBin32();
-
-		/// FixExt
-		template <u32 N>
-		std::tuple<i32, void*, u32> UnpackFixExt();
-
-		/// Ext
-		std::tuple<i32, void*, u32> UnpackExt8();
-		std::tuple<i32, void*, u32> UnpackExt16();
-		std::tuple<i32, void*, u32> UnpackExt32();
+		/// Unpacks up to max_ consecutive elements that all have ByteCode code_ followed by a W into out_.
+		/// Stops short of the end of the memory block. Returns the number unpacked
+		template <typename T, typename W>
+		u32 UnpackRun(T* const out_, const u32 max_, const u8 code_);
+
+		/// Unpacks up to max_ consecutive positive/negative fixints into out_. Returns the number unpacked
+		template <typename T>
+		u32 UnpackFixIntRun(T* const out_, const u32 max_);
+
+		/// Moves past the next element and everything within it. Returns false on an invalid ByteCode, or a
+		/// failed Secure check under Failure::Flag
+		bool SkipElement();
+
+		/// Checks that the next element is of class_ and moves over all of it. Returns a ptr to its header and
+		/// fills layout_, or returns nullptr and stays put if it's of another class
+		const u8* Next(const TypeClass class_, Layout& layout_);
+
+		/// Returns a ptr to the next element if it's of class_, without moving. Otherwise returns nullptr
+		const u8* Peek(const TypeClass class_);
+
+		/// Returns true if the next element is of class_ and all of it is within the memory block. Never fails
+		bool Complete(const TypeClass class_) const;
+
+		/// Returns the host-order W stored at ptr_
+		template <typename W>
+		W Load(const u8* const ptr_) const;
+
+		/// Passes the number at ptr_, which is known to be complete, to handler_ and moves past it
+		template <typename H>
+		void VisitNumber(H& handler_, const u8* const ptr_);
 	};
 
 	/*
 	*	Public
 	*/
 
-	template <bool Secure, bool Local>
-	Unpacker<Secure, Local>::Unpacker() :
+	template <bool Secure, bool Local, Failure OnFailure>
+	Unpacker<Secure, Local, OnFailure>::Unpacker() :
 							 blockPtr(nullptr),
 							 blockSize(0)
 	{
 		blockPos = 0;
+		error	 = UnpackError::None;
 	}
 
-	template <bool Secure, bool Local>
-	Unpacker<Secure, Local>::Unpacker(const std::pair<void*, u64>& memBlock_) :
+	template <bool Secure, bool Local, Failure OnFailure>
+	Unpacker<Secure, Local, OnFailure>::Unpacker(const std::pair<void*, u64>& memBlock_) :
 							 blockPtr(memBlock_.first),
 							 blockSize(memBlock_.second)
 	{
 		blockPos = 0;
+		error	 = UnpackError::None;
 	}
 
-	template <bool Secure, bool Local>
-	void Unpacker<Secure, Local>::Reset()
+	template <bool Secure, bool Local, Failure OnFailure>
+	void Unpacker<Secure, Local, OnFailure>::Reset()
 	{
 		blockPos = 0;
+		error	 = UnpackError::None;
 	}
 
-	template <bool Secure, bool Local>
-	void Unpacker<Secure, Local>::Set(const std::pair<void*, u64>& memBlock_)
+	template <bool Secure, bool Local, Failure OnFailure>
+	void Unpacker<Secure, Local, OnFailure>::Set(const std::pair<void*, u64>& memBlock_)
 	{
 		blockPtr  = memBlock_.first;
 		blockSize = memBlock_.second;
 		blockPos  = 0;
+		error	  = UnpackError::None;
 	}
 
-	template <bool Secure, bool Local>
-	ByteCodes Unpacker<Secure, Local>::PeekType() const
+	template <bool Secure, bool Local, Failure OnFailure>
+	u64 Unpacker<Secure, Local, OnFailure>::Tell() const
 	{
-		// Get base code
-		const ByteCodes code = (ByteCodes)(*GetData<u8>());
+		return blockPos;
+	}
 
-		// Check for fixed types
-		if (code >= 0x00 && code <= 0x7f)
-		{
-			return ByteCodes::FixUInt8;
-		}
-		else if (code >= 0x80 && code <= 0x8f)
-		{
-			return ByteCodes::FixMap;
-		}
-		else if (code >= 0x90 && code <= 0x9f)
-		{
-			return ByteCodes::FixArr;
-		}
-		else if (code >= 0xa0 && code <= 0xbf)
-		{
-			return ByteCodes::FixString;
-		}
-		else if (code >= 0xe0 && code <= 0xff)
+	template <bool Secure, bool Local, Failure OnFailure>
+	void Unpacker<Secure, Local, OnFailure>::Seek(const u64 position_)
+	{
+		if constexpr (Secure)
 		{
-			return ByteCodes::FixInt8;
+			if (position_ > blockSize)
+			{
+				Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+				return;
+			}
+			else if (error != UnpackError::None)
+			{
+				// Stays at the end until Reset()/Set()
+				return;
+			}
 		}
 
-		// It's not fixed
-		return code;
+		blockPos = position_;
 	}
 
-	template <bool Secure, bool Local>
-	void Unpacker<Secure, Local>::UnpackNil()
+	template <bool Secure, bool Local, Failure OnFailure>
+	UnpackError Unpacker<Secure, Local, OnFailure>::Error() const
 	{
-		const ByteCodes code = PeekType();
-		if (code != ByteCodes::Nil)
-		{
-			// Error
-			if constexpr (Secure)
-			{
-				throw std::runtime_error("Incorrect ByteCode found during Unpack!");
-			}
+		return error;
+	}
 
-			return;
-		}
+	template <bool Secure, bool Local, Failure OnFailure>
+	ByteCodes Unpacker<Secure, Local, OnFailure>::PeekType() const
+	{
+		// Fixed types come back as the first ByteCode of their range
+		return (ByteCodes)ByteTable[*GetData<u8>()].type;
+	}
 
-		// Nil is a single byte
-		IncrementPosition(1);
+	template <bool Secure, bool Local, Failure OnFailure>
+	void Unpacker<Secure, Local, OnFailure>::UnpackNil()
+	{
+		if (Peek(TypeClass::Nil))
+		{
+			// Nil is a single byte
+			IncrementPosition(1);
+		}
 	}
 
-	template <bool Secure, bool Local>
-	bool Unpacker<Secure, Local>::UnpackBool()
+	template <bool Secure, bool Local, Failure OnFailure>
+	bool Unpacker<Secure, Local, OnFailure>::UnpackBool()
 	{
-		const ByteCodes code = PeekType();
-		if ((code != ByteCodes::BoolTrue) && (code != ByteCodes::BoolFalse))
+		const u8* ptr = Peek(TypeClass::Bool);
+		if (!ptr)
 		{
 			// Error
-			if constexpr (Secure)
-			{
-				throw std::runtime_error("Incorrect ByteCode found during Unpack!");
-			}
-
 			return false;
 		}
 
 		// Bool is a single byte
 		IncrementPosition(1);
 
-		return (code == ByteCodes::BoolTrue) ? true : false;
+		return (*ptr == ByteCodes::BoolTrue);
 	}
 
-	template <bool Secure, bool Local>
+	template <bool Secure, bool Local, Failure OnFailure>
 	template <typename T>
-	T Unpacker<Secure, Local>::UnpackNumber()
+	T Unpacker<Secure, Local, OnFailure>::UnpackNumber()
 	{
-		const ByteCodes code = PeekType();
+		const u8* ptr = Peek(TypeClass::Number);
+		if (!ptr)
+		{
+			// Error
+			return std::numeric_limits<T>::signaling_NaN();
+		}
+
+		if constexpr (Secure)
+		{
+			// Once for the whole number, so that none of the cases below can fail part way
+			const ByteInfo& info = ByteTable[*ptr];
+			if ((blockSize - blockPos) < ((u64)info.headerSize + info.fixedLength))
+			{
+				Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+				return std::numeric_limits<T>::signaling_NaN();
+			}
+		}
 
-		switch (code)
+		// Sizes are constant per case rather than read from ByteTable, so that moving on doesn't have to wait
+		// for the lookup. The value follows the ByteCode, other than for fixints
+		switch (ByteTable[*ptr].type)
 		{
 			case FixUInt8:
 			{
-				return UnpackFixUInt();
+				IncrementPosition(1);
+				return (T)*ptr;
+			}
+
+			case FixInt8:
+			{
+				// 111x xxxx is already the two's complement i8 of -1 -> -32
+				IncrementPosition(1);
+				return (T)(i8)*ptr;
 			}
 
 			case UInt8:
 			{
-				return UnpackU8();
+				IncrementPosition(1 + sizeof(u8));
+				return (T)Load<u8>(ptr + 1);
 			}
 
 			case UInt16:
 			{
-				return UnpackU16();
+				IncrementPosition(1 + sizeof(u16));
+				return (T)Load<u16>(ptr + 1);
 			}
 
 			case UInt32:
 			{
-				return UnpackU32();
+				IncrementPosition(1 + sizeof(u32));
+				return (T)Load<u32>(ptr + 1);
 			}
 
 			case UInt64:
 			{
-				return UnpackU64();
-			}
-
-			case FixInt8:
-			{
-				return UnpackFixInt();
+				IncrementPosition(1 + sizeof(u64));
+				return (T)Load<u64>(ptr + 1);
 			}
 
 			case Int8:
 			{
-				return UnpackI8();
+				IncrementPosition(1 + sizeof(i8));
+				return (T)Load<i8>(ptr + 1);
 			}
 
 			case Int16:
 			{
-				return UnpackI16();
+				IncrementPosition(1 + sizeof(i16));
+				return (T)Load<i16>(ptr + 1);
 			}
 
 			case Int32:
 			{
-				return UnpackI32();
+				IncrementPosition(1 + sizeof(i32));
+				return (T)Load<i32>(ptr + 1);
 			}
 
 			case Int64:
 			{
-				return UnpackI64();
+				IncrementPosition(1 + sizeof(i64));
+				return (T)Load<i64>(ptr + 1);
 			}
 
 			case Float32:
 			{
-				return UnpackF32();
-			}
-
-			case Float64:
-			{
-				return UnpackF64();
+				IncrementPosition(1 + sizeof(f32));
+				return (T)Load<f32>(ptr + 1);
 			}
 
 			default:
 			{
-				if constexpr (Secure)
-				{
-					throw std::runtime_error("Incorrect ByteCode found during Unpack!");
-				}
+				IncrementPosition(1 + sizeof(f64));
+				return (T)Load<f64>(ptr + 1);
 			}
 		}
-
-		// Error. blockPos increments etc occur in switch functions
-		return std::numeric_limits<T>::signaling_NaN();
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<char*, u32> Unpacker<Secure, Local>::UnpackString()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::string_view Unpacker<Secure, Local, OnFailure>::UnpackString()
 	{
-		const ByteCodes code = PeekType();
-
-		switch (code)
+		Layout	  layout;
+		const u8* ptr = Next(TypeClass::String, layout);
+		if (!ptr)
 		{
-			case FixString:
-			{
-				return UnpackFixStr();
-			}
+			// Error
+			return std::string_view();
+		}
 
-			case String8:
-			{
-				return UnpackStr8();
-			}
+		std::string_view str((const char*)ptr + layout.headerSize, layout.payloadSize);
 
-			case String16:
+		// The NUL is packed, but isn't part of the string
+		if constexpr (PackNulBase)
+		{
+			if (str.size() && !str.back())
 			{
-				return UnpackStr16();
+				str.remove_suffix(1);
 			}
+		}
 
-			case String32:
-			{
-				return UnpackStr32();
-			}
+		return str;
+	}
 
-			default:
-			{
-				if constexpr (Secure)
-				{
-					throw std::runtime_error("Incorrect ByteCode found during Unpack!");
-				}
-			}
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <u64 N>
+	bool Unpacker<Secure, Local, OnFailure>::UnpackKey(const Key<N>& key_)
+	{
+		// Checked whatever Secure is, as the compare may otherwise run off the end of a shorter element
+		if ((blockSize - blockPos) < key_.Size() || memcmp(GetData<u8>(), key_.Data(), key_.Size()))
+		{
+			return false;
 		}
 
-		// Error. blockPos increments etc occur in switch functions
-		return std::pair<char*, u32>(nullptr, 0);
+		IncrementPosition(key_.Size());
+
+		return true;
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<void*, u32> Unpacker<Secure, Local>::UnpackBinary()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::pair<void*, u32> Unpacker<Secure, Local, OnFailure>::UnpackBinary()
 	{
-		const ByteCodes code = PeekType();
+		Layout	  layout;
+		const u8* ptr = Next(TypeClass::Binary, layout);
+		if (!ptr)
+		{
+			// Error
+			return std::make_pair<void*, u32>(nullptr, 0);
+		}
+
+		return std::pair<void*, u32>((void*)(ptr + layout.headerSize), (u32)layout.payloadSize);
+	}
 
-		switch (code)
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::tuple<i32, void*, u32> Unpacker<Secure, Local, OnFailure>::UnpackExt()
+	{
+		Layout	  layout;
+		const u8* ptr = Next(TypeClass::Ext, layout);
+		if (!ptr)
 		{
-			case Bin8:
-			{
-				return UnpackBin8();
-			}
+			// Error
+			return std::make_tuple<i32, void*, u32>(0, nullptr, 0);
+		}
 
-			case Bin16:
-			{
-				return UnpackBin16();
-			}
+		// The ext type is the last 4 bytes of the header
+		const i32 type = Load<i32>(ptr + layout.headerSize - sizeof(i32));
 
-			case Bin32:
-			{
-				return UnpackBin32();
-			}
+		return std::tuple<i32, void*, u32>(type, (void*)(ptr + layout.headerSize), (u32)layout.payloadSize);
+	}
 
-			default:
-			{
-				if constexpr (Secure)
-				{
-					throw std::runtime_error("Incorrect ByteCode found during Unpack!");
-				}
-			}
-		}
+	template <bool Secure, bool Local, Failure OnFailure>
+	u32 Unpacker<Secure, Local, OnFailure>::UnpackArray()
+	{
+		Layout layout;
+		Next(TypeClass::Array, layout);
 
-		// Error. blockPos increments etc occur in switch functions
-		return std::make_pair<void*, u32>(nullptr, 0);
+		// Left at 0 on error
+		return (u32)layout.numChildren;
 	}
 
-	template <bool Secure, bool Local>
-	std::tuple<i32, void*, u32> Unpacker<Secure, Local>::UnpackExt()
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename T>
+	u32 Unpacker<Secure, Local, OnFailure>::UnpackArray(T* const out_, const u32 capacity_)
 	{
-		const ByteCodes code = PeekType();
+		static_assert(std::is_arithmetic_v<T>, "UnpackArray() only takes numbers!");
 
-		switch (code)
+		const u64 start	   = blockPos;
+		const u32 numItems = UnpackArray();
+		if (numItems > capacity_)
 		{
-			case FixExt1:
-			{
-				return UnpackFixExt<1>();
-			}
+			blockPos = start;
+			return numItems;
+		}
 
-			case FixExt2:
+		u32 i = 0;
+		while (i < numItems)
+		{
+			if constexpr (Secure)
 			{
-				return UnpackFixExt<2>();
+				if (blockPos >= blockSize)
+				{
+					Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+					return 0;
+				}
 			}
 
-			case FixExt4:
-			{
-				return UnpackFixExt<4>();
-			}
+			const u8 code = *GetData<u8>();
 
-			case FixExt8:
+			u32 run;
+			switch (code)
 			{
-				return UnpackFixExt<8>();
-			}
+				case UInt8:
+				{
+					run = UnpackRun<T, u8>(out_ + i, numItems - i, code);
+					break;
+				}
 
-			case FixExt16:
-			{
-				return UnpackFixExt<16>();
-			}
+				case UInt16:
+				{
+					run = UnpackRun<T, u16>(out_ + i, numItems - i, code);
+					break;
+				}
 
-			case Ext8:
-			{
-				return UnpackExt8();
-			}
+				case UInt32:
+				{
+					run = UnpackRun<T, u32>(out_ + i, numItems - i, code);
+					break;
+				}
 
-			case Ext16:
-			{
-				return UnpackExt16();
-			}
+				case UInt64:
+				{
+					run = UnpackRun<T, u64>(out_ + i, numItems - i, code);
+					break;
+				}
 
-			case Ext32:
-			{
-				return UnpackExt32();
-			}
+				case Int8:
+				{
+					run = UnpackRun<T, i8>(out_ + i, numItems - i, code);
+					break;
+				}
 
-			default:
-			{
-				if constexpr (Secure)
+				case Int16:
+				{
+					run = UnpackRun<T, i16>(out_ + i, numItems - i, code);
+					break;
+				}
+
+				case Int32:
+				{
+					run = UnpackRun<T, i32>(out_ + i, numItems - i, code);
+					break;
+				}
+
+				case Int64:
+				{
+					run = UnpackRun<T, i64>(out_ + i, numItems - i, code);
+					break;
+				}
+
+				case Float32:
+				{
+					run = UnpackRun<T, f32>(out_ + i, numItems - i, code);
+					break;
+				}
+
+				case Float64:
+				{
+					run = UnpackRun<T, f64>(out_ + i, numItems - i, code);
+					break;
+				}
+
+				default:
 				{
-					throw std::runtime_error("Incorrect ByteCode found during Unpack!");
+					run = UnpackFixIntRun<T>(out_ + i, numItems - i);
+					break;
 				}
 			}
+
+			// Mixed, truncated or not a number at all. The scalar path deals with it
+			if (!run)
+			{
+				out_[i] = UnpackNumber<T>();
+				run		= 1;
+			}
+
+			i += run;
 		}
 
-		// Error. blockPos increments etc occur in switch functions
-		return std::make_tuple<i32, void*, u32>(0, nullptr, 0);
+		return numItems;
+	}
+
+	template <bool Secure, bool Local, Failure OnFailure>
+	u32 Unpacker<Secure, Local, OnFailure>::UnpackMap()
+	{
+		Layout layout;
+		Next(TypeClass::Map, layout);
+
+		// Key : value pairs. Left at 0 on error
+		return (u32)(layout.numChildren / 2);
 	}
 
-	template <bool Secure, bool Local>
-	u32 Unpacker<Secure, Local>::UnpackArray()
+	template <bool Secure, bool Local, Failure OnFailure>
+	void Unpacker<Secure, Local, OnFailure>::Skip()
 	{
-		const ByteCodes code = PeekType();
+		SkipElement();
+	}
 
-		switch (code)
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::pair<void*, u64> Unpacker<Secure, Local, OnFailure>::UnpackRaw()
+	{
+		const u64 start = blockPos;
+		if (!SkipElement() || blockPos > blockSize)
 		{
-			case FixArr:
+			// Error. Under Failure::Flag, stays at the end
+			if (error == UnpackError::None)
 			{
-				return UnpackFixArr();
+				blockPos = start;
 			}
 
-			case Arr16:
-			{
-				// Only interested in the numbers here
-				return UnpackU16();
-			}
+			return std::pair<void*, u64>(nullptr, 0);
+		}
+
+		return std::pair<void*, u64>((u8*)blockPtr + start, blockPos - start);
+	}
+
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename H>
+	bool Unpacker<Secure, Local, OnFailure>::Visit(H& handler_)
+	{
+		// Arrays/maps being visited, so that their ends can be reported without recursion
+		struct Open
+		{
+			u64	 left; // Elements still to come (2 per map pair)
+			bool map;
+		};
 
-			case Arr32:
+		FixedStack<Open, MaxDepthBase> open;
+
+		while (blockPos < blockSize)
+		{
+			const u8* const ptr	 = GetData<u8>();
+			const ByteInfo& info = ByteTable[*ptr];
+			const u64		left = blockSize - blockPos;
+			if (!info.headerSize)
 			{
-				// Only interested in the numbers here
-				return UnpackU32();
-			}
+				if constexpr (Secure)
+				{
+					Fail(UnpackError::InvalidByteCode, "Incorrect ByteCode found during Unpack!");
+				}
 
-			default:
+				return false;
+			}
+			else if (left < info.headerSize)
 			{
 				if constexpr (Secure)
 				{
-					throw std::runtime_error("Incorrect ByteCode found during Unpack!");
+					Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
 				}
+
+				return false;
 			}
-		}
 
-		// Error. blockPos increments etc occur in switch functions
-		return 0;
-	}
+			u64 numChildren = 0;
+			switch (info.typeClass)
+			{
+				case TypeClass::Nil:
+				{
+					handler_.OnNil();
+					blockPos++;
+					break;
+				}
 
-	template <bool Secure, bool Local>
-	u32 Unpacker<Secure, Local>::UnpackMap()
-	{
-		const ByteCodes code = PeekType();
+				case TypeClass::Bool:
+				{
+					handler_.OnBool(*ptr == ByteCodes::BoolTrue);
+					blockPos++;
+					break;
+				}
 
-		switch (code)
-		{
-			case FixMap:
-			{
-				return UnpackFixMap();
+				case TypeClass::Number:
+				{
+					if (left < ((u64)info.headerSize + info.fixedLength))
+					{
+						if constexpr (Secure)
+						{
+							Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+						}
+
+						return false;
+					}
+
+					VisitNumber(handler_, ptr);
+					break;
+				}
+
+				default:
+				{
+					Layout layout;
+					LayoutReader<Local>::Read(ptr, layout);
+
+					// Written to avoid overflow with hostile lengths
+					if (layout.payloadSize > (left - layout.headerSize))
+					{
+						if constexpr (Secure)
+						{
+							Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+						}
+
+						return false;
+					}
+
+					const u8* const payload = ptr + layout.headerSize;
+					switch (info.typeClass)
+					{
+						case TypeClass::String:
+						{
+							std::string_view str((const char*)payload, layout.payloadSize);
+
+							// The NUL is packed, but isn't part of the string
+							if constexpr (PackNulBase)
+							{
+								if (str.size() && !str.back())
+								{
+									str.remove_suffix(1);
+								}
+							}
+
+							handler_.OnString(str);
+							break;
+						}
+
+						case TypeClass::Binary:
+						{
+							handler_.OnBinary(std::pair<void*, u32>((void*)payload, (u32)layout.payloadSize));
+							break;
+						}
+
+						case TypeClass::Ext:
+						{
+							// The ext type is the last 4 bytes of the header
+							const i32 type = Load<i32>(payload - sizeof(i32));
+							handler_.OnExt(std::tuple<i32, void*, u32>(type, (void*)payload, (u32)layout.payloadSize));
+							break;
+						}
+
+						case TypeClass::Array:
+						{
+							handler_.OnArrayBegin((u32)layout.numChildren);
+							break;
+						}
+
+						default:
+						{
+							handler_.OnMapBegin((u32)(layout.numChildren / 2));
+							break;
+						}
+					}
+
+					blockPos	+= (layout.headerSize + layout.payloadSize);
+					numChildren  = layout.numChildren;
+					break;
+				}
 			}
 
-			case Map16:
+			if (numChildren)
 			{
-				// Only interested in the numbers here
-				return UnpackU16();
+				if (open.size() == MaxDepthBase)
+				{
+					if constexpr (Secure)
+					{
+						Fail(UnpackError::TooDeep, "Nesting deeper than MaxDepthBase found during Unpack!");
+					}
+
+					return false;
+				}
+
+				open.push(Open{ numChildren, info.typeClass == TypeClass::Map });
+				continue;
 			}
 
-			case Map32:
+			// Empty arrays/maps end straight away
+			if (info.typeClass == TypeClass::Array)
+			{
+				handler_.OnArrayEnd();
+			}
+			else if (info.typeClass == TypeClass::Map)
 			{
-				// Only interested in the numbers here
-				return UnpackU32();
+				handler_.OnMapEnd();
 			}
 
-			default:
+			// Each element completed may complete the arrays/maps it closes
+			while (open.size())
 			{
-				if constexpr (Secure)
+				Open& parent = open.top();
+				if (--parent.left)
 				{
-					throw std::runtime_error("Incorrect ByteCode found during Unpack!");
+					break;
 				}
-			}
-		}
 
-		// Error. blockPos increments etc occur in switch functions
-		return 0;
-	}
+				if (parent.map)
+				{
+					handler_.OnMapEnd();
+				}
+				else
+				{
+					handler_.OnArrayEnd();
+				}
 
-	/*
-	*	Private
-	*/
+				open.pop();
+			}
+		}
 
-	template <bool Secure, bool Local>
-	void Unpacker<Secure, Local>::IncrementPosition(const u64 increment_)
-	{
-		if constexpr (Secure)
+		if (open.size())
 		{
-			if ((blockPos + increment_) > blockSize)
+			if constexpr (Secure)
 			{
-				throw std::runtime_error("Error in Unpack() process. Attempted OOB access!");
+				Fail(UnpackError::OutOfBounds, "Incomplete message found during Unpack!");
 			}
+
+			return false;
 		}
 
-		blockPos += increment_;
+		return true;
 	}
 
-	template <bool Secure, bool Local>
-	template <typename T>
-	T* Unpacker<Secure, Local>::GetData() const
+	template <bool Secure, bool Local, Failure OnFailure>
+	bool Unpacker<Secure, Local, OnFailure>::TryUnpackNil()
 	{
-		if constexpr (Secure)
+		if (!Complete(TypeClass::Nil))
 		{
-			if (blockPos > blockSize)
-			{
-				throw std::runtime_error("Error in Unpack() process. Attempted OOB access!");
-			}
+			return false;
 		}
 
-		return (T*)((u8*)blockPtr + blockPos);
+		UnpackNil();
+		return true;
 	}
 
-	template <bool Secure, bool Local>
-	u16 Unpacker<Secure, Local>::NetworkToHost(const u16 val_) const
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::optional<bool> Unpacker<Secure, Local, OnFailure>::TryUnpackBool()
 	{
-		if constexpr (Local)
+		if (!Complete(TypeClass::Bool))
 		{
-			return val_;
+			return std::nullopt;
 		}
-		else
-		{
-			#if defined(_WINDOWS)
-				return ntohs(val_);
-			#else
-				return betoh16(val_);
-			#endif
-		}
-	}
 
-	template <bool Secure, bool Local>
-	u32 Unpacker<Secure, Local>::NetworkToHost(const u32 val_) const
-	{
-		if constexpr (Local)
-		{
-			return val_;
-		}
-		else
-		{
-			#if defined(_WINDOWS)
-				return ntohl(val_);
-			#else
-				return betoh32(val_);
-			#endif
-		}
+		return UnpackBool();
 	}
 
-	template <bool Secure, bool Local>
-	u64 Unpacker<Secure, Local>::NetworkToHost(const u64 val_) const
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename T>
+	std::optional<T> Unpacker<Secure, Local, OnFailure>::TryUnpackNumber()
 	{
-		if constexpr (Local)
-		{
-			return val_;
-		}
-		else
+		if (!Complete(TypeClass::Number))
 		{
-			#if defined(_WINDOWS)
-				return ntohll(val_);
-			#else
-				return betoh64(val_);
-			#endif
+			return std::nullopt;
 		}
-	}
-
-	template <bool Secure, bool Local>
-	u8 Unpacker<Secure, Local>::UnpackFixUInt()
-	{
-		// We want the first 7 bits
-		const u8 val = *GetData<u8>();
-
-		// Increment blockPos by 1
-		IncrementPosition(1);
 
-		// val & 0111 1111
-		return (val & 0x7f);
+		return UnpackNumber<T>();
 	}
 
-	template <bool Secure, bool Local>
-	i8 Unpacker<Secure, Local>::UnpackFixInt()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::optional<std::string_view> Unpacker<Secure, Local, OnFailure>::TryUnpackString()
 	{
-		// We want first 5 bits
-		u8 val = *GetData<u8>();
-
-		// Increment blockPos by 1
-		IncrementPosition(1);
-
-		// val & 0001 1111
-		val = (val & 0x1f);
-
-		// Cast to i8
-		return *(i8*)&val;
-	}
-
-	template <bool Secure, bool Local>
-	std::pair<char*, u32> Unpacker<Secure, Local>::UnpackFixStr()
-	{
-		// We want first 5 bits
-		u8 strLen = *GetData<u8>();
-
-		// Increment blockPos by 1
-		IncrementPosition(1);
-
-		// strLen & 0001 1111
-		strLen = (strLen & 0x1f);
-
-		// Pointer to next strLen bytes
-		char* strData = GetData<char>();
-
-		// Safely increment blockPos
-		IncrementPosition(strLen);
+		if (!Complete(TypeClass::String))
+		{
+			return std::nullopt;
+		}
 
-		// String is now safe to return
-		return std::pair<char*, u32>(strData, strLen);
+		return UnpackString();
 	}
 
-	template <bool Secure, bool Local>
-	u8 Unpacker<Secure, Local>::UnpackFixArr()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::optional<std::pair<void*, u32>> Unpacker<Secure, Local, OnFailure>::TryUnpackBinary()
 	{
-		// We want the first 4 bits
-		const u8 val = *GetData<u8>();
-
-		// Increment blockPos by 1
-		IncrementPosition(1);
+		if (!Complete(TypeClass::Binary))
+		{
+			return std::nullopt;
+		}
 
-		// val & 0000 1111
-		return (val & 0x0f);
+		return UnpackBinary();
 	}
 
-	template <bool Secure, bool Local>
-	u8 Unpacker<Secure, Local>::UnpackFixMap()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::optional<std::tuple<i32, void*, u32>> Unpacker<Secure, Local, OnFailure>::TryUnpackExt()
 	{
-		// We want the first 4 bits
-		const u8 val = *GetData<u8>();
-
-		// Increment blockPos by 1
-		IncrementPosition(1);
+		if (!Complete(TypeClass::Ext))
+		{
+			return std::nullopt;
+		}
 
-		// val & 0000 1111
-		return (val & 0x0f);
+		return UnpackExt();
 	}
 
-	template <bool Secure, bool Local>
-	u8 Unpacker<Secure, Local>::UnpackU8()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::optional<u32> Unpacker<Secure, Local, OnFailure>::TryUnpackArray()
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value
-		const u8 val = *GetData<u8>();
-
-		// Increment over value
-		IncrementPosition(sizeof(u8));
+		if (!Complete(TypeClass::Array))
+		{
+			return std::nullopt;
+		}
 
-		// Return u8
-		return val;
+		return UnpackArray();
 	}
 
-	template <bool Secure, bool Local>
-	u16 Unpacker<Secure, Local>::UnpackU16()
+	template <bool Secure, bool Local, Failure OnFailure>
+	std::optional<u32> Unpacker<Secure, Local, OnFailure>::TryUnpackMap()
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u16 val = *GetData<u16>();
-
-		// Move over sizeof(u16)
-		IncrementPosition(sizeof(u16));
+		if (!Complete(TypeClass::Map))
+		{
+			return std::nullopt;
+		}
 
-		// Network to host
-		return NetworkToHost(val);
+		return UnpackMap();
 	}
 
-	template <bool Secure, bool Local>
-	u32 Unpacker<Secure, Local>::UnpackU32()
-	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u32 val = *GetData<u32>();
-
-		// Move over sizeof(u32)
-		IncrementPosition(sizeof(u32));
-
-		// Network to host
-		return NetworkToHost(val);
-	}
+	/*
+	*	Private
+	*/
 
-	template <bool Secure, bool Local>
-	u64 Unpacker<Secure, Local>::UnpackU64()
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename T, typename W>
+	u32 Unpacker<Secure, Local, OnFailure>::UnpackRun(T* const out_, const u32 max_, const u8 code_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
+		constexpr const u64 stride = 1 + sizeof(W);
 
-		// Obtain value in network order
-		const u64 val = *GetData<u64>();
+		// One bounds check for the whole run
+		const u64 fits = (blockSize - blockPos) / stride;
+		const u64 max  = std::min<u64>(max_, fits);
 
-		// Move over sizeof(u64)
-		IncrementPosition(sizeof(u64));
+		const u8* const ptr = GetData<u8>();
 
-		// Network to host
-		return NetworkToHost(val);
-	}
-
-	template <bool Secure, bool Local>
-	i8 Unpacker<Secure, Local>::UnpackI8()
-	{
-		// Move over ByteCode
-		IncrementPosition(1);
+		u64 run = 0;
+		while (run < max && ptr[run * stride] == code_)
+		{
+			run++;
+		}
 
-		// Obtain value
-		const u8 val = *GetData<u8>();
+		for (u64 i = 0; i < run; ++i)
+		{
+			out_[i] = (T)Load<W>(ptr + (i * stride) + 1);
+		}
 
-		// Increment over value
-		IncrementPosition(sizeof(u8));
+		IncrementPosition(run * stride);
 
-		// Return i8
-		return *(i8*)&val;
+		return (u32)run;
 	}
 
-	template <bool Secure, bool Local>
-	i16 Unpacker<Secure, Local>::UnpackI16()
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename T>
+	u32 Unpacker<Secure, Local, OnFailure>::UnpackFixIntRun(T* const out_, const u32 max_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
+		const u64 max = std::min<u64>(max_, blockSize - blockPos);
 
-		// Obtain value in network order
-		const u16 val = *GetData<u16>();
+		const u8* const ptr = GetData<u8>();
 
-		// Move over sizeof(u16)
-		IncrementPosition(sizeof(u16));
+		u64 run = 0;
+		for (; run < max; ++run)
+		{
+			const u8 byte = ptr[run];
+			if (byte <= 0x7f)
+			{
+				out_[run] = (T)byte;
+			}
+			else if (byte >= 0xe0)
+			{
+				// Already the two's complement i8
+				out_[run] = (T)(i8)byte;
+			}
+			else
+			{
+				break;
+			}
+		}
 
-		// Network to host
-		const u16 hVal = NetworkToHost(val);
+		IncrementPosition(run);
 
-		// Return i16
-		return *(i16*)&hVal;
+		return (u32)run;
 	}
 
-	template <bool Secure, bool Local>
-	i32 Unpacker<Secure, Local>::UnpackI32()
+	template <bool Secure, bool Local, Failure OnFailure>
+	void Unpacker<Secure, Local, OnFailure>::Fail(const UnpackError error_, const char* reason_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u32 val = *GetData<u32>();
-
-		// Move over sizeof(u32)
-		IncrementPosition(sizeof(u32));
-
-		// Network to host
-		const u32 hVal = NetworkToHost(val);
+		if constexpr (OnFailure == Failure::Throw)
+		{
+			throw std::runtime_error(reason_);
+		}
+		else
+		{
+			if (error == UnpackError::None)
+			{
+				error = error_;
+			}
 
-		// Return i32
-		return *(i32*)&hVal;
+			// Everything after fails its bounds check, without a check of its own
+			blockPos = blockSize;
+		}
 	}
 
-	template <bool Secure, bool Local>
-	i64 Unpacker<Secure, Local>::UnpackI64()
+	template <bool Secure, bool Local, Failure OnFailure>
+	bool Unpacker<Secure, Local, OnFailure>::IncrementPosition(const u64 increment_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u64 val = *GetData<u64>();
-
-		// Move over sizeof(u64)
-		IncrementPosition(sizeof(u64));
-
-		// Network to host
-		const u64 hVal = NetworkToHost(val);
+		if constexpr (Secure)
+		{
+			if (increment_ > (blockSize - blockPos))
+			{
+				Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+				return false;
+			}
+		}
 
-		// Return i64
-		return *(i64*)&hVal;
+		blockPos += increment_;
+		return true;
 	}
 
-	template <bool Secure, bool Local>
-	f32 Unpacker<Secure, Local>::UnpackF32()
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename T>
+	T* Unpacker<Secure, Local, OnFailure>::GetData() const
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
+		// Every move is bounds-checked when Secure, so this can't be past the end
+		assert(!Secure || blockPos <= blockSize);
 
-		// Obtain value in network order
-		u32 val = *GetData<u32>();
-		val		= NetworkToHost(val);
-
-		// Move over sizeof(u32)
-		IncrementPosition(sizeof(u32));
-
-		return *(f32*)&val;
+		return (T*)((u8*)blockPtr + blockPos);
 	}
 
-	template <bool Secure, bool Local>
-	f64 Unpacker<Secure, Local>::UnpackF64()
+	template <bool Secure, bool Local, Failure OnFailure>
+	u16 Unpacker<Secure, Local, OnFailure>::NetworkToHost(const u16 val_) const
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		u64 val = *GetData<u64>();
-		val		= NetworkToHost(val);
-
-		// Move over sizeof(u64)
-		IncrementPosition(sizeof(u64));
-
-		// Return f64
-		return *(f64*)&val;
+		if constexpr (Local)
+		{
+			return val_;
+		}
+		else
+		{
+			#if defined(_WINDOWS)
+				return ntohs(val_);
+			#else
+				return betoh16(val_);
+			#endif
+		}
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<char*, u32> Unpacker<Secure, Local>::UnpackStr8()
+	template <bool Secure, bool Local, Failure OnFailure>
+	u32 Unpacker<Secure, Local, OnFailure>::NetworkToHost(const u32 val_) const
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value
-		const u8 strLen = *GetData<u8>();
-
-		// Increment over value
-		IncrementPosition(sizeof(u8));
-
-		// Pointer to next strLen bytes
-		char* strData = GetData<char>();
-
-		// Safely increment blockPos
-		IncrementPosition(strLen);
-
-		// String is now safe to return
-		return std::pair<char*, u32>(strData, strLen);
+		if constexpr (Local)
+		{
+			return val_;
+		}
+		else
+		{
+			#if defined(_WINDOWS)
+				return ntohl(val_);
+			#else
+				return betoh32(val_);
+			#endif
+		}
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<char*, u32> Unpacker<Secure, Local>::UnpackStr16()
+	template <bool Secure, bool Local, Failure OnFailure>
+	u64 Unpacker<Secure, Local, OnFailure>::NetworkToHost(const u64 val_) const
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u16 val = *GetData<u16>();
-
-		// Move over sizeof(u16)
-		IncrementPosition(sizeof(u16));
-
-		// Network to host
-		const u16 strLen = NetworkToHost(val);
-
-		// Pointer to next strLen bytes
-		char* strData = GetData<char>();
-
-		// Safely increment blockPos
-		IncrementPosition(strLen);
-
-		// String is now safe to return
-		return std::pair<char*, u32>(strData, strLen);
+		if constexpr (Local)
+		{
+			return val_;
+		}
+		else
+		{
+			#if defined(_WINDOWS)
+				return ntohll(val_);
+			#else
+				return betoh64(val_);
+			#endif
+		}
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<char*, u32> Unpacker<Secure, Local>::UnpackStr32()
+	template <bool Secure, bool Local, Failure OnFailure>
+	bool Unpacker<Secure, Local, OnFailure>::SkipElement()
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
+		// No recursion needed. Each element takes one off the count and adds its children
+		u64 pending = 1;
 
-		// Obtain value in network order
-		const u32 val = *GetData<u32>();
+		// Secure only. Elements left at each level of nesting
+		std::array<u64, Secure ? MaxDepthBase : 1> levels;
+		u32										   depth = 0;
 
-		// Move over sizeof(u32)
-		IncrementPosition(sizeof(u32));
+		while (pending)
+		{
+			if constexpr (Secure)
+			{
+				if (blockPos >= blockSize)
+				{
+					Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+					return false;
+				}
+			}
 
-		// Network to host
-		const u32 strLen = NetworkToHost(val);
+			const u8* ptr		 = GetData<u8>();
+			const u64 headerSize = LayoutReader<Local>::HeaderSize(*ptr);
+			if (!headerSize)
+			{
+				// Error
+				if constexpr (Secure)
+				{
+					Fail(UnpackError::InvalidByteCode, "Incorrect ByteCode found during Unpack!");
+				}
 
-		// Pointer to next strLen bytes
-		char* strData = GetData<char>();
+				return false;
+			}
 
-		// Safely increment blockPos
-		IncrementPosition(strLen);
+			if constexpr (Secure)
+			{
+				if ((blockPos + headerSize) > blockSize)
+				{
+					Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+					return false;
+				}
+			}
 
-		// String is now safe to return
-		return std::pair<char*, u32>(strData, strLen);
-	}
+			Layout layout;
+			LayoutReader<Local>::Read(ptr, layout);
 
-	template <bool Secure, bool Local>
-	std::pair<void*, u32> Unpacker<Secure, Local>::UnpackBin8()
-	{
-		// Move over ByteCode
-		IncrementPosition(1);
+			// Over header and payload in one go
+			if (!IncrementPosition(layout.headerSize + layout.payloadSize))
+			{
+				return false;
+			}
 
-		// Obtain value
-		const u8 binLen = *GetData<u8>();
+			pending += layout.numChildren;
+			pending--;
 
-		// Increment over value
-		IncrementPosition(sizeof(u8));
+			if constexpr (Secure)
+			{
+				if (depth)
+				{
+					levels[depth - 1]--;
+				}
 
-		// Pointer to next binLen bytes
-		u8* binData = GetData<u8>();
+				if (layout.numChildren)
+				{
+					if (depth == MaxDepthBase)
+					{
+						Fail(UnpackError::TooDeep, "Nesting deeper than MaxDepthBase found during Unpack!");
+						return false;
+					}
 
-		// Create bin pair
-		std::pair<void*, u32> binBlob((void*)binData, binLen);
+					levels[depth++] = layout.numChildren;
+				}
 
-		// Safely increment blockPos
-		IncrementPosition(binLen);
+				// Close every level that just completed
+				while (depth && !levels[depth - 1])
+				{
+					depth--;
+				}
+			}
+		}
 
-		// Blob is now safe to return
-		return binBlob;
+		return true;
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<void*, u32> Unpacker<Secure, Local>::UnpackBin16()
+	template <bool Secure, bool Local, Failure OnFailure>
+	const u8* Unpacker<Secure, Local, OnFailure>::Next(const TypeClass class_, Layout& layout_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u16 val = *GetData<u16>();
-
-		// Move over sizeof(u16)
-		IncrementPosition(sizeof(u16));
+		const u8* const ptr = Peek(class_);
+		if (!ptr)
+		{
+			layout_ = Layout{ 0, 0, 0 };
+			return nullptr;
+		}
 
-		// Network to host
-		const u16 binLen = NetworkToHost(val);
+		if constexpr (Secure)
+		{
+			// The length must be readable before it can be checked
+			if ((blockSize - blockPos) < ByteTable[*ptr].headerSize)
+			{
+				Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
 
-		// Pointer to next binLen bytes
-		u8* binData = GetData<u8>();
+				layout_ = Layout{ 0, 0, 0 };
+				return nullptr;
+			}
+		}
 
-		// Create bin pair
-		std::pair<void*, u32> binBlob((void*)binData, binLen);
+		LayoutReader<Local>::Read(ptr, layout_);
 
-		// Safely increment blockPos
-		IncrementPosition(binLen);
+		// Over header and payload in one go
+		if (!IncrementPosition(layout_.headerSize + layout_.payloadSize))
+		{
+			layout_ = Layout{ 0, 0, 0 };
+			return nullptr;
+		}
 
-		// Blob is now safe to return
-		return binBlob;
+		return ptr;
 	}
 
-	template <bool Secure, bool Local>
-	std::pair<void*, u32> Unpacker<Secure, Local>::UnpackBin32()
+	template <bool Secure, bool Local, Failure OnFailure>
+	const u8* Unpacker<Secure, Local, OnFailure>::Peek(const TypeClass class_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value in network order
-		const u32 val = *GetData<u32>();
-
-		// Move over sizeof(u32)
-		IncrementPosition(sizeof(u32));
-
-		// Network to host
-		const u32 binLen = NetworkToHost(val);
-
-		// Pointer to next binLen bytes
-		u8* binData = GetData<u8>();
+		if constexpr (Secure)
+		{
+			if (blockPos >= blockSize)
+			{
+				Fail(UnpackError::OutOfBounds, "Error in Unpack() process. Attempted OOB access!");
+				return nullptr;
+			}
+		}
 
-		// Create bin pair
-		std::pair<void*, u32> binBlob((void*)binData, binLen);
+		const u8* const ptr = GetData<u8>();
+		if (ByteTable[*ptr].typeClass != class_)
+		{
+			// Error
+			if constexpr (Secure)
+			{
+				Fail(UnpackError::TypeMismatch, "Incorrect ByteCode found during Unpack!");
+			}
 
-		// Safely increment blockPos
-		IncrementPosition(binLen);
+			return nullptr;
+		}
 
-		// Blob is now safe to return
-		return binBlob;
+		return ptr;
 	}
 
-	template <bool Secure, bool Local>
-	template <u32 N>
-	std::tuple<i32, void*, u32> Unpacker<Secure, Local>::UnpackFixExt()
+	template <bool Secure, bool Local, Failure OnFailure>
+	bool Unpacker<Secure, Local, OnFailure>::Complete(const TypeClass class_) const
 	{
-		// Get integer
-		const i32 intVal = UnpackI32();
-
-		// Get data
-		u8* data = GetData<u8>();
+		if (blockPos >= blockSize)
+		{
+			return false;
+		}
 
-		// Create tuple
-		std::tuple<i32, void*, u32> tuple(intVal, (void*)data, N);
+		const u8* const ptr	 = GetData<u8>();
+		const ByteInfo& info = ByteTable[*ptr];
+		const u64		left = blockSize - blockPos;
+		if (info.typeClass != class_ || left < info.headerSize)
+		{
+			return false;
+		}
 
-		// Safely increment blockPos
-		IncrementPosition(N);
+		Layout layout;
+		LayoutReader<Local>::Read(ptr, layout);
 
-		// Return tuple
-		return tuple;
+		// Written to avoid overflow with hostile lengths
+		return (layout.payloadSize <= (left - layout.headerSize));
 	}
 
-	template <bool Secure, bool Local>
-	std::tuple<i32, void*, u32> Unpacker<Secure, Local>::UnpackExt8()
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename W>
+	W Unpacker<Secure, Local, OnFailure>::Load(const u8* const ptr_) const
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value
-		const u8 extLen = *GetData<u8>();
-
-		// Move over extLen
-		IncrementPosition(sizeof(u8));
-
-		// Obtain integer value
-		const u32 valN   = *GetData<u32>();
-		const u32 intVal = NetworkToHost(valN);
-
-		// Move over integer
-		IncrementPosition(sizeof(u32));
-
-		// Get data
-		u8* data = GetData<u8>();
-
-		// Create tuple
-		std::tuple<i32, void*, u32> tuple(*(i32*)&intVal, (void*)data, extLen);
-
-		// Increment over data
-		IncrementPosition(extLen);
+		// Same-size unsigned for the byteswap
+		using U = std::conditional_t<sizeof(W) == sizeof(u8), u8,
+				  std::conditional_t<sizeof(W) == sizeof(u16), u16,
+				  std::conditional_t<sizeof(W) == sizeof(u32), u32, u64>>>;
+
+		U bits;
+		memcpy(&bits, ptr_, sizeof(U));
+		if constexpr (sizeof(U) > sizeof(u8))
+		{
+			bits = NetworkToHost(bits);
+		}
 
-		// Return tuple
-		return tuple;
+		W val;
+		memcpy(&val, &bits, sizeof(W));
+		return val;
 	}
 
-	template <bool Secure, bool Local>
-	std::tuple<i32, void*, u32> Unpacker<Secure, Local>::UnpackExt16()
+	template <bool Secure, bool Local, Failure OnFailure>
+	template <typename H>
+	void Unpacker<Secure, Local, OnFailure>::VisitNumber(H& handler_, const u8* const ptr_)
 	{
-		// Move over ByteCode
-		IncrementPosition(1);
-
-		// Obtain value
-		const u16 extLenN = *GetData<u16>();
-		const u16 extLen  = NetworkToHost(extLenN);
-
-		// Move over extLen
-		IncrementPosition(sizeof(u16));
-
-		// Obtain integer value
-		const u32 valN   = *GetData<u32>();
-		const u32 intVal = NetworkToHost(valN);
-
-		// Move over integer
-		IncrementPosition(sizeof(u32));
-
-		// Get data
-		u8* data = GetData<u8>();
-
-		// Create tuple
-		std::tuple<i32, void*, u32> tuple(*(i32*)&intVal, (void*)data, extLen);
+		// As UnpackNumber(), sizes are constant per case
+		switch (ByteTable[*ptr_].type)
+		{
+			case FixUInt8:
+			{
+				handler_.OnUInt(*ptr_);
+				blockPos += 1;
+				break;
+			}
 
-		// Increment over data
-		IncrementPosition(extLen);
+			case FixInt8:
+			{
+				handler_.OnInt((i8)*ptr_);
+				blockPos += 1;
+				break;
+			}
 
-		// Return tuple
-		return tuple;
-	}
+			case UInt8:
+			{
+				handler_.OnUInt(Load<u8>(ptr_ + 1));
+				blockPos += 1 + sizeof(u8);
+				break;
+			}
 
-	template <bool Secure, bool Local>
-	std::tuple<i32, void*, u32> Unpacker<Secure, Local>::UnpackExt32()
-	{
-		// Move over ByteCode
-		IncrementPosition(1);
+			case UInt16:
+			{
+				handler_.OnUInt(Load<u16>(ptr_ + 1));
+				blockPos += 1 + sizeof(u16);
+				break;
+			}
 
-		// Obtain value
-		const u32 extLenN = *GetData<u32>();
-		const u32 extLen  = NetworkToHost(extLenN);
+			case UInt32:
+			{
+				handler_.OnUInt(Load<u32>(ptr_ + 1));
+				blockPos += 1 + sizeof(u32);
+				break;
+			}
 
-		// Move over extLen
-		IncrementPosition(sizeof(u32));
+			case UInt64:
+			{
+				handler_.OnUInt(Load<u64>(ptr_ + 1));
+				blockPos += 1 + sizeof(u64);
+				break;
+			}
 
-		// Obtain integer value
-		const u32 valN   = *GetData<u32>();
-		const u32 intVal = NetworkToHost(valN);
+			case Int8:
+			{
+				handler_.OnInt(Load<i8>(ptr_ + 1));
+				blockPos += 1 + sizeof(i8);
+				break;
+			}
 
-		// Move over integer
-		IncrementPosition(sizeof(u32));
+			case Int16:
+			{
+				handler_.OnInt(Load<i16>(ptr_ + 1));
+				blockPos += 1 + sizeof(i16);
+				break;
+			}
 
-		// Get data
-		u8* data = GetData<u8>();
+			case Int32:
+			{
+				handler_.OnInt(Load<i32>(ptr_ + 1));
+				blockPos += 1 + sizeof(i32);
+				break;
+			}
 
-		// Create tuple
-		std::tuple<i32, void*, u32> tuple(*(i32*)&intVal, (void*)data, extLen);
+			case Int64:
+			{
+				handler_.OnInt(Load<i64>(ptr_ + 1));
+				blockPos += 1 + sizeof(i64);
+				break;
+			}
 
-		// Increment over data
-		IncrementPosition(extLen);
+			case Float32:
+			{
+				handler_.OnFloat(Load<f32>(ptr_ + 1));
+				blockPos += 1 + sizeof(f32);
+				break;
+			}
 
-		// Return tuple
-		return tuple;
+			default:
+			{
+				handler_.OnFloat(Load<f64>(ptr_ + 1));
+				blockPos += 1 + sizeof(f64);
+				break;
+			}
+		}
 	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Literals.h"
+#include "Key.h"
 
 #include <cassert>
 #include <array>
@@ -8,6 +9,9 @@
 #include <variant>
 #include <stack>
 #include <stdexcept>
+#include <tuple>
+#include <string_view>
+#include <optional>
 
 namespace MSGPack
 {
@@ -29,6 +33,16 @@ namespace MSGPack
 			static_cast<T&>(*this).Set(memBlock_);
 		}
 
+		u64 Tell() const
+		{
+			return static_cast<const T&>(*this).Tell();
+		}
+
+		void Seek(const u64 position_)
+		{
+			static_cast<T&>(*this).Seek(position_);
+		}
+
 		ByteCodes PeekType() const
 		{
 			return static_cast<const T&>(*this).PeekType();
@@ -47,14 +61,20 @@ namespace MSGPack
 		template <typename S>
 		S UnpackNumber()
 		{
-			return static_cast<T&>(*this).UnpackNumber<S>();
+			return static_cast<T&>(*this).template UnpackNumber<S>();
 		}
 
-		std::pair<char*, u32> UnpackString()
+		std::string_view UnpackString()
 		{
 			return static_cast<T&>(*this).UnpackString();
 		}
 
+		template <u64 N>
+		bool UnpackKey(const Key<N>& key_)
+		{
+			return static_cast<T&>(*this).UnpackKey(key_);
+		}
+
 		std::pair<void*, u32> UnpackBinary()
 		{
 			return static_cast<T&>(*this).UnpackBinary();
@@ -70,9 +90,72 @@ namespace MSGPack
 			return static_cast<T&>(*this).UnpackArray();
 		}
 
+		template <typename S>
+		u32 UnpackArray(S* const out_, const u32 capacity_)
+		{
+			return static_cast<T&>(*this).UnpackArray(out_, capacity_);
+		}
+
 		u32 UnpackMap()
 		{
 			return static_cast<T&>(*this).UnpackMap();
 		}
+
+		void Skip()
+		{
+			static_cast<T&>(*this).Skip();
+		}
+
+		std::pair<void*, u64> UnpackRaw()
+		{
+			return static_cast<T&>(*this).UnpackRaw();
+		}
+
+		template <typename H>
+		bool Visit(H& handler_)
+		{
+			return static_cast<T&>(*this).Visit(handler_);
+		}
+
+		bool TryUnpackNil()
+		{
+			return static_cast<T&>(*this).TryUnpackNil();
+		}
+
+		std::optional<bool> TryUnpackBool()
+		{
+			return static_cast<T&>(*this).TryUnpackBool();
+		}
+
+		template <typename S>
+		std::optional<S> TryUnpackNumber()
+		{
+			return static_cast<T&>(*this).template TryUnpackNumber<S>();
+		}
+
+		std::optional<std::string_view> TryUnpackString()
+		{
+			return static_cast<T&>(*this).TryUnpackString();
+		}
+
+		std::optional<std::pair<void*, u32>> TryUnpackBinary()
+		{
+			return static_cast<T&>(*this).TryUnpackBinary();
+		}
+
+		std::optional<std::tuple<i32, void*, u32>> TryUnpackExt()
+		{
+			return static_cast<T&>(*this).TryUnpackExt();
+		}
+
+		std::optional<u32> TryUnpackArray()
+		{
+			return static_cast<T&>(*this).TryUnpackArray();
+		}
+
+		std::optional<u32> TryUnpackMap()
+		{
+			return static_cast<T&>(*this).TryUnpackMap();
+		}
 	};
 }
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "Layout.h"
+
+#include <array>
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MSGPACK_SSE2
+	#include <emmintrin.h>
+
+	#if defined(_WINDOWS)
+		#include <intrin.h>
+	#endif
+#endif
+
+namespace MSGPack
+{
+	/*
+	*	Result of Validator::Validate()
+	*/
+	enum class Validity : u8
+	{
+		Valid,			 // Every element is complete and within limits
+		Truncated,		 // An element or array/map runs past the end of the memory block
+		InvalidByteCode, // ByteCodes::NeverUse found where a header should be
+		TooDeep,		 // Arrays/maps nested deeper than MaxDepth
+		TooLarge		 // A string/binary/ext payload or array/map count is over maxLength_
+	};
+
+	/*
+	*	Checks a whole message from an untrusted source in one pass over its headers,
+	*	so it can then be unpacked with Secure = false and no per-field checks. Every
+	*	length and count is checked against the memory block, arrays/maps must
+	*	contain as many elements as their header says, and ByteCodes::NeverUse is
+	*	rejected. The message may hold any number of top-level elements.
+	*
+	*	Where SSE2 is available, runs of single-byte elements (fixints, nil, bools)
+	*	are classified 16 bytes at a time.
+	*
+	*	Local	 := Lengths and counts are stored in host byte order. Must match
+	*				the Local parameter of the Packer that produced the data.
+	*
+	*	MaxDepth := Deepest nesting of arrays/maps accepted.
+	*/
+	template <bool Local	= false,
+			  u32  MaxDepth = MaxDepthBase>
+	class Validator
+	{
+	public:
+		/// maxLength_ is the largest payload (in bytes) or number of elements in an array/map (keys and values
+		/// both count) accepted
+		Validator(const u64 maxLength_ = std::numeric_limits<u32>::max());
+
+		/// Checks memBlock_ as described above
+		Validity Validate(const std::pair<void*, u64>& memBlock_) const;
+
+	private:
+		u64 maxLength;
+
+		/// Takes num_ completed elements off the innermost array/map, closing any that are now complete
+		static void Complete(std::array<u64, MaxDepth>& levels_, u32& depth_, const u64 num_);
+
+		#if defined(MSGPACK_SSE2)
+			/// Returns the number of single-byte elements at the start of the 16 bytes at ptr_
+			static u32 SingleByteRun(const u8* const ptr_);
+		#endif
+	};
+
+	/// Validates memBlock_ with the default limits. See Validator
+	template <bool Local = false>
+	Validity Validate(const std::pair<void*, u64>& memBlock_);
+
+	/*
+	*	Public
+	*/
+
+	template <bool Local, u32 MaxDepth>
+	Validator<Local, MaxDepth>::Validator(const u64 maxLength_) :
+										  maxLength(maxLength_)
+	{
+	}
+
+	template <bool Local, u32 MaxDepth>
+	Validity Validator<Local, MaxDepth>::Validate(const std::pair<void*, u64>& memBlock_) const
+	{
+		const u8* const ptr	 = (const u8*)memBlock_.first;
+		const u64		size = memBlock_.second;
+
+		// Elements left at each level of nesting
+		std::array<u64, MaxDepth> levels;
+		u32						  depth = 0;
+
+		u64 pos = 0;
+		while (pos < size)
+		{
+			#if defined(MSGPACK_SSE2)
+				if ((size - pos) >= 16)
+				{
+					const u64 run = SingleByteRun(ptr + pos);
+					if (run)
+					{
+						// Don't run past the end of the innermost array/map; what follows belongs to its parent
+						const u64 num = depth ? std::min<u64>(run, levels[depth - 1]) : run;
+
+						pos += num;
+						Complete(levels, depth, num);
+						continue;
+					}
+				}
+			#endif
+
+			const u64 headerSize = LayoutReader<Local>::HeaderSize(ptr[pos]);
+			if (!headerSize)
+			{
+				return Validity::InvalidByteCode;
+			}
+			else if ((size - pos) < headerSize)
+			{
+				return Validity::Truncated;
+			}
+
+			Layout layout;
+			LayoutReader<Local>::Read(ptr + pos, layout);
+
+			if (layout.payloadSize > maxLength || layout.numChildren > maxLength)
+			{
+				return Validity::TooLarge;
+			}
+
+			// Written to avoid overflow with hostile lengths. Every element is at least a byte, so a count bigger
+			// than what's left can be rejected now too
+			const u64 left = size - pos - headerSize;
+			if (layout.payloadSize > left || layout.numChildren > left)
+			{
+				return Validity::Truncated;
+			}
+
+			pos += (headerSize + layout.payloadSize);
+
+			if (layout.numChildren)
+			{
+				if (depth == MaxDepth)
+				{
+					return Validity::TooDeep;
+				}
+
+				levels[depth++] = layout.numChildren;
+			}
+			else
+			{
+				Complete(levels, depth, 1);
+			}
+		}
+
+		return depth ? Validity::Truncated : Validity::Valid;
+	}
+
+	template <bool Local>
+	Validity Validate(const std::pair<void*, u64>& memBlock_)
+	{
+		return Validator<Local>().Validate(memBlock_);
+	}
+
+	/*
+	*	Private
+	*/
+
+	template <bool Local, u32 MaxDepth>
+	void Validator<Local, MaxDepth>::Complete(std::array<u64, MaxDepth>& levels_, u32& depth_, const u64 num_)
+	{
+		if (!depth_)
+		{
+			return;
+		}
+
+		levels_[depth_ - 1] -= num_;
+
+		// A completed array/map is itself one completed element of its parent
+		while (!levels_[depth_ - 1])
+		{
+			if (!--depth_)
+			{
+				break;
+			}
+
+			levels_[depth_ - 1]--;
+		}
+	}
+
+	#if defined(MSGPACK_SSE2)
+		template <bool Local, u32 MaxDepth>
+		u32 Validator<Local, MaxDepth>::SingleByteRun(const u8* const ptr_)
+		{
+			const __m128i bytes = _mm_loadu_si128((const __m128i*)ptr_);
+
+			// Positive (0x00 -> 0x7f) and negative (0xe0 -> 0xff) fixints are all > -33 as signed bytes
+			__m128i single = _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-33));
+			single		   = _mm_or_si128(single, _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)Nil)));
+			single		   = _mm_or_si128(single, _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)BoolFalse)));
+			single		   = _mm_or_si128(single, _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)BoolTrue)));
+
+			// Count the set bits before the first clear one
+			const u32 mask = ~(u32)_mm_movemask_epi8(single) | 0x10000;
+			#if defined(_WINDOWS)
+				unsigned long idx;
+				_BitScanForward(&idx, mask);
+				return idx;
+			#else
+				return __builtin_ctz(mask);
+			#endif
+		}
+	#endif
+}
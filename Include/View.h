@@ -0,0 +1,560 @@
+#pragma once
+
+#include "Literals.h"
+#include "Bytecodes.h"
+#include "Defines.h"
+#include "Layout.h"
+#include "Key.h"
+#include "Unpacker.h"
+
+#include <cstring>
+#include <string_view>
+#include <tuple>
+
+namespace MSGPack
+{
+	template <bool Secure, bool Local>
+	class ArrayView;
+
+	template <bool Secure, bool Local>
+	class MapView;
+
+	/*
+	*	Lazy, non-owning views of packed elements. Each is a ptr into the memory
+	*	block, the bytes left in it and, for arrays/maps, a count, so they are
+	*	trivially copyable: save one to come back to a sub-container later, or
+	*	walk two containers in turn. Nothing is decoded until asked for, and
+	*	nothing is allocated; moving on from an element skips its headers.
+	*
+	*	Views of a whole message come from its memory block. Mid-way through an
+	*	Unpacker, pass it UnpackRaw() to view the next element and move on.
+	*
+	*	Secure := Checks as an Unpacker<Secure> would, e.g. AsArray() throws if
+	*			  the element isn't an array. Otherwise an empty view is given.
+	*
+	*	Local  := Lengths and counts are stored in host byte order. Must match
+	*			  the Local parameter of the Packer that produced the data.
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class ElementView
+	{
+	public:
+		/// Views nothing. See Valid()
+		ElementView();
+
+		/// Views the first element in memBlock_
+		ElementView(const std::pair<void*, u64>& memBlock_);
+
+		/// Returns false if nothing is viewed, e.g. MapView::operator[]() found no such key
+		bool Valid() const;
+
+		/// Returns the ByteCode of the element. Fixed types come back as the first ByteCode of their range
+		ByteCodes Type() const;
+
+		/// As the Unpacker::Unpack*() of the same name
+		bool AsBool() const;
+		template <typename T>
+		T AsNumber() const;
+		std::string_view AsString() const;
+		std::pair<void*, u32> AsBinary() const;
+		std::tuple<i32, void*, u32> AsExt() const;
+
+		/// Returns a view of the array/map
+		ArrayView<Secure, Local> AsArray() const;
+		MapView<Secure, Local>	 AsMap() const;
+
+		/// Returns an Unpacker at this element, for anything else. It may go on past the element
+		Unpacker<Secure, Local> Reader() const;
+
+		/// Returns the span of the packed element, for Packer::PackRaw(). Its headers are walked to find its end
+		std::pair<void*, u64> Raw() const;
+
+	private:
+		template <bool, bool>
+		friend class ArrayView;
+
+		template <bool, bool>
+		friend class MapView;
+
+		const u8* ptr;
+		u64		  left; // Bytes from ptr to the end of the memory block
+
+		ElementView(const u8* const ptr_, const u64 left_);
+
+		/// Returns the number of bytes taken by the element and everything within it
+		u64 PackedSize() const;
+	};
+
+	/*
+	*	View of an array. Items are visited in order by its iterators, which are
+	*	cursors that can be copied to save a position. Indexing is O(i).
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class ArrayView
+	{
+	public:
+		class Iterator
+		{
+		public:
+			ElementView<Secure, Local> operator*() const;
+			Iterator&				   operator++();
+			bool					   operator==(const Iterator& other_) const;
+			bool					   operator!=(const Iterator& other_) const;
+
+			/// Returns the number of items from here to the end of the array
+			u32 Remaining() const;
+
+		private:
+			friend class ArrayView;
+
+			ElementView<Secure, Local> item;
+			u32						   remaining;
+		};
+
+		/// Views an empty array
+		ArrayView();
+
+		/// Views the array at the start of memBlock_
+		ArrayView(const std::pair<void*, u64>& memBlock_);
+
+		/// Returns the number of items
+		u32 Size() const;
+
+		Iterator begin() const;
+		Iterator end() const;
+
+		/// Returns item i_, skipping over those before it. Nothing is viewed if i_ >= Size()
+		ElementView<Secure, Local> operator[](const u32 i_) const;
+
+	private:
+		template <bool, bool>
+		friend class ElementView;
+
+		ElementView<Secure, Local> first; // First item
+		u32						   count;
+
+		ArrayView(const ElementView<Secure, Local>& element_);
+	};
+
+	/*
+	*	View of a map. Iterators give key : value pairs in order. Lookup by key is
+	*	a linear scan that only decodes string keys.
+	*/
+	template <bool Secure = SecureBase,
+			  bool Local  = false>
+	class MapView
+	{
+	public:
+		class Iterator
+		{
+		public:
+			/// Returns the key and value. Finding the value skips over the key
+			std::pair<ElementView<Secure, Local>, ElementView<Secure, Local>> operator*() const;
+			Iterator&														   operator++();
+			bool															   operator==(const Iterator& other_) const;
+			bool															   operator!=(const Iterator& other_) const;
+
+			/// Returns the number of pairs from here to the end of the map
+			u32 Remaining() const;
+
+		private:
+			friend class MapView;
+
+			ElementView<Secure, Local> key;
+			u32						   remaining;
+		};
+
+		/// Views an empty map
+		MapView();
+
+		/// Views the map at the start of memBlock_
+		MapView(const std::pair<void*, u64>& memBlock_);
+
+		/// Returns the number of key : value pairs
+		u32 Size() const;
+
+		Iterator begin() const;
+		Iterator end() const;
+
+		/// Returns the value for the first string key equal to key_. Nothing is viewed if there's none
+		ElementView<Secure, Local> operator[](const std::string_view key_) const;
+
+		/// As above, comparing each key with the pre-packed key_ in a single memcmp. See Key.h
+		template <u64 N>
+		ElementView<Secure, Local> operator[](const Key<N>& key_) const;
+
+	private:
+		template <bool, bool>
+		friend class ElementView;
+
+		ElementView<Secure, Local> first; // First key
+		u32						   count;
+
+		MapView(const ElementView<Secure, Local>& element_);
+	};
+
+	/*
+	*	ElementView
+	*/
+
+	template <bool Secure, bool Local>
+	ElementView<Secure, Local>::ElementView() :
+								ptr(nullptr),
+								left(0)
+	{
+	}
+
+	template <bool Secure, bool Local>
+	ElementView<Secure, Local>::ElementView(const std::pair<void*, u64>& memBlock_) :
+								ptr((const u8*)memBlock_.first),
+								left(memBlock_.second)
+	{
+		if (!left)
+		{
+			ptr = nullptr;
+		}
+	}
+
+	template <bool Secure, bool Local>
+	bool ElementView<Secure, Local>::Valid() const
+	{
+		return (ptr != nullptr);
+	}
+
+	template <bool Secure, bool Local>
+	ByteCodes ElementView<Secure, Local>::Type() const
+	{
+		return Reader().PeekType();
+	}
+
+	template <bool Secure, bool Local>
+	bool ElementView<Secure, Local>::AsBool() const
+	{
+		return Reader().UnpackBool();
+	}
+
+	template <bool Secure, bool Local>
+	template <typename T>
+	T ElementView<Secure, Local>::AsNumber() const
+	{
+		return Reader().template UnpackNumber<T>();
+	}
+
+	template <bool Secure, bool Local>
+	std::string_view ElementView<Secure, Local>::AsString() const
+	{
+		return Reader().UnpackString();
+	}
+
+	template <bool Secure, bool Local>
+	std::pair<void*, u32> ElementView<Secure, Local>::AsBinary() const
+	{
+		return Reader().UnpackBinary();
+	}
+
+	template <bool Secure, bool Local>
+	std::tuple<i32, void*, u32> ElementView<Secure, Local>::AsExt() const
+	{
+		return Reader().UnpackExt();
+	}
+
+	template <bool Secure, bool Local>
+	ArrayView<Secure, Local> ElementView<Secure, Local>::AsArray() const
+	{
+		return ArrayView<Secure, Local>(*this);
+	}
+
+	template <bool Secure, bool Local>
+	MapView<Secure, Local> ElementView<Secure, Local>::AsMap() const
+	{
+		return MapView<Secure, Local>(*this);
+	}
+
+	template <bool Secure, bool Local>
+	Unpacker<Secure, Local> ElementView<Secure, Local>::Reader() const
+	{
+		// An empty block, so that Secure fails on it and the rest return their error value
+		static const u8 none = ByteCodes::NeverUse;
+
+		return Unpacker<Secure, Local>(ptr ? std::pair<void*, u64>((void*)ptr, left) : std::pair<void*, u64>((void*)&none, 0));
+	}
+
+	template <bool Secure, bool Local>
+	std::pair<void*, u64> ElementView<Secure, Local>::Raw() const
+	{
+		return std::pair<void*, u64>((void*)ptr, PackedSize());
+	}
+
+	template <bool Secure, bool Local>
+	ElementView<Secure, Local>::ElementView(const u8* const ptr_, const u64 left_) :
+								ptr(left_ ? ptr_ : nullptr),
+								left(left_)
+	{
+	}
+
+	template <bool Secure, bool Local>
+	u64 ElementView<Secure, Local>::PackedSize() const
+	{
+		if (!ptr)
+		{
+			return 0;
+		}
+
+		Unpacker<Secure, Local> unpacker = Reader();
+		unpacker.Skip();
+
+		return unpacker.Tell();
+	}
+
+	/*
+	*	ArrayView
+	*/
+
+	template <bool Secure, bool Local>
+	ElementView<Secure, Local> ArrayView<Secure, Local>::Iterator::operator*() const
+	{
+		return item;
+	}
+
+	template <bool Secure, bool Local>
+	typename ArrayView<Secure, Local>::Iterator& ArrayView<Secure, Local>::Iterator::operator++()
+	{
+		const u64 size = item.PackedSize();
+
+		item	   = ElementView<Secure, Local>(item.ptr + size, item.left - size);
+		remaining -= 1;
+
+		return *this;
+	}
+
+	template <bool Secure, bool Local>
+	bool ArrayView<Secure, Local>::Iterator::operator==(const Iterator& other_) const
+	{
+		return (remaining == other_.remaining);
+	}
+
+	template <bool Secure, bool Local>
+	bool ArrayView<Secure, Local>::Iterator::operator!=(const Iterator& other_) const
+	{
+		return (remaining != other_.remaining);
+	}
+
+	template <bool Secure, bool Local>
+	u32 ArrayView<Secure, Local>::Iterator::Remaining() const
+	{
+		return remaining;
+	}
+
+	template <bool Secure, bool Local>
+	ArrayView<Secure, Local>::ArrayView() :
+							  first(),
+							  count(0)
+	{
+	}
+
+	template <bool Secure, bool Local>
+	ArrayView<Secure, Local>::ArrayView(const std::pair<void*, u64>& memBlock_) :
+							  ArrayView(ElementView<Secure, Local>(memBlock_))
+	{
+	}
+
+	template <bool Secure, bool Local>
+	u32 ArrayView<Secure, Local>::Size() const
+	{
+		return count;
+	}
+
+	template <bool Secure, bool Local>
+	typename ArrayView<Secure, Local>::Iterator ArrayView<Secure, Local>::begin() const
+	{
+		Iterator it;
+		it.item		 = first;
+		it.remaining = count;
+
+		return it;
+	}
+
+	template <bool Secure, bool Local>
+	typename ArrayView<Secure, Local>::Iterator ArrayView<Secure, Local>::end() const
+	{
+		Iterator it;
+		it.item		 = ElementView<Secure, Local>();
+		it.remaining = 0;
+
+		return it;
+	}
+
+	template <bool Secure, bool Local>
+	ElementView<Secure, Local> ArrayView<Secure, Local>::operator[](const u32 i_) const
+	{
+		if (i_ >= count)
+		{
+			return ElementView<Secure, Local>();
+		}
+
+		Iterator it = begin();
+		for (u32 i = 0; i < i_; ++i)
+		{
+			++it;
+		}
+
+		return *it;
+	}
+
+	template <bool Secure, bool Local>
+	ArrayView<Secure, Local>::ArrayView(const ElementView<Secure, Local>& element_) :
+							  ArrayView()
+	{
+		Unpacker<Secure, Local> unpacker = element_.Reader();
+
+		// 0 if not an array, and nothing is viewed
+		count = unpacker.UnpackArray();
+		if (count)
+		{
+			first = ElementView<Secure, Local>(element_.ptr + unpacker.Tell(), element_.left - unpacker.Tell());
+		}
+	}
+
+	/*
+	*	MapView
+	*/
+
+	template <bool Secure, bool Local>
+	std::pair<ElementView<Secure, Local>, ElementView<Secure, Local>> MapView<Secure, Local>::Iterator::operator*() const
+	{
+		const u64 size = key.PackedSize();
+
+		return std::make_pair(key, ElementView<Secure, Local>(key.ptr + size, key.left - size));
+	}
+
+	template <bool Secure, bool Local>
+	typename MapView<Secure, Local>::Iterator& MapView<Secure, Local>::Iterator::operator++()
+	{
+		// Over the key and its value
+		Unpacker<Secure, Local> unpacker = key.Reader();
+		unpacker.Skip();
+		unpacker.Skip();
+
+		key		   = ElementView<Secure, Local>(key.ptr + unpacker.Tell(), key.left - unpacker.Tell());
+		remaining -= 1;
+
+		return *this;
+	}
+
+	template <bool Secure, bool Local>
+	bool MapView<Secure, Local>::Iterator::operator==(const Iterator& other_) const
+	{
+		return (remaining == other_.remaining);
+	}
+
+	template <bool Secure, bool Local>
+	bool MapView<Secure, Local>::Iterator::operator!=(const Iterator& other_) const
+	{
+		return (remaining != other_.remaining);
+	}
+
+	template <bool Secure, bool Local>
+	u32 MapView<Secure, Local>::Iterator::Remaining() const
+	{
+		return remaining;
+	}
+
+	template <bool Secure, bool Local>
+	MapView<Secure, Local>::MapView() :
+							first(),
+							count(0)
+	{
+	}
+
+	template <bool Secure, bool Local>
+	MapView<Secure, Local>::MapView(const std::pair<void*, u64>& memBlock_) :
+							MapView(ElementView<Secure, Local>(memBlock_))
+	{
+	}
+
+	template <bool Secure, bool Local>
+	u32 MapView<Secure, Local>::Size() const
+	{
+		return count;
+	}
+
+	template <bool Secure, bool Local>
+	typename MapView<Secure, Local>::Iterator MapView<Secure, Local>::begin() const
+	{
+		Iterator it;
+		it.key		 = first;
+		it.remaining = count;
+
+		return it;
+	}
+
+	template <bool Secure, bool Local>
+	typename MapView<Secure, Local>::Iterator MapView<Secure, Local>::end() const
+	{
+		Iterator it;
+		it.key		 = ElementView<Secure, Local>();
+		it.remaining = 0;
+
+		return it;
+	}
+
+	template <bool Secure, bool Local>
+	ElementView<Secure, Local> MapView<Secure, Local>::operator[](const std::string_view key_) const
+	{
+		Unpacker<Secure, Local> unpacker = first.Reader();
+		for (u32 i = 0; i < count; ++i)
+		{
+			// Only string keys are decoded. Anything else is skipped over with its value
+			const u64 keyPos = unpacker.Tell();
+			if (keyPos < first.left && ByteTable[first.ptr[keyPos]].typeClass == TypeClass::String && unpacker.UnpackString() == key_)
+			{
+				return ElementView<Secure, Local>(first.ptr + unpacker.Tell(), first.left - unpacker.Tell());
+			}
+
+			if (unpacker.Tell() == keyPos)
+			{
+				unpacker.Skip();
+			}
+
+			unpacker.Skip();
+		}
+
+		return ElementView<Secure, Local>();
+	}
+
+	template <bool Secure, bool Local>
+	template <u64 N>
+	ElementView<Secure, Local> MapView<Secure, Local>::operator[](const Key<N>& key_) const
+	{
+		Unpacker<Secure, Local> unpacker = first.Reader();
+		for (u32 i = 0; i < count; ++i)
+		{
+			if (unpacker.UnpackKey(key_))
+			{
+				return ElementView<Secure, Local>(first.ptr + unpacker.Tell(), first.left - unpacker.Tell());
+			}
+
+			// Over the key and its value
+			unpacker.Skip();
+			unpacker.Skip();
+		}
+
+		return ElementView<Secure, Local>();
+	}
+
+	template <bool Secure, bool Local>
+	MapView<Secure, Local>::MapView(const ElementView<Secure, Local>& element_) :
+							MapView()
+	{
+		Unpacker<Secure, Local> unpacker = element_.Reader();
+
+		// 0 if not a map, and nothing is viewed
+		count = unpacker.UnpackMap();
+		if (count)
+		{
+			first = ElementView<Secure, Local>(element_.ptr + unpacker.Tell(), element_.left - unpacker.Tell());
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Literals.h"
+
+#include <string_view>
+#include <tuple>
+
+namespace MSGPack
+{
+	/*
+	*	Handlers for Unpacker::Visit(). Derive from Visitor and hide only the members
+	*	of interest; calls are resolved on the derived type at compile time, so
+	*	nothing is virtual and empty ones inline away.
+	*
+	*	Numbers come as the widest type of their kind. Pointers are into the memory
+	*	block, as for Unpacker. Every OnArrayBegin()/OnMapBegin() is matched by an
+	*	OnArrayEnd()/OnMapEnd() once all of its elements have been visited; for maps,
+	*	keys and values alternate.
+	*/
+	struct Visitor
+	{
+		void OnNil() {}
+		void OnBool(const bool) {}
+		void OnUInt(const u64) {}
+		void OnInt(const i64) {}
+		void OnFloat(const f64) {}
+		void OnString(const std::string_view) {}
+		void OnBinary(const std::pair<void*, u32>&) {}
+		void OnExt(const std::tuple<i32, void*, u32>&) {}
+		void OnArrayBegin(const u32) {}
+		void OnArrayEnd() {}
+		void OnMapBegin(const u32) {}
+		void OnMapEnd() {}
+	};
+}
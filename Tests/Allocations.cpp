@@ -0,0 +1,191 @@
+#if defined(_WINDOWS)
+	#define _CRT_SECURE_NO_WARNINGS 1
+#endif
+
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+
+#include "Packer.h"
+#include "Unpacker.h"
+
+/*
+*	Checks that a fixed-Size Packer with a MaxDepth, and an Unpacker, never touch
+*	the heap. Every allocation in the program goes through the operator new below
+*	and is counted while counting is set.
+*/
+static bool counting		 = false;
+static u64	numAllocations = 0;
+
+void* operator new(std::size_t size_)
+{
+	if (counting)
+	{
+		numAllocations++;
+	}
+
+	if (void* const ptr = std::malloc(size_ ? size_ : 1))
+	{
+		return ptr;
+	}
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size_)
+{
+	return operator new(size_);
+}
+
+void operator delete(void* ptr_) noexcept
+{
+	std::free(ptr_);
+}
+
+void operator delete[](void* ptr_) noexcept
+{
+	std::free(ptr_);
+}
+
+void operator delete(void* ptr_, std::size_t) noexcept
+{
+	std::free(ptr_);
+}
+
+void operator delete[](void* ptr_, std::size_t) noexcept
+{
+	std::free(ptr_);
+}
+
+namespace MSGPack
+{
+	/// Packs and unpacks a message using most element types, nested a few levels deep. Returns
+	/// false if it doesn't unpack as packed
+	template <bool Secure>
+	bool PackAndUnpack()
+	{
+		static constexpr Key idKey("id");
+		static constexpr Key samplesKey("samples");
+
+		const f32  samples[] = { 0.5f, 1.5f, 2.5f, 3.5f };
+		const u8   blob[]	 = { 0xde, 0xad, 0xbe, 0xef };
+		const char name[]	 = "representative";
+
+		Packer<1 << 12, Secure, false, false, Overflow::Throw, NoSink, MaxDepthBase> packer;
+
+		packer.StartMap();
+		{
+			packer.PackKey(idKey);
+			packer.PackNumber((u64)1234567890123);
+
+			packer.PackString("name");
+			packer.PackString(std::string_view(name, sizeof(name) - 1));
+
+			packer.PackKey(samplesKey);
+			packer.PackArray(samples, 4);
+
+			packer.PackString("nested");
+			packer.StartArray(3);
+			{
+				packer.PackNil();
+				packer.PackBool(true);
+				packer.StartMap();
+				{
+					packer.PackString("blob");
+					packer.PackBinary(blob, sizeof(blob));
+
+					packer.PackString("ext");
+					packer.PackExt(7, blob, sizeof(blob));
+				}
+				packer.EndMap();
+			}
+			packer.EndArray();
+		}
+		packer.EndMap();
+
+		Unpacker<Secure> unpacker(packer.Message());
+		if (unpacker.UnpackMap() != 4 || !unpacker.UnpackKey(idKey) || unpacker.template UnpackNumber<u64>() != 1234567890123)
+		{
+			return false;
+		}
+
+		if (unpacker.UnpackString() != "name" || unpacker.UnpackString() != "representative")
+		{
+			return false;
+		}
+
+		f32 unpacked[4];
+		if (!unpacker.UnpackKey(samplesKey) || unpacker.UnpackArray(unpacked, 4) != 4 || memcmp(unpacked, samples, sizeof(samples)))
+		{
+			return false;
+		}
+
+		if (unpacker.UnpackString() != "nested" || unpacker.UnpackArray() != 3)
+		{
+			return false;
+		}
+
+		unpacker.UnpackNil();
+		if (!unpacker.UnpackBool() || unpacker.UnpackMap() != 2)
+		{
+			return false;
+		}
+
+		unpacker.Skip();
+		const std::pair<void*, u32> bin = unpacker.UnpackBinary();
+		if (bin.second != sizeof(blob) || memcmp(bin.first, blob, sizeof(blob)))
+		{
+			return false;
+		}
+
+		unpacker.Skip();
+		unpacker.Skip();
+
+		return (unpacker.Tell() == packer.CurrentSize());
+	}
+
+	/// Nesting past MaxDepth must throw rather than write past the fixed stack, Secure or not
+	template <bool Secure>
+	bool DepthChecked()
+	{
+		try
+		{
+			Packer<1 << 8, Secure, false, false, Overflow::Throw, NoSink, 2> packer;
+
+			packer.StartArray();
+			packer.StartArray();
+			packer.StartArray();
+			return false;
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+	}
+}
+
+int main()
+{
+	printf("Running MSGPack allocation tests...\n\n");
+
+	counting = true;
+	const bool unpacked = MSGPack::PackAndUnpack<false>() && MSGPack::PackAndUnpack<true>();
+	counting = false;
+
+	if (!unpacked || numAllocations)
+	{
+		printf("Allocations: Failed with %llu allocation(s)\n\n", (unsigned long long)numAllocations);
+		return -1;
+	}
+
+	printf("Allocations: Passed\n\n");
+
+	if (!MSGPack::DepthChecked<false>() || !MSGPack::DepthChecked<true>())
+	{
+		printf("Max Depth: Failed\n\n");
+		return -1;
+	}
+
+	printf("Max Depth: Passed\n\n");
+	return 0;
+}
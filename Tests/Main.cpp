@@ -20,6 +20,34 @@ int main()
 		return -1;
 	}
 
+	printf("Running MSGPack unit tests with reserved headers...\n\n");
+
+	MSGPack::Packer<std::numeric_limits<u32>::max(), MSGPack::SecureBase, false, true> reservePacker;
+	if (!msgpackTests.Run(reservePacker, unpacker))
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(5));
+		return -1;
+	}
+
+	printf("Running MSGPack unit tests with a fixed store...\n\n");
+
+	MSGPack::Packer<1 << 12, MSGPack::SecureBase, false, false, MSGPack::Overflow::Spill, MSGPack::NoSink, MSGPack::MaxDepthBase> fixedPacker;
+	if (!msgpackTests.Run(fixedPacker, unpacker))
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(5));
+		return -1;
+	}
+
+	printf("Running MSGPack unit tests with secure checks...\n\n");
+
+	MSGPack::Packer<std::numeric_limits<u32>::max(), true> securePacker;
+	MSGPack::Unpacker<true>								   secureUnpacker;
+	if (!msgpackTests.Run(securePacker, secureUnpacker))
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(5));
+		return -1;
+	}
+
 	std::this_thread::sleep_for(std::chrono::seconds(5));
 	return 0;
 }
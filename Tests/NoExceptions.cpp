@@ -0,0 +1,57 @@
+#if defined(_WINDOWS)
+	#define _CRT_SECURE_NO_WARNINGS 1
+#endif
+
+#include <cstdio>
+
+#include "Unpacker.h"
+
+/*
+*	Built without exceptions, so that it only compiles if a Secure Unpacker with
+*	Failure::Flag has no throw left in it. Checks that hostile input is caught
+*	through Error() alone.
+*/
+namespace MSGPack
+{
+	using FlagUnpacker = Unpacker<true, false, Failure::Flag>;
+
+	/// Unpacks [7, "text", {nil: true}] from msg_, as a decoder would, and returns the error found if any
+	UnpackError Decode(const std::pair<void*, u64>& msg_)
+	{
+		FlagUnpacker unpacker(msg_);
+
+		unpacker.UnpackArray();
+		unpacker.UnpackNumber<i32>();
+		unpacker.UnpackString();
+		unpacker.UnpackMap();
+		unpacker.UnpackNil();
+		unpacker.UnpackBool();
+
+		return unpacker.Error();
+	}
+}
+
+int main()
+{
+	using namespace MSGPack;
+
+	printf("Running MSGPack tests without exceptions...\n\n");
+
+	u8 msg[] = { 0x93, 0x07, 0xa4, 't', 'e', 'x', 't', 0x81, ByteCodes::Nil, ByteCodes::BoolTrue };
+
+	const bool valid = (Decode(std::pair<void*, u64>(msg, sizeof(msg))) == UnpackError::None);
+	const bool cut	 = (Decode(std::pair<void*, u64>(msg, 4)) == UnpackError::OutOfBounds);
+
+	// A number where the string should be
+	msg[2] = 0x01;
+	const bool mismatch = (Decode(std::pair<void*, u64>(msg, sizeof(msg))) == UnpackError::TypeMismatch);
+
+	if (!valid || !cut || !mismatch)
+	{
+		printf("Error Codes: Failed\n\n");
+		return -1;
+	}
+
+	printf("Error Codes: Passed\n\n");
+	return 0;
+}
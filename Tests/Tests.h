@@ -2,12 +2,90 @@
 
 #include <chrono>
 #include <functional>
+#include <cstdio>
 
 #include "Packer.h"
 #include "Unpacker.h"
+#include "StreamUnpacker.h"
+#include "Framer.h"
+#include "Tape.h"
+#include "Validator.h"
+#include "Reflection.h"
+#include "Document.h"
+#include "View.h"
+#include "Parallel.h"
+#include "BatchUnpacker.h"
 
 namespace MSGPack
 {
+	/*
+	*	Types for TestReflection()
+	*/
+	struct ReflectedPoint
+	{
+		i32 x;
+		f64 y;
+
+		MSGPACK_FIELDS(x, y)
+	};
+
+	struct ReflectedRecord
+	{
+		u64							id;
+		std::string					name;
+		bool						flag;
+		std::vector<f32>			samples;
+		std::vector<ReflectedPoint> points;
+		ReflectedPoint				origin;
+		std::vector<std::string>	tags;
+
+		MSGPACK_FIELDS(id, name, flag, samples, points, origin, tags)
+	};
+
+	/*
+	*	Handler for TestVisiting(). Writes out each event as text
+	*/
+	struct TraceVisitor : Visitor
+	{
+		std::string trace;
+
+		void OnNil() { trace += "nil "; }
+		void OnBool(const bool val_) { trace += val_ ? "true " : "false "; }
+		void OnUInt(const u64 val_) { trace += "u" + std::to_string(val_) + " "; }
+		void OnInt(const i64 val_) { trace += "i" + std::to_string(val_) + " "; }
+		void OnFloat(const f64 val_) { trace += "f" + std::to_string(val_) + " "; }
+		void OnString(const std::string_view val_) { trace += "\"" + std::string(val_) + "\" "; }
+		void OnBinary(const std::pair<void*, u32>& val_) { trace += "bin" + std::to_string(val_.second) + " "; }
+		void OnExt(const std::tuple<i32, void*, u32>& val_) { trace += "ext" + std::to_string(std::get<0>(val_)) + ":" + std::to_string(std::get<2>(val_)) + " "; }
+		void OnArrayBegin(const u32 num_) { trace += "[" + std::to_string(num_) + " "; }
+		void OnArrayEnd() { trace += "] "; }
+		void OnMapBegin(const u32 num_) { trace += "{" + std::to_string(num_) + " "; }
+		void OnMapEnd() { trace += "} "; }
+	};
+
+	/*
+	*	Counts elements only. Everything else is left to Visitor
+	*/
+	struct CountVisitor : Visitor
+	{
+		u32 numStrings = 0;
+
+		void OnString(const std::string_view) { numStrings++; }
+	};
+
+	/*
+	*	Sink for TestOverflows() whose Reserve() says yes without growing
+	*/
+	struct StuckSink
+	{
+		u8 data[16];
+
+		u8*	 Data() { return data; }
+		u64	 Capacity() const { return sizeof(data); }
+		bool Reserve(const u64) { return true; }
+		bool Commit(const u64, const bool) { return false; }
+	};
+
 	/*
 	*	Basic unit-test class. Pass different specialisations of Packer and
 	*	Unpacker as template arguments to test the full template set too.
@@ -25,6 +103,28 @@ namespace MSGPack
 			BinaryAndExts = 1,
 			Arrays		  = 2,
 			Maps		  = 3,
+			Nested		  = 4,
+			KnownCounts	  = 5,
+			Overflows	  = 6,
+			Sinks		  = 7,
+			Streaming	  = 8,
+			Framing		  = 9,
+			Skipping	  = 10,
+			Tapes		  = 11,
+			Validation	  = 12,
+			BulkArrays	  = 13,
+			BulkUnpack	  = 14,
+			Reflection	  = 15,
+			Keys		  = 16,
+			SizedStrings  = 17,
+			Visiting	  = 18,
+			RawForwarding = 19,
+			Patching	  = 20,
+			ErrorCodes	  = 21,
+			Documents	  = 22,
+			Views		  = 23,
+			Parallel	  = 24,
+			Batching	  = 25,
 			Num
 		};
 
@@ -33,7 +133,29 @@ namespace MSGPack
 			"Simple Types",
 			"Binary and Exts",
 			"Arrays",
-			"Maps"
+			"Maps",
+			"Nested",
+			"Known Counts",
+			"Overflows",
+			"Sinks",
+			"Streaming",
+			"Framing",
+			"Skipping",
+			"Tapes",
+			"Validation",
+			"Bulk Arrays",
+			"Bulk Unpack",
+			"Reflection",
+			"Keys",
+			"Sized Strings",
+			"Visiting",
+			"Raw Forwarding",
+			"Patching",
+			"Error Codes",
+			"Documents",
+			"Views",
+			"Parallel Packing",
+			"Batching"
 		};
 
 		template <typename T, typename S>
@@ -47,6 +169,70 @@ namespace MSGPack
 
 		template <typename T, typename S>
 		bool TestMaps(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestNested(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestKnownCounts(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		bool TestOverflows();
+
+		bool TestSinks();
+
+		template <typename T>
+		bool TestStreaming(PackerBase<T>& packer_);
+
+		template <typename T>
+		bool TestFraming(PackerBase<T>& packer_);
+
+		template <typename T, typename S>
+		bool TestSkipping(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestTapes(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T>
+		bool TestValidation(PackerBase<T>& packer_);
+
+		template <typename T, typename S>
+		bool TestBulkArrays(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestBulkUnpack(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestReflection(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestKeys(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestSizedStrings(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestVisiting(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestRawForwarding(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestPatching(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestErrorCodes(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestDocuments(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestViews(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestParallel(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
+
+		template <typename T, typename S>
+		bool TestBatching(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_);
 	};
 
 	template <typename T, typename S>
@@ -55,14 +241,14 @@ namespace MSGPack
 		using namespace std::chrono;
 		using namespace std::placeholders;
 
-		const time_point<system_clock> allStartPt = system_clock::now();
+		const time_point<steady_clock> allStartPt = steady_clock::now();
 		u32 testsPassed							  = 0;
 
 		for (u32 i = 0; i < Test::Num; ++i)
 		{
 			packer_.Clear();
 
-			const time_point<system_clock> testStartPt = system_clock::now();
+			const time_point<steady_clock> testStartPt = steady_clock::now();
 
 			bool testPassed;
 			switch (i)
@@ -87,36 +273,147 @@ namespace MSGPack
 					testPassed = TestMaps(packer_, unpacker_);
 					break;
 				}
+				case Test::Nested:
+				{
+					testPassed = TestNested(packer_, unpacker_);
+					break;
+				}
+				case Test::KnownCounts:
+				{
+					testPassed = TestKnownCounts(packer_, unpacker_);
+					break;
+				}
+				case Test::Overflows:
+				{
+					testPassed = TestOverflows();
+					break;
+				}
+				case Test::Sinks:
+				{
+					testPassed = TestSinks();
+					break;
+				}
+				case Test::Streaming:
+				{
+					testPassed = TestStreaming(packer_);
+					break;
+				}
+				case Test::Framing:
+				{
+					testPassed = TestFraming(packer_);
+					break;
+				}
+				case Test::Skipping:
+				{
+					testPassed = TestSkipping(packer_, unpacker_);
+					break;
+				}
+				case Test::Tapes:
+				{
+					testPassed = TestTapes(packer_, unpacker_);
+					break;
+				}
+				case Test::Validation:
+				{
+					testPassed = TestValidation(packer_);
+					break;
+				}
+				case Test::BulkArrays:
+				{
+					testPassed = TestBulkArrays(packer_, unpacker_);
+					break;
+				}
+				case Test::BulkUnpack:
+				{
+					testPassed = TestBulkUnpack(packer_, unpacker_);
+					break;
+				}
+				case Test::Reflection:
+				{
+					testPassed = TestReflection(packer_, unpacker_);
+					break;
+				}
+				case Test::Keys:
+				{
+					testPassed = TestKeys(packer_, unpacker_);
+					break;
+				}
+				case Test::SizedStrings:
+				{
+					testPassed = TestSizedStrings(packer_, unpacker_);
+					break;
+				}
+				case Test::Visiting:
+				{
+					testPassed = TestVisiting(packer_, unpacker_);
+					break;
+				}
+				case Test::RawForwarding:
+				{
+					testPassed = TestRawForwarding(packer_, unpacker_);
+					break;
+				}
+				case Test::Patching:
+				{
+					testPassed = TestPatching(packer_, unpacker_);
+					break;
+				}
+				case Test::ErrorCodes:
+				{
+					testPassed = TestErrorCodes(packer_, unpacker_);
+					break;
+				}
+				case Test::Documents:
+				{
+					testPassed = TestDocuments(packer_, unpacker_);
+					break;
+				}
+				case Test::Views:
+				{
+					testPassed = TestViews(packer_, unpacker_);
+					break;
+				}
+				case Test::Parallel:
+				{
+					testPassed = TestParallel(packer_, unpacker_);
+					break;
+				}
+				case Test::Batching:
+				{
+					testPassed = TestBatching(packer_, unpacker_);
+					break;
+				}
 				default:
 					assert(0);
 					break;
 			}
 
-			const time_point<system_clock> testEndPt   = system_clock::now();
-			const milliseconds testTime				   = duration_cast<milliseconds>(testEndPt - testStartPt);
+			// Correctness only. See Benchmarks/ for throughput
+			const time_point<steady_clock> testEndPt = steady_clock::now();
+			const microseconds			   testTime	 = duration_cast<microseconds>(testEndPt - testStartPt);
 
 			if (testPassed)
 			{
-				printf("%s: Passed in %zu[ms]\n\n", TestStrings[i], testTime.count());
+				printf("%s: Passed in %lld[us]\n\n", TestStrings[i], (long long)testTime.count());
 			}
 			else
 			{
-				printf("%s: Failed in %zu[ms]\n\n", TestStrings[i], testTime.count());
+				printf("%s: Failed in %lld[us]\n\n", TestStrings[i], (long long)testTime.count());
 			}
 
 			testsPassed += testPassed;
 		}
 
-		const time_point<system_clock> allEndPt = system_clock::now();
-		const milliseconds allTime				= duration_cast<milliseconds>(allEndPt - allStartPt);
+		const time_point<steady_clock> allEndPt = steady_clock::now();
+		const microseconds			   allTime	= duration_cast<microseconds>(allEndPt - allStartPt);
 
 		if (testsPassed == Test::Num)
 		{
-			printf("All tests passed in %zu[ms]!\n\n", allTime.count());
+			printf("All tests passed in %lld[us]!\n\n", (long long)allTime.count());
 		}
 		else
 		{
-			printf("Some tests failed in %zu[ms]!\n\n", allTime.count());
+			printf("Some tests failed in %lld[us]!\n\n", (long long)allTime.count());
 		}
 
 		return (testsPassed == Test::Num);
@@ -139,18 +436,18 @@ namespace MSGPack
 
 		for (u32 i = 0; i < 10; ++i)
 		{
-			packer_.PackNumber<u8>(i);
-			packer_.PackNumber<u16>(i + std::numeric_limits<u8>::max());
-			packer_.PackNumber<u32>(i + std::numeric_limits<u16>::max());
-			packer_.PackNumber<u64>(i + std::numeric_limits<u32>::max());
+			packer_.template PackNumber<u8>(i);
+			packer_.template PackNumber<u16>(i + std::numeric_limits<u8>::max());
+			packer_.template PackNumber<u32>(i + std::numeric_limits<u16>::max());
+			packer_.template PackNumber<u64>(i + std::numeric_limits<u32>::max());
 
-			packer_.PackNumber<i8>(i);
-			packer_.PackNumber<i16>(i + std::numeric_limits<i8>::max());
-			packer_.PackNumber<i32>(i + std::numeric_limits<i16>::max());
-			packer_.PackNumber<i64>(i + std::numeric_limits<i32>::max());
+			packer_.template PackNumber<i8>(i);
+			packer_.template PackNumber<i16>(i + std::numeric_limits<i8>::max());
+			packer_.template PackNumber<i32>(i + std::numeric_limits<i16>::max());
+			packer_.template PackNumber<i64>(i + std::numeric_limits<i32>::max());
 
-			packer_.PackNumber<f32>(i);
-			packer_.PackNumber<f64>(i);
+			packer_.template PackNumber<f32>(i);
+			packer_.template PackNumber<f64>(i);
 		}
 
 		unpacker_.Set(packer_.Message());
@@ -167,8 +464,7 @@ namespace MSGPack
 
 		for (u32 i = 0; i < 10; ++i)
 		{
-			const char* v = unpacker_.UnpackString().first;
-			if (strcmp(v, std::to_string(i).c_str()))
+			if (unpacker_.UnpackString() != std::to_string(i))
 			{
 				return false;
 			}
@@ -176,61 +472,61 @@ namespace MSGPack
 
 		for (u32 i = 0; i < 10; ++i)
 		{
-			const u8 v0 = unpacker_.UnpackNumber<u8>();
+			const u8 v0 = unpacker_.template UnpackNumber<u8>();
 			if (v0 != i)
 			{
 				return false;
 			}
 
-			const u16 v1 = unpacker_.UnpackNumber<u16>();
+			const u16 v1 = unpacker_.template UnpackNumber<u16>();
 			if (v1 != (i + std::numeric_limits<u8>::max()))
 			{
 				return false;
 			}
 
-			const u32 v2 = unpacker_.UnpackNumber<u32>();
+			const u32 v2 = unpacker_.template UnpackNumber<u32>();
 			if (v2 != (i + std::numeric_limits<u16>::max()))
 			{
 				return false;
 			}
 
-			const u64 v3 = unpacker_.UnpackNumber<u64>();
+			const u64 v3 = unpacker_.template UnpackNumber<u64>();
 			if (v3 != (i + std::numeric_limits<u32>::max()))
 			{
 				return false;
 			}
 
-			const i8 i0 = unpacker_.UnpackNumber<i8>();
+			const i8 i0 = unpacker_.template UnpackNumber<i8>();
 			if (i0 != i)
 			{
 				return false;
 			}
 
-			const i16 i1 = unpacker_.UnpackNumber<i16>();
+			const i16 i1 = unpacker_.template UnpackNumber<i16>();
 			if (i1 != (i + std::numeric_limits<i8>::max()))
 			{
 				return false;
 			}
 
-			const i32 i2 = unpacker_.UnpackNumber<i32>();
+			const i32 i2 = unpacker_.template UnpackNumber<i32>();
 			if (i2 != (i + std::numeric_limits<i16>::max()))
 			{
 				return false;
 			}
 
-			const i64 i3 = unpacker_.UnpackNumber<i64>();
+			const i64 i3 = unpacker_.template UnpackNumber<i64>();
 			if (i3 != (i + std::numeric_limits<i32>::max()))
 			{
 				return false;
 			}
 
-			const f32 f0 = unpacker_.UnpackNumber<f32>();
+			const f32 f0 = unpacker_.template UnpackNumber<f32>();
 			if (std::abs(f0 - (f32)i) > std::numeric_limits<f32>::epsilon())
 			{
 				return false;
 			}
 
-			const f64 f1 = unpacker_.UnpackNumber<f64>();
+			const f64 f1 = unpacker_.template UnpackNumber<f64>();
 			if (std::abs(f1 - (f64)i) > std::numeric_limits<f64>::epsilon())
 			{
 				return false;
@@ -303,7 +599,7 @@ namespace MSGPack
 
 			for (u32 j = 0; j < (i * 100); ++j)
 			{
-				const u32 v = unpacker_.UnpackNumber<u32>();
+				const u32 v = unpacker_.template UnpackNumber<u32>();
 				if (v != j)
 				{
 					return false;
@@ -339,13 +635,12 @@ namespace MSGPack
 
 			for (u32 j = 0; j < (i * 100); ++j)
 			{
-				const char* s = unpacker_.UnpackString().first;
-				if (strcmp(s, std::to_string(j).c_str()))
+				if (unpacker_.UnpackString() != std::to_string(j))
 				{
 					return false;
 				}
 
-				const u32 v = unpacker_.UnpackNumber<u32>();
+				const u32 v = unpacker_.template UnpackNumber<u32>();
 				if (v != j)
 				{
 					return false;
@@ -355,4 +650,1805 @@ namespace MSGPack
 
 		return true;
 	}
+
+	template <typename T, typename S>
+	bool Tests::TestNested(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		// Binary containing NeverUse bytes to make sure they aren't mistaken for headers
+		std::array<u8, 20> blob;
+		blob.fill(ByteCodes::NeverUse);
+
+		packer_.StartArray();
+		for (u32 i = 0; i < 20; ++i)
+		{
+			packer_.StartMap();
+			for (u32 j = 0; j < 20; ++j)
+			{
+				packer_.PackString(std::to_string(j).c_str());
+				packer_.StartArray();
+				for (u32 k = 0; k < j; ++k)
+				{
+					packer_.PackNumber(k * i);
+				}
+				packer_.PackBinary(blob.data(), blob.size());
+				packer_.EndArray();
+			}
+			packer_.EndMap();
+		}
+		packer_.EndArray();
+		packer_.PackNil();
+
+		unpacker_.Set(packer_.Message());
+		if (unpacker_.UnpackArray() != 20)
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < 20; ++i)
+		{
+			if (unpacker_.UnpackMap() != 20)
+			{
+				return false;
+			}
+
+			for (u32 j = 0; j < 20; ++j)
+			{
+				if (unpacker_.UnpackString() != std::to_string(j))
+				{
+					return false;
+				}
+
+				if (unpacker_.UnpackArray() != (j + 1))
+				{
+					return false;
+				}
+
+				for (u32 k = 0; k < j; ++k)
+				{
+					const u32 v = unpacker_.template UnpackNumber<u32>();
+					if (v != (k * i))
+					{
+						return false;
+					}
+				}
+
+				std::pair<void*, u32> mem = unpacker_.UnpackBinary();
+				if (mem.second != blob.size() || memcmp(mem.first, blob.data(), blob.size()))
+				{
+					return false;
+				}
+			}
+		}
+
+		unpacker_.UnpackNil();
+
+		return true;
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestKnownCounts(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		// Count-known containers mixed with deferred ones in both directions
+		packer_.StartArray();
+		for (u32 i = 0; i < 20; ++i)
+		{
+			packer_.StartMap(i);
+			for (u32 j = 0; j < i; ++j)
+			{
+				packer_.PackNumber(j);
+				packer_.StartArray();
+				packer_.StartArray(j * 10);
+				for (u32 k = 0; k < (j * 10); ++k)
+				{
+					packer_.PackNumber(k);
+				}
+				packer_.EndArray();
+				packer_.EndArray();
+			}
+			packer_.EndMap();
+		}
+		packer_.EndArray();
+
+		packer_.StartArray(2);
+		packer_.PackNil();
+		packer_.StartMap();
+		packer_.EndMap();
+		packer_.EndArray();
+
+		unpacker_.Set(packer_.Message());
+		if (unpacker_.UnpackArray() != 20)
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < 20; ++i)
+		{
+			if (unpacker_.UnpackMap() != i)
+			{
+				return false;
+			}
+
+			for (u32 j = 0; j < i; ++j)
+			{
+				if (unpacker_.template UnpackNumber<u32>() != j)
+				{
+					return false;
+				}
+
+				if (unpacker_.UnpackArray() != 1 || unpacker_.UnpackArray() != (j * 10))
+				{
+					return false;
+				}
+
+				for (u32 k = 0; k < (j * 10); ++k)
+				{
+					if (unpacker_.template UnpackNumber<u32>() != k)
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		if (unpacker_.UnpackArray() != 2)
+		{
+			return false;
+		}
+
+		unpacker_.UnpackNil();
+
+		if (unpacker_.UnpackMap() != 0)
+		{
+			return false;
+		}
+
+		// Secure throws on a count mismatch, and neither that nor the end of the Packer may std::terminate()
+		try
+		{
+			Packer<std::numeric_limits<u32>::max(), true> secure;
+			secure.StartArray(2u);
+			secure.PackNumber(1);
+			secure.EndArray();
+			return false;
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+
+		return true;
+	}
+
+	inline bool Tests::TestOverflows()
+	{
+		const char* str = "A string that doesn't fit";
+
+		// Throw
+		{
+			Packer<16, false, false, false, Overflow::Throw> packer;
+			try
+			{
+				packer.PackString(str);
+				return false;
+			}
+			catch (const std::runtime_error&)
+			{
+			}
+		}
+
+		// Throw from inside an open array when Secure, where ~Packer() mustn't throw again as it unwinds
+		try
+		{
+			Packer<16, true, false, false, Overflow::Throw> packer;
+			packer.StartArray();
+			packer.PackString(str);
+			return false;
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+
+		// A sink that can't grow is an overflow, even if its Reserve() says otherwise
+		{
+			StuckSink stuck;
+
+			Packer<std::numeric_limits<u32>::max(), false, false, false, Overflow::Flag, StuckSink> packer(stuck);
+			packer.PackString(str);
+
+			if (!packer.Overflowed())
+			{
+				return false;
+			}
+		}
+
+		// Flag. Later writes that would fit are dropped too
+		{
+			Packer<16, false, false, false, Overflow::Flag> packer;
+			packer.StartArray();
+			packer.PackNumber(1);
+			packer.PackString(str);
+			packer.PackNumber(2);
+			packer.EndArray();
+
+			if (!packer.Overflowed() || packer.CurrentSize() > 16)
+			{
+				return false;
+			}
+
+			packer.Clear();
+			if (packer.Overflowed())
+			{
+				return false;
+			}
+		}
+
+		// Spill, including an array header that grows after the spill
+		{
+			Packer<16, false, false, false, Overflow::Spill> packer;
+			packer.StartArray();
+			for (u32 i = 0; i < 100; ++i)
+			{
+				packer.PackString(str);
+			}
+			packer.EndArray();
+
+			Unpacker<> unpacker(packer.Message());
+			if (unpacker.UnpackArray() != 100)
+			{
+				return false;
+			}
+
+			for (u32 i = 0; i < 100; ++i)
+			{
+				if (unpacker.UnpackString() != str)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	inline bool Tests::TestSinks()
+	{
+		// Deferred and count-known containers, so that some data is held back from the sinks
+		auto packAll = [](auto& packer_)
+		{
+			packer_.StartArray();
+			for (u32 i = 0; i < 100; ++i)
+			{
+				packer_.PackNumber(i * 1000);
+			}
+			packer_.EndArray();
+
+			packer_.StartArray(100);
+			for (u32 i = 0; i < 100; ++i)
+			{
+				packer_.PackString(std::to_string(i).c_str());
+			}
+			packer_.EndArray();
+		};
+
+		Packer<> expected;
+		packAll(expected);
+
+		const std::pair<void*, u64> expectedMsg = expected.Message();
+
+		// Caller's buffer
+		{
+			std::array<u8, 1024> buffer;
+			SpanSink			 sink(buffer.data(), buffer.size());
+
+			Packer<std::numeric_limits<u32>::max(), false, false, false, Overflow::Throw, SpanSink> packer(sink);
+			packAll(packer);
+
+			const std::pair<void*, u64> msg = packer.Message();
+			if (msg.first != buffer.data() || msg.second != expectedMsg.second || memcmp(msg.first, expectedMsg.first, msg.second))
+			{
+				return false;
+			}
+		}
+
+		// Chunks
+		{
+			IovecSink sink(64);
+
+			Packer<std::numeric_limits<u32>::max(), false, false, false, Overflow::Throw, IovecSink> packer(sink);
+			packAll(packer);
+			packer.Flush();
+
+			std::vector<u8> joined;
+			for (const std::pair<void*, u64>& chunk : sink.Chunks())
+			{
+				joined.insert(joined.end(), (u8*)chunk.first, (u8*)chunk.first + chunk.second);
+			}
+
+			if (sink.Chunks().size() < 2 || joined.size() != expectedMsg.second || memcmp(joined.data(), expectedMsg.first, joined.size()))
+			{
+				return false;
+			}
+		}
+
+		// File descriptor
+		{
+			FILE* file = tmpfile();
+			if (!file)
+			{
+				return false;
+			}
+
+			#if defined(_WINDOWS)
+				FdSink sink(_fileno(file), 64);
+			#else
+				FdSink sink(fileno(file), 64);
+			#endif
+
+			Packer<std::numeric_limits<u32>::max(), false, false, false, Overflow::Throw, FdSink> packer(sink);
+			packAll(packer);
+			packer.Flush();
+
+			std::vector<u8> read(expectedMsg.second + 1);
+			rewind(file);
+			const size_t numRead = fread(read.data(), 1, read.size(), file);
+			fclose(file);
+
+			if (numRead != expectedMsg.second || memcmp(read.data(), expectedMsg.first, numRead))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename T>
+	bool Tests::TestStreaming(PackerBase<T>& packer_)
+	{
+		const std::string longStr(1000, 'x');
+		std::array<u8, 300> blob;
+		blob.fill(ByteCodes::NeverUse);
+
+		packer_.StartMap();
+		for (u32 i = 0; i < 20; ++i)
+		{
+			packer_.PackString(std::to_string(i).c_str());
+			packer_.StartArray();
+			packer_.PackNumber(i * 100000);
+			packer_.PackString(longStr.c_str());
+			packer_.PackBinary(blob.data(), blob.size());
+			packer_.PackBool(true);
+			packer_.EndArray();
+		}
+		packer_.EndMap();
+		packer_.PackNil();
+
+		const std::pair<void*, u64> msg = packer_.Message();
+
+		// Odd chunk sizes so that headers and payloads are split in different places
+		for (const u64 chunkSize : { 1, 3, 7, 64, 4096 })
+		{
+			StreamUnpacker<> unpacker;
+			u64				 fed = 0;
+
+			// Retries op_ with the next chunk until it completes
+			auto pull = [&](auto op_)
+			{
+				StreamStatus status = op_();
+				while (status == StreamStatus::NeedMore && fed < msg.second)
+				{
+					const u64 size = std::min<u64>(chunkSize, msg.second - fed);
+					unpacker.Feed(std::pair<void*, u64>((u8*)msg.first + fed, size));
+					fed += size;
+
+					status = op_();
+				}
+
+				return (status == StreamStatus::Ok);
+			};
+
+			u32 mapSz;
+			if (!pull([&]() { return unpacker.UnpackMap(mapSz); }) || mapSz != 20)
+			{
+				return false;
+			}
+
+			for (u32 i = 0; i < 20; ++i)
+			{
+				std::string_view key;
+				if (!pull([&]() { return unpacker.UnpackString(key); }) || key != std::to_string(i))
+				{
+					return false;
+				}
+
+				u32 arrSz, num;
+				std::string_view str;
+				std::pair<void*, u32> bin;
+				bool b;
+
+				if (!pull([&]() { return unpacker.UnpackArray(arrSz); }) || arrSz != 4 ||
+					!pull([&]() { return unpacker.UnpackNumber(num); }) || num != (i * 100000) ||
+					!pull([&]() { return unpacker.UnpackString(str); }) || str != longStr ||
+					!pull([&]() { return unpacker.UnpackBinary(bin); }) || bin.second != blob.size() || memcmp(bin.first, blob.data(), blob.size()) ||
+					!pull([&]() { return unpacker.UnpackBool(b); }) || !b)
+				{
+					return false;
+				}
+			}
+
+			if (unpacker.Remaining() != 0 || !pull([&]() { return unpacker.UnpackNil(); }))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename T>
+	bool Tests::TestFraming(PackerBase<T>& packer_)
+	{
+		std::array<u8, 300> blob;
+		blob.fill(ByteCodes::NeverUse);
+
+		// Messages of different shapes, back to back
+		std::vector<u64> expected;
+		for (u32 i = 0; i < 10; ++i)
+		{
+			const u64 start = packer_.CurrentSize();
+
+			packer_.StartMap();
+			for (u32 j = 0; j < (i * 5); ++j)
+			{
+				packer_.PackString(std::to_string(j).c_str());
+				packer_.StartArray();
+				packer_.PackBinary(blob.data(), blob.size());
+				packer_.PackExt(j, blob.data(), j);
+				packer_.PackNumber(-(i32)j);
+				packer_.EndArray();
+			}
+			packer_.EndMap();
+			expected.push_back(packer_.CurrentSize() - start);
+
+			packer_.PackNumber(f64(i));
+			expected.push_back(packer_.CurrentSize() - start - expected.back());
+		}
+
+		const std::pair<void*, u64> msg = packer_.Message();
+
+		Framer<>		 framer;
+		std::vector<u64> lengths;
+		if (framer.Split(msg, lengths) != msg.second || lengths != expected)
+		{
+			return false;
+		}
+
+		// Cut short, the last message is incomplete
+		lengths.clear();
+		const u64 covered = framer.Split(std::pair<void*, u64>(msg.first, msg.second - 1), lengths);
+		if (covered != (msg.second - expected.back()) || lengths.size() != (expected.size() - 1))
+		{
+			return false;
+		}
+
+		// Not MSGPack
+		const u8 neverUse = ByteCodes::NeverUse;
+		return (Framer<false>().Next(std::pair<void*, u64>((void*)&neverUse, 1)) == Framer<false>::Invalid);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestSkipping(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		std::array<u8, 300> blob;
+		blob.fill(ByteCodes::NeverUse);
+
+		// Only "keep" is wanted. Everything else is of every type and shape
+		packer_.StartMap();
+		for (u32 i = 0; i < 20; ++i)
+		{
+			packer_.PackString("keep");
+			packer_.PackNumber(i);
+
+			packer_.PackString("skip");
+			switch (i % 5)
+			{
+				case 0:
+				{
+					packer_.PackString(std::to_string(i).c_str());
+					break;
+				}
+				case 1:
+				{
+					packer_.PackBinary(blob.data(), blob.size());
+					break;
+				}
+				case 2:
+				{
+					packer_.PackExt(i, blob.data(), i);
+					break;
+				}
+				case 3:
+				{
+					packer_.PackNumber(f64(i));
+					break;
+				}
+				default:
+				{
+					packer_.StartArray();
+					for (u32 j = 0; j < i; ++j)
+					{
+						packer_.StartMap();
+						packer_.PackNumber(j);
+						packer_.PackBinary(blob.data(), j);
+						packer_.EndMap();
+					}
+					packer_.EndArray();
+					break;
+				}
+			}
+		}
+		packer_.EndMap();
+		packer_.PackNil();
+
+		unpacker_.Set(packer_.Message());
+
+		const u32 numItems = unpacker_.UnpackMap();
+		u32 kept		   = 0;
+		for (u32 i = 0; i < numItems; ++i)
+		{
+			if (unpacker_.UnpackString() == "keep")
+			{
+				if (unpacker_.template UnpackNumber<u32>() != kept++)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				unpacker_.Skip();
+			}
+		}
+
+		if (kept != 20 || unpacker_.PeekType() != ByteCodes::Nil)
+		{
+			return false;
+		}
+
+		// Whole message in one go
+		unpacker_.Set(packer_.Message());
+		unpacker_.Skip();
+		if (unpacker_.PeekType() != ByteCodes::Nil)
+		{
+			return false;
+		}
+
+		// Secure refuses nesting deeper than MaxDepthBase
+		std::vector<u8> deep(MaxDepthBase + 2, ByteCodes::FixArr | 1);
+		deep.back() = ByteCodes::Nil;
+
+		Unpacker<true> secure(std::pair<void*, u64>(deep.data() + 1, deep.size() - 1));
+		secure.Skip();
+
+		try
+		{
+			secure.Set(std::pair<void*, u64>(deep.data(), deep.size()));
+			secure.Skip();
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestTapes(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		std::array<u8, 300> blob;
+		blob.fill(ByteCodes::NeverUse);
+
+		// Records with keys in no particular order, and a long key to need a String8 header
+		const std::string longKey(100, 'k');
+
+		packer_.StartArray();
+		for (u32 i = 0; i < 100; ++i)
+		{
+			packer_.StartMap();
+			packer_.PackString("tags");
+			packer_.StartArray();
+			for (u32 j = 0; j < (i % 7); ++j)
+			{
+				packer_.PackString(std::to_string(j).c_str());
+			}
+			packer_.EndArray();
+			packer_.PackString(longKey.c_str());
+			packer_.PackBinary(blob.data(), i);
+			packer_.PackString("id");
+			packer_.PackNumber(i);
+			packer_.PackString("name");
+			packer_.PackString(std::to_string(i * 3).c_str());
+			packer_.EndMap();
+		}
+		packer_.EndArray();
+		packer_.PackNumber(f64(0.5));
+
+		const std::pair<void*, u64> msg = packer_.Message();
+
+		const Tape<> tape(msg);
+		if (!tape.Size() || tape.Child(0, 100) != Tape<>::NotFound)
+		{
+			return false;
+		}
+
+		unpacker_.Set(msg);
+
+		// Out of order on purpose
+		for (u32 n = 0; n < 100; ++n)
+		{
+			const u32 i		 = (n * 37) % 100;
+			const u64 record = tape.Child(0, i);
+
+			const u64 id = tape.Find(record, "id");
+			if (id == Tape<>::NotFound || tape.Find(record, "missing") != Tape<>::NotFound)
+			{
+				return false;
+			}
+
+			unpacker_.Seek(tape[id].offset);
+			if (unpacker_.template UnpackNumber<u32>() != i)
+			{
+				return false;
+			}
+
+			unpacker_.Seek(tape[tape.Find(record, "name")].offset);
+			if (unpacker_.UnpackString() != std::to_string(i * 3))
+			{
+				return false;
+			}
+
+			const u64 blobIdx = tape.Find(record, longKey.c_str());
+			if (blobIdx == Tape<>::NotFound || tape[blobIdx].count != i)
+			{
+				return false;
+			}
+
+			const u64 tags = tape.Find(record, "tags");
+			if (tags == Tape<>::NotFound || tape[tags].count != (i % 7))
+			{
+				return false;
+			}
+
+			for (u32 j = 0; j < (i % 7); ++j)
+			{
+				unpacker_.Seek(tape[tape.Child(tags, j)].offset);
+				if (unpacker_.UnpackString() != std::to_string(j))
+				{
+					return false;
+				}
+			}
+		}
+
+		// Second top-level element follows the first
+		unpacker_.Seek(tape[tape[0].end].offset);
+		if (unpacker_.template UnpackNumber<f64>() != 0.5)
+		{
+			return false;
+		}
+
+		// Cut short
+		Tape<false> partial;
+		return !partial.Build(std::pair<void*, u64>(msg.first, msg.second - 1));
+	}
+
+	template <typename T>
+	bool Tests::TestValidation(PackerBase<T>& packer_)
+	{
+		std::array<u8, 40> blob;
+		blob.fill(ByteCodes::NeverUse);
+
+		// Long runs of single-byte elements of odd lengths, so containers end part way through 16 bytes
+		packer_.StartArray();
+		for (u32 i = 0; i < 10; ++i)
+		{
+			packer_.StartMap();
+			packer_.PackString("run");
+			packer_.StartArray();
+			for (u32 j = 0; j < (i * 7); ++j)
+			{
+				packer_.PackNumber(i32(j % 3) - 1);
+			}
+			packer_.PackNil();
+			packer_.PackBool(i % 2);
+			packer_.EndArray();
+			packer_.PackString("blob");
+			packer_.PackBinary(blob.data(), blob.size());
+			packer_.EndMap();
+		}
+		packer_.EndArray();
+
+		std::vector<u8> msg((u8*)packer_.Message().first, (u8*)packer_.Message().first + packer_.Message().second);
+		if (Validate(std::pair<void*, u64>(msg.data(), msg.size())) != Validity::Valid)
+		{
+			return false;
+		}
+
+		// Every cut short message is missing something
+		for (u64 i = 1; i < msg.size(); ++i)
+		{
+			if (Validate(std::pair<void*, u64>(msg.data(), i)) != Validity::Truncated)
+			{
+				return false;
+			}
+		}
+
+		// Limits
+		if (Validator<false, 2>().Validate(std::pair<void*, u64>(msg.data(), msg.size())) != Validity::TooDeep ||
+			Validator<>(20).Validate(std::pair<void*, u64>(msg.data(), msg.size())) != Validity::TooLarge)
+		{
+			return false;
+		}
+
+		// Array header replaced
+		msg[0] = ByteCodes::NeverUse;
+		return (Validate(std::pair<void*, u64>(msg.data(), msg.size())) == Validity::InvalidByteCode);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestBulkArrays(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		// Magnitudes spanning every width
+		std::vector<u32> unsigneds;
+		std::vector<i16> signeds;
+		std::vector<f32> floats;
+		for (u32 i = 0; i < 1000; ++i)
+		{
+			unsigneds.push_back(i * i * i);
+			signeds.push_back(i16(i * 37) - 10000);
+			floats.push_back(f32(i) / 3);
+		}
+
+		packer_.StartMap();
+		packer_.PackString("unsigneds");
+		packer_.PackArray(unsigneds.data(), unsigneds.size());
+		packer_.PackString("signeds");
+		packer_.PackArray(signeds.data(), signeds.size());
+		packer_.PackString("floats");
+		packer_.PackArray(floats.data(), floats.size());
+		packer_.PackString("fixed");
+
+		const u64 fixedStart = packer_.CurrentSize();
+		packer_.PackArray(unsigneds.data(), 10, true);
+		const u64 fixedSize	 = packer_.CurrentSize() - fixedStart;
+
+		packer_.PackString("empty");
+		packer_.PackArray(floats.data(), 0);
+		packer_.EndMap();
+
+		// Header + 10 * UInt32
+		if (fixedSize != (1 + 10 * (1 + sizeof(u32))))
+		{
+			return false;
+		}
+
+		unpacker_.Set(packer_.Message());
+		if (unpacker_.UnpackMap() != 5)
+		{
+			return false;
+		}
+
+		unpacker_.UnpackString();
+		if (unpacker_.UnpackArray() != unsigneds.size())
+		{
+			return false;
+		}
+
+		for (const u32 v : unsigneds)
+		{
+			if (unpacker_.template UnpackNumber<u32>() != v)
+			{
+				return false;
+			}
+		}
+
+		unpacker_.UnpackString();
+		if (unpacker_.UnpackArray() != signeds.size())
+		{
+			return false;
+		}
+
+		for (const i16 v : signeds)
+		{
+			if (unpacker_.template UnpackNumber<i16>() != v)
+			{
+				return false;
+			}
+		}
+
+		unpacker_.UnpackString();
+		if (unpacker_.UnpackArray() != floats.size())
+		{
+			return false;
+		}
+
+		for (const f32 v : floats)
+		{
+			if (unpacker_.template UnpackNumber<f32>() != v)
+			{
+				return false;
+			}
+		}
+
+		unpacker_.UnpackString();
+		if (unpacker_.UnpackArray() != 10)
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < 10; ++i)
+		{
+			if (unpacker_.PeekType() != ByteCodes::UInt32 || unpacker_.template UnpackNumber<u32>() != unsigneds[i])
+			{
+				return false;
+			}
+		}
+
+		unpacker_.UnpackString();
+		return (unpacker_.UnpackArray() == 0);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestBulkUnpack(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		std::vector<f32> floats;
+		std::vector<i64> mixed;
+		for (u32 i = 0; i < 1000; ++i)
+		{
+			floats.push_back(f32(i) * 0.25f - 100);
+
+			// Runs of fixints, then wider and wider types, and back again
+			const i64 magnitude = i64(1) << ((i / 20) % 40);
+			mixed.push_back((i % 3) ? magnitude : -magnitude);
+		}
+
+		packer_.PackArray(floats.data(), floats.size());
+		packer_.PackArray(mixed.data(), mixed.size());
+		packer_.PackArray(mixed.data(), 100, true);
+
+		// Numbers of every type one by one, unpacked as f64
+		packer_.StartArray();
+		packer_.PackNumber(u8(200));
+		packer_.PackNumber(f32(1.5f));
+		packer_.PackNumber(i16(-300));
+		packer_.PackNumber(-5);
+		packer_.PackNumber(f64(2.25));
+		packer_.EndArray();
+
+		unpacker_.Set(packer_.Message());
+
+		std::vector<f32> outFloats(floats.size());
+		if (unpacker_.UnpackArray(outFloats.data(), outFloats.size()) != floats.size() || outFloats != floats)
+		{
+			return false;
+		}
+
+		// Too small. Nothing is unpacked, so the call can be repeated
+		std::vector<i64> outMixed(10);
+		if (unpacker_.UnpackArray(outMixed.data(), outMixed.size()) != mixed.size())
+		{
+			return false;
+		}
+
+		outMixed.resize(mixed.size());
+		if (unpacker_.UnpackArray(outMixed.data(), outMixed.size()) != mixed.size() || outMixed != mixed)
+		{
+			return false;
+		}
+
+		std::vector<i64> outFixed(100);
+		if (unpacker_.UnpackArray(outFixed.data(), outFixed.size()) != 100 ||
+			!std::equal(outFixed.begin(), outFixed.end(), mixed.begin()))
+		{
+			return false;
+		}
+
+		std::array<f64, 5> outAny;
+		const std::array<f64, 5> expected = { 200, 1.5, -300, -5, 2.25 };
+		return (unpacker_.UnpackArray(outAny.data(), outAny.size()) == 5 && outAny == expected);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestReflection(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		ReflectedRecord record;
+		record.id	  = 1ull << 40;
+		record.name	  = "sensor";
+		record.flag	  = true;
+		record.origin = { -7, 0.5 };
+		for (u32 i = 0; i < 100; ++i)
+		{
+			record.samples.push_back(f32(i) / 7);
+			record.points.push_back({ i32(i) - 50, f64(i) * 1.5 });
+		}
+		record.tags = { "a", "bb", std::string(40, 'c') };
+
+		Pack(packer_, record);
+
+		// Same fields in another order, with keys it doesn't know about in between
+		packer_.StartMap();
+		packer_.PackString("unknown");
+		packer_.StartArray();
+		packer_.PackString("id");
+		packer_.PackNumber(5);
+		packer_.EndArray();
+		packer_.PackString("name");
+		packer_.PackString("other");
+		packer_.PackNumber(3);
+		packer_.PackString("not a field name");
+		packer_.PackString("id");
+		packer_.PackNumber(9);
+		packer_.PackString("i");
+		packer_.PackNil();
+		packer_.EndMap();
+
+		unpacker_.Set(packer_.Message());
+
+		ReflectedRecord out{};
+		Unpack(unpacker_, out);
+
+		if (out.id != record.id || out.name != record.name || out.flag != record.flag || out.samples != record.samples ||
+			out.origin.x != record.origin.x || out.origin.y != record.origin.y || out.tags != record.tags ||
+			out.points.size() != record.points.size())
+		{
+			return false;
+		}
+
+		for (u64 i = 0; i < record.points.size(); ++i)
+		{
+			if (out.points[i].x != record.points[i].x || out.points[i].y != record.points[i].y)
+			{
+				return false;
+			}
+		}
+
+		// Only the fields present change
+		Unpack(unpacker_, out);
+		return (out.id == 9 && out.name == "other" && out.samples == record.samples);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestKeys(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		// FixString and String8
+		static constexpr Key shortKey("timestamp");
+		static constexpr Key longKey("a key long enough that it can't be packed as a FixString any more");
+
+		static_assert(shortKey.Length() == 9 && shortKey.Size() == 1 + 9 + (PackNulBase ? 1 : 0));
+
+		// Must be byte for byte what PackString() packs
+		packer_.PackKey(shortKey);
+		packer_.PackKey(longKey);
+		const u64 keysSize = packer_.CurrentSize();
+
+		packer_.PackString("timestamp");
+		packer_.PackString("a key long enough that it can't be packed as a FixString any more");
+
+		const std::pair<void*, u64> msg = packer_.Message();
+		if (msg.second != (keysSize * 2) || memcmp(msg.first, (u8*)msg.first + keysSize, keysSize))
+		{
+			return false;
+		}
+
+		unpacker_.Set(msg);
+
+		// Wrong key leaves the position alone
+		if (unpacker_.UnpackKey(longKey) || !unpacker_.UnpackKey(shortKey) || !unpacker_.UnpackKey(longKey))
+		{
+			return false;
+		}
+
+		if (unpacker_.UnpackString() != std::string_view(shortKey.Name(), shortKey.Length()) || !unpacker_.UnpackKey(longKey))
+		{
+			return false;
+		}
+
+		// Nothing left to compare against
+		return !unpacker_.UnpackKey(shortKey);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestSizedStrings(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		// Either side of each FixString/String8/String16/String32 boundary
+		const u32 lengths[] = { 0, 1, 30, 31, 32, 254, 255, 256, 65534, 65535, 65536 };
+
+		// No NUL anywhere near the end of each string, and one within
+		std::string buffer(70000, 'x');
+		buffer[7] = '\0';
+
+		u64 expectedSize = 0;
+		for (const u32 len : lengths)
+		{
+			const u64 packedLen = len + (PackNulBase ? 1 : 0);
+			const u64 header	= (packedLen <= 31) ? 1 : (packedLen <= 255) ? 2 : (packedLen <= 65535) ? 3 : 5;
+
+			packer_.PackString(buffer.data(), len);
+			packer_.PackString(std::string_view(buffer.data(), len));
+			expectedSize += (header + packedLen) * 2;
+		}
+
+		// Only the characters, plus the NUL if PackNulBase
+		if (packer_.CurrentSize() != expectedSize)
+		{
+			return false;
+		}
+
+		unpacker_.Set(packer_.Message());
+		for (const u32 len : lengths)
+		{
+			const std::string_view expected(buffer.data(), len);
+			if (unpacker_.UnpackString() != expected || unpacker_.UnpackString() != expected)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestVisiting(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		const u8 blob[] = { 1, 2, 3 };
+
+		packer_.StartMap();
+		{
+			packer_.PackString("a");
+			packer_.StartArray();
+			{
+				packer_.PackNumber((u8)1);
+				packer_.PackNumber(-2);
+				packer_.PackNumber(300);
+				packer_.PackNumber(-40000);
+				packer_.PackNumber(1.5f);
+				packer_.PackNil();
+				packer_.PackBool(true);
+				packer_.StartArray();
+				packer_.EndArray();
+				packer_.StartMap(0);
+				packer_.EndMap();
+			}
+			packer_.EndArray();
+
+			packer_.PackString("b");
+			packer_.PackBinary(blob, sizeof(blob));
+
+			packer_.PackString("c");
+			packer_.PackExt(5, blob, 2);
+		}
+		packer_.EndMap();
+
+		// Every top-level element is visited
+		packer_.PackNumber((u64)7);
+
+		const std::pair<void*, u64> msg = packer_.Message();
+		unpacker_.Set(msg);
+
+		TraceVisitor trace;
+		if (!unpacker_.Visit(trace) || unpacker_.Tell() != msg.second)
+		{
+			return false;
+		}
+
+		const char* expected = "{3 \"a\" [9 u1 i-2 i300 i-40000 f1.500000 nil true [0 ] {0 } ] \"b\" bin3 \"c\" ext5:2 } u7 ";
+		if (trace.trace != expected)
+		{
+			return false;
+		}
+
+		// Handlers need only have the members they use
+		unpacker_.Set(msg);
+
+		CountVisitor count;
+		if (!unpacker_.Visit(count) || count.numStrings != 3)
+		{
+			return false;
+		}
+
+		// Cut short inside the map
+		Unpacker<false> partial(std::pair<void*, u64>(msg.first, msg.second - 4));
+
+		TraceVisitor partialTrace;
+		return !partial.Visit(partialTrace);
+	}
+	template <typename T, typename S>
+	bool Tests::TestRawForwarding(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		const u8 blob[] = { 9, 8, 7, 6 };
+
+		// An incoming message: a couple of header fields, then a payload to forward untouched
+		packer_.StartMap();
+		{
+			packer_.PackString("id");
+			packer_.PackNumber(42);
+
+			packer_.PackString("payload");
+			packer_.StartArray();
+			for (u32 i = 0; i < 40; ++i)
+			{
+				packer_.StartMap();
+				packer_.PackString("n");
+				packer_.PackNumber(i * 1000);
+				packer_.PackString("blob");
+				packer_.PackBinary(blob, sizeof(blob));
+				packer_.EndMap();
+			}
+			packer_.EndArray();
+
+			packer_.PackString("tail");
+			packer_.PackBool(true);
+		}
+		packer_.EndMap();
+
+		// The Packer is reused for the envelope, so keep the incoming message aside
+		const std::pair<void*, u64> msg = packer_.Message();
+		const std::vector<u8>		incoming((u8*)msg.first, (u8*)msg.first + msg.second);
+
+		unpacker_.Set(std::pair<void*, u64>((void*)incoming.data(), incoming.size()));
+		if (unpacker_.UnpackMap() != 3 || unpacker_.UnpackString() != "id" || unpacker_.template UnpackNumber<u32>() != 42)
+		{
+			return false;
+		}
+
+		if (unpacker_.UnpackString() != "payload")
+		{
+			return false;
+		}
+
+		const u64					payloadStart = unpacker_.Tell();
+		const std::pair<void*, u64> payload		 = unpacker_.UnpackRaw();
+		if (payload.first != incoming.data() + payloadStart || unpacker_.UnpackString() != "tail")
+		{
+			return false;
+		}
+
+		// Scalars are complete elements too
+		const std::pair<void*, u64> tail = unpacker_.UnpackRaw();
+		if (tail.second != 1 || unpacker_.Tell() != incoming.size())
+		{
+			return false;
+		}
+
+		// Spliced in as one element each, within both a deferred and a count-known container
+		packer_.Clear();
+		packer_.StartArray();
+		{
+			packer_.PackString("envelope");
+			packer_.StartMap(1);
+			{
+				packer_.PackString("flag");
+				packer_.PackRaw(tail);
+			}
+			packer_.EndMap();
+			packer_.PackRaw(payload);
+			packer_.PackNumber(-1);
+		}
+		packer_.EndArray();
+
+		unpacker_.Set(packer_.Message());
+		if (unpacker_.UnpackArray() != 4 || unpacker_.UnpackString() != "envelope")
+		{
+			return false;
+		}
+
+		if (unpacker_.UnpackMap() != 1 || unpacker_.UnpackString() != "flag" || !unpacker_.UnpackBool())
+		{
+			return false;
+		}
+
+		// Byte for byte as it came in
+		const std::pair<void*, u64> forwarded = unpacker_.UnpackRaw();
+		if (forwarded.second != payload.second || memcmp(forwarded.first, payload.first, payload.second))
+		{
+			return false;
+		}
+
+		return (unpacker_.template UnpackNumber<i32>() == -1 && unpacker_.Tell() == packer_.CurrentSize());
+	}
+	template <typename T, typename S>
+	bool Tests::TestPatching(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		// Count-known, so the positions returned stay put
+		packer_.StartMap(4);
+		packer_.PackString("seq");
+		const u64 seqPos = packer_.PackFixedNumber((u64)1);
+		packer_.PackString("time");
+		const u64 timePos = packer_.PackFixedNumber(0.5);
+		packer_.PackString("small");
+		packer_.PackNumber((u8)5);
+		packer_.PackString("name");
+		packer_.PackString("unchanged");
+		packer_.EndMap();
+
+		const u64 size = packer_.CurrentSize();
+		if (!packer_.PatchNumber(seqPos, std::numeric_limits<u64>::max()) || !packer_.PatchNumber(timePos, 1234.25))
+		{
+			return false;
+		}
+
+		// Doesn't fit, or isn't the right kind of number
+		if (packer_.PatchNumber(seqPos, -1) || packer_.PatchNumber(seqPos, 1.0) || packer_.PatchNumber(timePos, 2))
+		{
+			return false;
+		}
+
+		unpacker_.Set(packer_.Message());
+		if (unpacker_.UnpackMap() != 4 || unpacker_.UnpackString() != "seq" || unpacker_.template UnpackNumber<u64>() != std::numeric_limits<u64>::max())
+		{
+			return false;
+		}
+
+		if (unpacker_.UnpackString() != "time" || unpacker_.template UnpackNumber<f64>() != 1234.25 || unpacker_.UnpackString() != "small")
+		{
+			return false;
+		}
+
+		// A cached copy, located by walking it. The fixint only takes what fits in it, and the string after
+		// it isn't a number
+		const u64					smallPos = unpacker_.Tell();
+		const std::pair<void*, u64> msg		 = packer_.Message();
+		std::vector<u8>				cached((u8*)msg.first, (u8*)msg.first + msg.second);
+
+		const std::pair<void*, u64> cachedMsg((void*)cached.data(), cached.size());
+		if (!PatchNumber(cachedMsg, smallPos, 127) || PatchNumber(cachedMsg, smallPos, 128) || PatchNumber(cachedMsg, smallPos + 1, 1))
+		{
+			return false;
+		}
+
+		unpacker_.Set(cachedMsg);
+		unpacker_.UnpackMap();
+		for (u32 i = 0; i < 4; ++i)
+		{
+			unpacker_.Skip();
+		}
+
+		if (unpacker_.UnpackString() != "small" || unpacker_.template UnpackNumber<u8>() != 127)
+		{
+			return false;
+		}
+
+		// Nothing moved
+		if (unpacker_.UnpackString() != "name" || unpacker_.UnpackString() != "unchanged")
+		{
+			return false;
+		}
+
+		return (packer_.CurrentSize() == size && unpacker_.Tell() == size);
+	}
+	template <typename T, typename S>
+	bool Tests::TestErrorCodes(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		packer_.StartArray(3);
+		packer_.PackNumber(7);
+		packer_.PackString("text");
+		packer_.StartMap(1);
+		packer_.PackNil();
+		packer_.PackBool(true);
+		packer_.EndMap();
+		packer_.EndArray();
+
+		const std::pair<void*, u64> msg = packer_.Message();
+
+		// Try*() never fail, whatever the Unpacker, and stay put on the wrong type
+		unpacker_.Set(msg);
+		if (unpacker_.TryUnpackMap() || unpacker_.TryUnpackArray() != 3u || unpacker_.TryUnpackString())
+		{
+			return false;
+		}
+
+		if (unpacker_.template TryUnpackNumber<i32>() != 7 || unpacker_.TryUnpackBool() || unpacker_.TryUnpackString() != "text")
+		{
+			return false;
+		}
+
+		if (unpacker_.TryUnpackMap() != 1u || !unpacker_.TryUnpackNil() || unpacker_.TryUnpackBool() != true || unpacker_.TryUnpackNil())
+		{
+			return false;
+		}
+
+		// Cut short inside the string
+		Unpacker<true, false, Failure::Flag> flagged(std::pair<void*, u64>(msg.first, 5));
+		if (flagged.UnpackArray() != 3 || flagged.template UnpackNumber<i32>() != 7 || flagged.Error() != UnpackError::None)
+		{
+			return false;
+		}
+
+		if (flagged.UnpackString().size() || flagged.Error() != UnpackError::OutOfBounds || flagged.Tell() != 5)
+		{
+			return false;
+		}
+
+		// Sticky: everything after fails without changing the first error, until Set()
+		flagged.Seek(0);
+		if (flagged.UnpackArray() || flagged.UnpackBool() || flagged.Error() != UnpackError::OutOfBounds)
+		{
+			return false;
+		}
+
+		flagged.Set(msg);
+		flagged.UnpackArray();
+		if (flagged.UnpackString().size() || flagged.Error() != UnpackError::TypeMismatch || flagged.template UnpackNumber<i32>())
+		{
+			return false;
+		}
+
+		const u8 invalid[] = { 0x92, ByteCodes::Nil, ByteCodes::NeverUse };
+		flagged.Set(std::pair<void*, u64>((void*)invalid, sizeof(invalid)));
+		if (flagged.UnpackRaw().first || flagged.Error() != UnpackError::InvalidByteCode)
+		{
+			return false;
+		}
+
+		std::vector<u8> deep(MaxDepthBase + 1, FixArr | 1);
+		deep.push_back(ByteCodes::Nil);
+
+		flagged.Set(std::pair<void*, u64>(deep.data(), deep.size()));
+		flagged.Skip();
+		if (flagged.Error() != UnpackError::TooDeep)
+		{
+			return false;
+		}
+
+		Visitor visitor;
+		flagged.Set(std::pair<void*, u64>(msg.first, msg.second - 1));
+		if (flagged.Visit(visitor) || flagged.Error() != UnpackError::OutOfBounds)
+		{
+			return false;
+		}
+
+		flagged.Reset();
+		return (flagged.Error() == UnpackError::None);
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestDocuments(PackerBase<T>& packer_, UnpackerBase<S>& /*unpacker_*/)
+	{
+		const u8 blob[] = { 4, 5, 6 };
+
+		// Unsigned and negative numbers only, so that repacking gives the same bytes
+		packer_.StartMap();
+		{
+			packer_.PackString("name");
+			packer_.PackString("config");
+			packer_.PackString("version");
+			packer_.PackNumber(3u);
+			packer_.PackString("offset");
+			packer_.PackNumber(-70000);
+			packer_.PackString("scale");
+			packer_.PackNumber(0.5f);
+			packer_.PackString("ports");
+			packer_.StartArray();
+			packer_.PackNumber(8080u);
+			packer_.PackNumber(8081u);
+			packer_.PackNil();
+			packer_.PackBool(false);
+			packer_.EndArray();
+			packer_.PackString("blob");
+			packer_.PackBinary(blob, sizeof(blob));
+			packer_.PackString("ext");
+			packer_.PackExt(3, blob, 2);
+			packer_.PackString("empty");
+			packer_.StartMap();
+			packer_.EndMap();
+		}
+		packer_.EndMap();
+
+		// Zero-copy, so the message must outlive the Document
+		const std::pair<void*, u64> msg = packer_.Message();
+		const std::vector<u8>		incoming((u8*)msg.first, (u8*)msg.first + msg.second);
+		const std::pair<void*, u64> incomingMsg((void*)incoming.data(), incoming.size());
+
+		Document<> doc;
+		if (!doc.Parse(incomingMsg))
+		{
+			return false;
+		}
+
+		Value& root = doc.Root();
+		if (root.Size() != 8 || root.Find("name")->AsString() != "config" || root.Find("version")->AsNumber<u32>() != 3)
+		{
+			return false;
+		}
+
+		if (root.Find("offset")->AsNumber<i32>() != -70000 || root.Find("scale")->AsNumber<f32>() != 0.5f || root.Find("missing"))
+		{
+			return false;
+		}
+
+		const Value& ports = *root.Find("ports");
+		if (ports.Size() != 4 || ports[1].AsNumber<u16>() != 8081 || !ports[2].Is(ValueType::Nil) || ports[3].AsBool())
+		{
+			return false;
+		}
+
+		if (root.Find("blob")->AsBinary().second != 3 || std::get<0>(root.Find("ext")->AsExt()) != 3 || root.Find("empty")->Size())
+		{
+			return false;
+		}
+
+		// Past the map header, the "name" key and the string header
+		if (root.Find("name")->AsString().data() != (const char*)incoming.data() + 1 + 5 + (PackNulBase ? 1 : 0) + 1)
+		{
+			return false;
+		}
+
+		// Unchanged, it packs back byte for byte
+		packer_.Clear();
+		doc.Pack(packer_);
+		if (packer_.CurrentSize() != incoming.size() || memcmp(packer_.Message().first, incoming.data(), incoming.size()))
+		{
+			return false;
+		}
+
+		// Edits, with copies of anything that doesn't outlive the Document
+		{
+			std::string name = "edited";
+			doc.SetString(*root.Find("name"), name);
+			name = "overwritten";
+		}
+
+		root.Find("version")->SetNumber(4u);
+		doc.Append(*root.Find("ports")).SetNumber(9000u);
+		doc.Insert(root, "added").SetBool(true);
+
+		Value& nested = doc.Insert(*root.Find("empty"), "list");
+		doc.SetArray(nested);
+		for (u32 i = 0; i < 20; ++i)
+		{
+			doc.Append(nested).SetNumber(i);
+		}
+
+		packer_.Clear();
+		doc.Pack(packer_);
+
+		// Copied strings don't point into the message
+		Document<> copy;
+		if (!copy.Parse(packer_.Message(), true))
+		{
+			return false;
+		}
+
+		const Value& edited = copy.Root();
+		if (edited.Size() != 9 || edited.Find("name")->AsString() != "edited" || edited.Find("version")->AsNumber<u32>() != 4)
+		{
+			return false;
+		}
+
+		if (edited.Find("ports")->Size() != 5 || (*edited.Find("ports"))[4].AsNumber<u32>() != 9000 || !edited.Find("added")->AsBool())
+		{
+			return false;
+		}
+
+		const Value* list = edited.Find("empty")->Find("list");
+		if (!list || list->Size() != 20 || (*list)[19].AsNumber<u32>() != 19 || !edited.KeyAt(8).AsString().size())
+		{
+			return false;
+		}
+
+		const u8* const name = (const u8*)edited.Find("name")->AsString().data();
+		const u8* const data = (const u8*)packer_.Message().first;
+		if (name >= data && name < data + packer_.CurrentSize())
+		{
+			return false;
+		}
+
+		// Not exactly one element
+		Document<false> invalid;
+		packer_.PackNil();
+		return (!invalid.Parse(packer_.Message()) && invalid.Root().Is(ValueType::Nil));
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestViews(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		static_assert(std::is_trivially_copyable_v<ElementView<>> && std::is_trivially_copyable_v<ArrayView<>::Iterator> &&
+					  std::is_trivially_copyable_v<MapView<>::Iterator>, "Views must be cheap to save!");
+
+		packer_.StartMap();
+		{
+			packer_.PackNumber(1u);
+			packer_.PackString("not a string key");
+			packer_.PackString("tags");
+			packer_.StartArray();
+			packer_.PackString("a");
+			packer_.PackString("b");
+			packer_.PackString("c");
+			packer_.EndArray();
+			packer_.PackString("items");
+			packer_.StartArray();
+			for (u32 i = 0; i < 10; ++i)
+			{
+				packer_.StartMap();
+				packer_.PackString("id");
+				packer_.PackNumber(i);
+				packer_.PackString("nested");
+				packer_.StartArray();
+				packer_.PackNumber(i * 2);
+				packer_.EndArray();
+				packer_.EndMap();
+			}
+			packer_.EndArray();
+			packer_.PackString("last");
+			packer_.PackBool(true);
+		}
+		packer_.EndMap();
+
+		const std::pair<void*, u64> msg = packer_.Message();
+
+		MapView<> root(msg);
+		if (root.Size() != 4 || !root["last"].AsBool() || root["missing"].Valid() || root["tags"].Type() != ByteCodes::FixArr)
+		{
+			return false;
+		}
+
+		const Key<3> id("id");
+
+		u32 sum = 0;
+		for (const ElementView<> item : root["items"].AsArray())
+		{
+			const MapView<>		fields = item.AsMap();
+			const ArrayView<>	nested = fields["nested"].AsArray();
+			const ElementView<> first  = nested[0];
+
+			sum += fields[id].AsNumber<u32>() + first.AsNumber<u32>();
+		}
+
+		if (sum != 45 * 3)
+		{
+			return false;
+		}
+
+		// Two cursors walked in turn, with one saved and restored part way
+		const ArrayView<> tags	= root["tags"].AsArray();
+		ArrayView<>::Iterator tag	= tags.begin();
+		ArrayView<>::Iterator item	= root["items"].AsArray().begin();
+		ArrayView<>::Iterator saved = tag;
+
+		++tag;
+		++item;
+		if ((*tag).AsString() != "b" || (*item).AsMap()["id"].AsNumber<u32>() != 1 || tag.Remaining() != 2)
+		{
+			return false;
+		}
+
+		tag = saved;
+		if ((*tag).AsString() != "a" || tags[2].AsString() != "c" || tags[3].Valid())
+		{
+			return false;
+		}
+
+		// Non-string keys are skipped over by lookups, but not by iteration
+		u32 pairs = 0;
+		for (const std::pair<ElementView<>, ElementView<>> pair : root)
+		{
+			const ElementView<> key	  = pair.first;
+			const ElementView<> value = pair.second;
+
+			pairs += (pairs == 0 && key.AsNumber<u32>() == 1 && value.AsString() == "not a string key");
+			pairs += (key.Type() == ByteCodes::FixString);
+		}
+
+		if (pairs != 4)
+		{
+			return false;
+		}
+
+		// From part way through an Unpacker, which moves on past the viewed element
+		unpacker_.Set(msg);
+		unpacker_.UnpackMap();
+		unpacker_.Skip();
+		unpacker_.Skip();
+		unpacker_.UnpackString();
+
+		const ArrayView<> viewed(unpacker_.UnpackRaw());
+		if (viewed.Size() != 3 || unpacker_.UnpackString() != "items" || (*++viewed.begin()).AsString() != "b")
+		{
+			return false;
+		}
+
+		// Packing a viewed element forwards it as is. Viewed as the wrong type, it is empty unless Secure
+		const std::pair<void*, u64> raw = root["items"].AsArray()[9].Raw();
+		packer_.Clear();
+		packer_.PackRaw(raw);
+
+		MapView<> forwarded(packer_.Message());
+		return (forwarded["id"].AsNumber<u32>() == 9 && !ArrayView<false>(packer_.Message()).Size());
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestParallel(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		const u32 numRecords = 1000;
+
+		// Packs records [begin_, end_) into any Packer, so that serial and parallel can be compared
+		const auto packRecords = [](auto& packer_, const u64 begin_, const u64 end_)
+		{
+			for (u64 i = begin_; i < end_; ++i)
+			{
+				packer_.StartMap(2);
+				packer_.PackString("id");
+				packer_.PackNumber(i);
+				packer_.PackString("name");
+				packer_.PackString("record");
+				packer_.EndMap();
+			}
+		};
+
+		packer_.StartMap();
+		packer_.PackString("records");
+		packer_.StartArray();
+		packRecords(packer_, 0, numRecords);
+		packer_.EndArray();
+		packer_.EndMap();
+
+		const std::vector<u8> serial((u8*)packer_.Message().first, (u8*)packer_.Message().first + packer_.CurrentSize());
+
+		ParallelPacker<> parallel;
+		parallel.PackArray(numRecords, packRecords, 4);
+
+		packer_.Clear();
+		packer_.StartMap();
+		packer_.PackString("records");
+		parallel.Splice(packer_);
+		packer_.EndMap();
+
+		if (packer_.CurrentSize() != serial.size() || memcmp(packer_.Message().first, serial.data(), serial.size()))
+		{
+			return false;
+		}
+
+		// Gathered from the spans, it is the array alone
+		std::vector<u8> gathered;
+		for (const std::pair<void*, u64>& span : parallel.Spans())
+		{
+			gathered.insert(gathered.end(), (u8*)span.first, (u8*)span.first + span.second);
+		}
+
+		const u64 arrayStart = 1 + 7 + (PackNulBase ? 1 : 0) + 1;
+		if (gathered.size() != parallel.Size() || gathered.size() != serial.size() - arrayStart ||
+			memcmp(gathered.data(), serial.data() + arrayStart, gathered.size()))
+		{
+			return false;
+		}
+
+		// More chunks than pairs, so some would be empty
+		parallel.PackMap(3, [](ParallelPacker<>::ChunkPacker& packer_, const u64 begin_, const u64 end_)
+		{
+			for (u64 i = begin_; i < end_; ++i)
+			{
+				packer_.PackNumber(i);
+				packer_.PackBool(true);
+			}
+		}, 8);
+
+		packer_.Clear();
+		parallel.Splice(packer_);
+
+		unpacker_.Set(packer_.Message());
+		if (unpacker_.UnpackMap() != 3 || unpacker_.template UnpackNumber<u64>() != 0 || !unpacker_.UnpackBool())
+		{
+			return false;
+		}
+
+		// A range that packs the wrong number of items is caught on its thread and rethrown
+		ParallelPacker<true> secure;
+		try
+		{
+			secure.PackArray(10, [](ParallelPacker<true>::ChunkPacker& packer_, const u64 begin_, const u64)
+			{
+				packer_.PackNumber(begin_);
+			}, 2);
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
+	template <typename T, typename S>
+	bool Tests::TestBatching(PackerBase<T>& packer_, UnpackerBase<S>& unpacker_)
+	{
+		const u32 numMessages = 1000;
+
+		// Concatenated [i, "message", i * 2], then the start of one more
+		for (u32 i = 0; i < numMessages; ++i)
+		{
+			packer_.StartArray();
+			packer_.PackNumber(i);
+			packer_.PackString("message");
+			packer_.PackNumber(i * 2);
+			packer_.EndArray();
+		}
+
+		const u64 complete = packer_.CurrentSize();
+		packer_.PackString("cut short");
+
+		const std::pair<void*, u64> msgs(packer_.Message().first, packer_.CurrentSize() - 2);
+
+		WorkStealingPool pool(4);
+		BatchUnpacker<>	 batch(pool, 16);
+		std::vector<u64> results;
+		const auto		 decode = [](Unpacker<>& unpacker_)
+		{
+			unpacker_.UnpackArray();
+			const u64 id = unpacker_.UnpackNumber<u64>();
+			unpacker_.UnpackString();
+			return id + unpacker_.UnpackNumber<u64>();
+		};
+
+		if (batch.Unpack(msgs, decode, results) != complete || results.size() != numMessages)
+		{
+			return false;
+		}
+
+		// In the order they came in, whichever thread ran them
+		for (u32 i = 0; i < numMessages; ++i)
+		{
+			if (results[i] != (u64)i * 3)
+			{
+				return false;
+			}
+		}
+
+		// As a list, with a handler that throws part way through
+		std::vector<std::pair<void*, u64>> list(2, std::pair<void*, u64>(msgs.first, Framer<>().Next(msgs)));
+		try
+		{
+			batch.Unpack(list, [](Unpacker<>& unpacker_) -> u64
+			{
+				if (unpacker_.UnpackArray() == 3)
+				{
+					throw std::runtime_error("Handler failed");
+				}
+
+				return 0;
+			}, results);
+
+			return false;
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+
+		// Many small batches back to back, so that workers are still finishing one as the next is queued
+		std::atomic<u64>				   numRun(0);
+		std::vector<std::function<void()>> tasks(pool.NumThreads(), [&numRun]() { numRun++; });
+		for (u32 i = 0; i < 20000; ++i)
+		{
+			pool(tasks);
+			if (numRun != (u64)(i + 1) * tasks.size())
+			{
+				return false;
+			}
+		}
+
+		// The pool can run a ParallelPacker's ranges too
+		ParallelPacker<SecureBase, false, WorkStealingPool&> parallel(pool);
+		parallel.PackArray(numMessages, [](ParallelPacker<SecureBase, false, WorkStealingPool&>::ChunkPacker& packer_, const u64 begin_, const u64 end_)
+		{
+			for (u64 i = begin_; i < end_; ++i)
+			{
+				packer_.PackNumber(i);
+			}
+		}, pool.NumThreads() * 4);
+
+		packer_.Clear();
+		parallel.Splice(packer_);
+
+		unpacker_.Set(packer_.Message());
+		unpacker_.UnpackArray();
+		unpacker_.Seek(parallel.Size() - 3);
+		return (unpacker_.template UnpackNumber<u32>() == numMessages - 1);
+	}
 }